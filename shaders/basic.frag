@@ -2,15 +2,24 @@
 
 #include "defines/structs.glsl"
 #include "defines/constants.glsl"
+#include "defines/clusters.glsl"
 
 layout(binding = 0) uniform Data {
 	FrameContext frame;
 };
 
-layout(binding = 1) buffer Lights {
+layout(binding = 1, std430) readonly buffer Lights {
 	PointLight pointLights[];
 };
 
+layout(binding = 3, std430) readonly buffer ClusterLightCounts {
+	uint clusterLightCounts[];
+};
+
+layout(binding = 4, std430) readonly buffer ClusterLightIndices {
+	uint clusterLightIndices[];
+};
+
 layout(binding = 0) uniform sampler2D albedoTexture;
 layout(binding = 1) uniform sampler2D normalTexture;
 
@@ -27,6 +36,18 @@ float attenuation(float distance, float linear, float quadratic)
 	return 1.0 / (1.0 + linear * distance + quadratic * distance * distance);
 }
 
+uint clusterIndex()
+{
+	uvec2 tile = uvec2(gl_FragCoord.xy / frame.screenSize * vec2(CLUSTER_COUNT_X, CLUSTER_COUNT_Y));
+	tile = min(tile, uvec2(CLUSTER_COUNT_X - 1, CLUSTER_COUNT_Y - 1));
+
+	float depth = -fragPos.z;
+	float slice = floor(log(depth / frame.clusterNear) / log(frame.clusterFar / frame.clusterNear) * float(CLUSTER_COUNT_Z));
+	uint z = uint(clamp(slice, 0.0, float(CLUSTER_COUNT_Z - 1)));
+
+	return tile.x + CLUSTER_COUNT_X * (tile.y + CLUSTER_COUNT_Y * z);
+}
+
 vec3 lightContribution(PointLight light, vec3 normal)
 {
 	vec3 lightDir = normalize(light.position - fragPos);
@@ -57,8 +78,10 @@ void main()
 	vec3 albedo = DEFAULT_COLOR;
 #endif
 #ifdef NORMAL_MAPPED
-	vec3 normalMap = texture2D(normalTexture, fragUV).xyz;
-	normalMap = normalMap * 2.0 - 1.0;
+	// Only x and y are read, so that two-channel (BC5) normal maps work: z is rebuilt from the unit length
+	vec3 normalMap;
+	normalMap.xy = texture2D(normalTexture, fragUV).xy * 2.0 - 1.0;
+	normalMap.z = sqrt(max(1.0 - dot(normalMap.xy, normalMap.xy), 0.0));
 	vec3 tangent = normalize(fragTangent);
 	vec3 bitangent = normalize(fragBitangent);
 	vec3 normal = normalMap.x * tangent + normalMap.y * bitangent + normalMap.z * fragNormal;
@@ -67,8 +90,10 @@ void main()
 #endif
 	vec3 acc = max(dot(frame.sunDirection, normal), 0.0) * frame.sunColor;
 
-	for (unsigned int i = 0; i < frame.lightCount; i++)
-		acc += lightContribution(pointLights[i], normal);
+	uint cluster = clusterIndex();
+	uint clusterLightCount = clusterLightCounts[cluster];
+	for (uint i = 0; i < clusterLightCount; i++)
+		acc += lightContribution(pointLights[clusterLightIndices[cluster * MAX_LIGHTS_PER_CLUSTER + i]], normal);
 
 	vec3 color = albedo * acc;
 
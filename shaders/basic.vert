@@ -1,17 +1,21 @@
 #version 450
+#extension GL_ARB_shader_draw_parameters : require
 
 #include "defines/structs.glsl"
 
+// Packed formats, see StaticMesh::PackedVertex
 layout(location=0) in vec3 position;
 layout(location=1) in vec3 normal;
-layout(location=2) in vec2 uv;
-layout(location=3) in vec4 tangentData;
+layout(location=2) in vec4 tangentData;
+layout(location=3) in vec2 uv;
 
 layout(binding = 0) uniform Data {
 	FrameContext frame;
 };
 
-uniform mat4 modelMatrix;
+layout(binding = 2, std430) readonly buffer Objects {
+	ObjectData objects[];
+};
 
 out vec3 fragPos;
 out vec3 fragNormal;
@@ -21,11 +25,15 @@ out vec3 fragBitangent;
 
 void main()
 {
-	fragPos = vec3(frame.camera.viewMatrix * modelMatrix * vec4(position, 1.0));
-	mat3 normalMatrix = mat3(transpose(inverse(frame.camera.viewMatrix * modelMatrix)));
-	fragNormal = normalMatrix * normal;
+	ObjectData object = objects[gl_BaseInstanceARB + gl_InstanceID];
+	mat4 modelView = frame.camera.viewMatrix * object.modelMatrix;
+	vec3 objectPosition = object.positionOffset + object.positionScale * position;
+
+	fragPos = vec3(modelView * vec4(objectPosition, 1.0));
+	// The view matrix is rigid, it transforms normals like directions
+	fragNormal = mat3(frame.camera.viewMatrix) * (mat3(object.normalMatrix) * normal);
 	fragUV = uv;
-	fragTangent = mat3(frame.camera.viewMatrix * modelMatrix) * tangentData.xyz;
+	fragTangent = mat3(modelView) * tangentData.xyz;
 	fragBitangent = cross(fragTangent, fragNormal) * (tangentData.w > 0.0 ? 1.0 : -1.0);
 
 	gl_Position = frame.camera.projectionMatrix * vec4(fragPos, 1.0);
@@ -0,0 +1,8 @@
+#pragma once
+
+const uint CLUSTER_COUNT_X = 16;
+const uint CLUSTER_COUNT_Y = 9;
+const uint CLUSTER_COUNT_Z = 24;
+const uint CLUSTER_COUNT = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
+const uint CLUSTER_CULL_GROUP_SIZE = 128;
\ No newline at end of file
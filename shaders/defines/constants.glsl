@@ -1 +1,3 @@
+#pragma once
+
 const vec3 DEFAULT_COLOR = vec3(1.0, 0.0, 1.0);
\ No newline at end of file
@@ -1,3 +1,5 @@
+#pragma once
+
 struct CameraData
 {
 	mat4 viewMatrix;
@@ -11,6 +13,21 @@ struct FrameContext
 	uint lightCount;
 	vec3 sunColor;
 	float pad2;
+	vec2 screenSize;
+	float clusterNear;
+	float clusterFar;
+};
+
+struct ObjectData
+{
+	mat4 modelMatrix;
+	// Inverse transpose of the model matrix, for normals. Only the 3x3 part is used, columns are padded like in std430.
+	mat3x4 normalMatrix;
+	// Dequantization of the mesh's packed positions, from its bounding box
+	vec3 positionOffset;
+	uint materialIndex; // In the scene's materials
+	vec3 positionScale;
+	float pad7;
 };
 
 struct PointLight
@@ -20,4 +37,7 @@ struct PointLight
 	vec3 color;
 	float linear;
 	float quadratic;
+	float pad3;
+	float pad4;
+	float pad5;
 };
\ No newline at end of file
@@ -0,0 +1,12 @@
+#version 450
+
+out vec4 output_color;
+
+in vec3 fragNormal;
+
+void main()
+{
+	// Grey lit from the camera, enough to make out shapes
+	float facing = abs(normalize(fragNormal).z);
+	output_color = vec4(vec3(0.25 + 0.5 * facing), 1.0);
+}
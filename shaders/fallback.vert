@@ -0,0 +1,29 @@
+#version 450
+#extension GL_ARB_shader_draw_parameters : require
+
+#include "defines/structs.glsl"
+
+// Stand-in for programs still compiling: same inputs as basic.vert, flat shading only
+layout(location=0) in vec3 position;
+layout(location=1) in vec3 normal;
+
+layout(binding = 0) uniform Data {
+	FrameContext frame;
+};
+
+layout(binding = 2, std430) readonly buffer Objects {
+	ObjectData objects[];
+};
+
+out vec3 fragNormal;
+
+void main()
+{
+	ObjectData object = objects[gl_BaseInstanceARB + gl_InstanceID];
+	mat4 modelView = frame.camera.viewMatrix * object.modelMatrix;
+	vec3 objectPosition = object.positionOffset + object.positionScale * position;
+
+	fragNormal = mat3(frame.camera.viewMatrix) * (mat3(object.normalMatrix) * normal);
+
+	gl_Position = frame.camera.projectionMatrix * modelView * vec4(objectPosition, 1.0);
+}
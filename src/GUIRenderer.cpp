@@ -4,6 +4,8 @@
 #include <imgui/imgui_impl_glfw.h>
 #include <imgui/imgui_impl_opengl3.h>
 
+#include "core/RenderState.h"
+
 namespace BerylEngine
 {
 	GUIRenderer::GUIRenderer(GLFWwindow* window) : m_window(window)
@@ -33,6 +35,9 @@ namespace BerylEngine
 	{
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+		// ImGui changes GL state without going through the tracker
+		RenderState::invalidate();
 	}
 
 	bool GUIRenderer::forwardMouseEvent(int button, bool down) const
@@ -0,0 +1,760 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <glm/glm.hpp>
+
+#include "ThreadPool.h"
+#include "utils.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BERYL_BLOCK_COMPRESSION_SSE
+#include <emmintrin.h>
+#endif
+
+namespace BerylEngine::BlockCompression
+{
+	using TextureFormat = Texture::TextureFormat;
+
+	// 4x4 pixels as a structure of arrays, so that distances are computed for 4 pixels at once
+	struct Block
+	{
+		alignas(16) float channels[4][16];
+
+		glm::vec4 pixel(int i) const
+		{
+			return glm::vec4(channels[0][i], channels[1][i], channels[2][i], channels[3][i]);
+		}
+	};
+
+	static Block loadBlock(std::span<const unsigned char> pixels, int width, int height, int blockX, int blockY)
+	{
+		Block block;
+		for (int y = 0; y < 4; y++)
+		{
+			const int py = std::min(blockY * 4 + y, height - 1);
+			for (int x = 0; x < 4; x++)
+			{
+				const int px = std::min(blockX * 4 + x, width - 1);
+				const unsigned char* pixel = &pixels[(size_t(py) * width + px) * 4];
+				for (int c = 0; c < 4; c++)
+					block.channels[c][y * 4 + x] = float(pixel[c]);
+			}
+		}
+		return block;
+	}
+
+	// Pick the closest palette entry for every pixel, with squared distances weighted per channel.
+	// Return the total weighted squared error.
+	static float selectIndices(const Block& block, const glm::vec4* palette, int paletteSize, const glm::vec4& weights,
+							   uint8_t indices[16])
+	{
+#if defined(BERYL_BLOCK_COMPRESSION_SSE)
+		__m128 total = _mm_setzero_ps();
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128 channels[4];
+			for (int c = 0; c < 4; c++)
+				channels[c] = _mm_load_ps(&block.channels[c][i]);
+
+			__m128 best = _mm_set1_ps(std::numeric_limits<float>::max());
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int p = 0; p < paletteSize; p++)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for (int c = 0; c < 4; c++)
+				{
+					const __m128 difference = _mm_sub_ps(channels[c], _mm_set1_ps(palette[p][c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(_mm_mul_ps(difference, difference), _mm_set1_ps(weights[c])));
+				}
+
+				const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+				best = _mm_min_ps(distance, best);
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(p)), _mm_andnot_si128(closer, bestIndex));
+			}
+
+			alignas(16) int32_t lanes[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lanes), bestIndex);
+			for (int lane = 0; lane < 4; lane++)
+				indices[i + lane] = uint8_t(lanes[lane]);
+			total = _mm_add_ps(total, best);
+		}
+
+		alignas(16) float sums[4];
+		_mm_store_ps(sums, total);
+		return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+		float total = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			const glm::vec4 pixel = block.pixel(i);
+			float best = std::numeric_limits<float>::max();
+			for (int p = 0; p < paletteSize; p++)
+			{
+				const glm::vec4 difference = pixel - palette[p];
+				const float distance = glm::dot(difference * difference, weights);
+				if (distance < best)
+				{
+					best = distance;
+					indices[i] = uint8_t(p);
+				}
+			}
+			total += best;
+		}
+		return total;
+#endif
+	}
+
+	// Mean of the block and principal axis of its weighted pixels, by power iteration on their covariance.
+	// The axis is null for uniform blocks.
+	static void principalAxis(const Block& block, const glm::vec4& weights, glm::vec4& mean, glm::vec4& axis)
+	{
+		mean = glm::vec4(0.0f);
+		for (int i = 0; i < 16; i++)
+			mean += block.pixel(i);
+		mean /= 16.0f;
+
+		glm::mat4 covariance(0.0f);
+		for (int i = 0; i < 16; i++)
+		{
+			const glm::vec4 offset = (block.pixel(i) - mean) * weights;
+			covariance += glm::outerProduct(offset, offset);
+		}
+
+		// Starting from the column of the most varying channel avoids starting orthogonal to the axis
+		int start = 0;
+		for (int c = 1; c < 4; c++)
+		{
+			if (covariance[c][c] > covariance[start][start])
+				start = c;
+		}
+
+		axis = covariance[start];
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			axis = covariance * axis;
+			const float largest = std::max(std::max(std::abs(axis.x), std::abs(axis.y)),
+				std::max(std::abs(axis.z), std::abs(axis.w)));
+			if (largest < 1e-6f)
+				break;
+			axis /= largest;
+		}
+
+		const float length = glm::length(axis);
+		axis = length > 1e-6f ? axis / length : glm::vec4(0.0f);
+	}
+
+	// Endpoints at the extremes of the block's projection on its principal axis
+	static void axisEndpoints(const Block& block, const glm::vec4& weights, glm::vec4& e0, glm::vec4& e1)
+	{
+		glm::vec4 mean, axis;
+		principalAxis(block, weights, mean, axis);
+
+		float minT = 0.0f;
+		float maxT = 0.0f;
+		for (int i = 0; i < 16; i++)
+		{
+			const float t = glm::dot(block.pixel(i) - mean, axis);
+			minT = std::min(minT, t);
+			maxT = std::max(maxT, t);
+		}
+
+		e0 = glm::clamp(mean + axis * minT, 0.0f, 255.0f);
+		e1 = glm::clamp(mean + axis * maxT, 0.0f, 255.0f);
+	}
+
+	// Least squares endpoints for the given indices. paletteWeights[i] is the weight of the second endpoint in
+	// palette entry i, negative for entries that are not interpolated (BC1 black). Return false if singular.
+	static bool refineEndpoints(const Block& block, const uint8_t indices[16], const float* paletteWeights,
+								glm::vec4& e0, glm::vec4& e1)
+	{
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		glm::vec4 ax(0.0f);
+		glm::vec4 bx(0.0f);
+		for (int i = 0; i < 16; i++)
+		{
+			const float t = paletteWeights[indices[i]];
+			if (t < 0.0f)
+				continue;
+
+			const glm::vec4 pixel = block.pixel(i);
+			aa += (1.0f - t) * (1.0f - t);
+			ab += (1.0f - t) * t;
+			bb += t * t;
+			ax += (1.0f - t) * pixel;
+			bx += t * pixel;
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f)
+			return false;
+
+		e0 = glm::clamp((ax * bb - bx * ab) / determinant, 0.0f, 255.0f);
+		e1 = glm::clamp((bx * aa - ax * ab) / determinant, 0.0f, 255.0f);
+		return true;
+	}
+
+	static void writeBits(uint8_t* data, int& position, uint32_t value, int bitCount)
+	{
+		for (int i = 0; i < bitCount; i++, position++)
+		{
+			if ((value >> i) & 1)
+				data[position >> 3] |= uint8_t(1 << (position & 7));
+		}
+	}
+
+	static uint32_t readBits(const uint8_t* data, int& position, int bitCount)
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < bitCount; i++, position++)
+			value |= uint32_t((data[position >> 3] >> (position & 7)) & 1) << i;
+		return value;
+	}
+
+	// BC1: two RGB565 endpoints and 2-bit indices. c0 > c1 selects 4 colors, otherwise 3 colors and black.
+
+	static const glm::vec4 ColorWeights(1.0f, 1.0f, 1.0f, 0.0f);
+
+	struct Bc1Fit
+	{
+		uint16_t c0;
+		uint16_t c1;
+		uint8_t indices[16];
+		float error;
+	};
+
+	static uint16_t to565(const glm::vec4& color)
+	{
+		const int r = int(std::round(color.r * (31.0f / 255.0f)));
+		const int g = int(std::round(color.g * (63.0f / 255.0f)));
+		const int b = int(std::round(color.b * (31.0f / 255.0f)));
+		return uint16_t((r << 11) | (g << 5) | b);
+	}
+
+	static glm::vec4 from565(uint16_t color)
+	{
+		const int r = (color >> 11) & 31;
+		const int g = (color >> 5) & 63;
+		const int b = color & 31;
+		return glm::vec4((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255.0f);
+	}
+
+	static void bc1Palette(uint16_t c0, uint16_t c1, bool fourColors, glm::vec4 palette[4])
+	{
+		palette[0] = from565(c0);
+		palette[1] = from565(c1);
+		if (fourColors)
+		{
+			palette[2] = glm::floor((2.0f * palette[0] + palette[1]) / 3.0f);
+			palette[3] = glm::floor((palette[0] + 2.0f * palette[1]) / 3.0f);
+		}
+		else
+		{
+			palette[2] = glm::floor((palette[0] + palette[1]) / 2.0f);
+			palette[3] = glm::vec4(0.0f, 0.0f, 0.0f, 255.0f);
+		}
+	}
+
+	static Bc1Fit fitBc1(const Block& block, glm::vec4 e0, glm::vec4 e1, bool fourColors, int refinements)
+	{
+		static constexpr float FourColorWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		static constexpr float ThreeColorWeights[4] = { 0.0f, 1.0f, 0.5f, -1.0f };
+
+		Bc1Fit best;
+		best.error = std::numeric_limits<float>::max();
+		for (int iteration = 0; ; iteration++)
+		{
+			Bc1Fit fit;
+			fit.c0 = to565(e0);
+			fit.c1 = to565(e1);
+
+			glm::vec4 palette[4];
+			bc1Palette(fit.c0, fit.c1, fourColors, palette);
+			fit.error = selectIndices(block, palette, 4, ColorWeights, fit.indices);
+			if (fit.error < best.error)
+				best = fit;
+
+			if (iteration == refinements
+				|| !refineEndpoints(block, fit.indices, fourColors ? FourColorWeights : ThreeColorWeights, e0, e1))
+				break;
+		}
+		return best;
+	}
+
+	static void writeBc1(const Bc1Fit& fit, bool fourColors, uint8_t* out)
+	{
+		uint16_t c0 = fit.c0;
+		uint16_t c1 = fit.c1;
+		uint8_t indices[16];
+		std::memcpy(indices, fit.indices, sizeof(indices));
+
+		// The order of the endpoints selects the mode, swapping them mirrors the interpolated entries
+		if (fourColors && c0 < c1)
+		{
+			std::swap(c0, c1);
+			for (uint8_t& index : indices)
+				index ^= 1;
+		}
+		else if (fourColors && c0 == c1)
+		{
+			std::memset(indices, 0, sizeof(indices));
+		}
+		else if (!fourColors && c0 > c1)
+		{
+			std::swap(c0, c1);
+			for (uint8_t& index : indices)
+				index = index < 2 ? index ^ 1 : index;
+		}
+
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; i++)
+			bits |= uint32_t(indices[i]) << (2 * i);
+
+		out[0] = uint8_t(c0);
+		out[1] = uint8_t(c0 >> 8);
+		out[2] = uint8_t(c1);
+		out[3] = uint8_t(c1 >> 8);
+		std::memcpy(out + 4, &bits, sizeof(bits));
+	}
+
+	// The color block of BC3 is always decoded with 4 colors, whatever the endpoint order
+	static void encodeBc1(const Block& block, Quality quality, bool allowThreeColors, uint8_t* out)
+	{
+		glm::vec4 e0, e1;
+		axisEndpoints(block, ColorWeights, e0, e1);
+
+		const int refinements = quality == Quality::Fast ? 0 : quality == Quality::Normal ? 2 : 8;
+		const Bc1Fit fourColorFit = fitBc1(block, e0, e1, true, refinements);
+		if (allowThreeColors && quality == Quality::High)
+		{
+			const Bc1Fit threeColorFit = fitBc1(block, e0, e1, false, refinements);
+			if (threeColorFit.error < fourColorFit.error)
+			{
+				writeBc1(threeColorFit, false, out);
+				return;
+			}
+		}
+
+		writeBc1(fourColorFit, true, out);
+	}
+
+	static void decodeBc1(const uint8_t* in, bool forceFourColors, unsigned char pixels[16][4])
+	{
+		const uint16_t c0 = uint16_t(in[0] | (in[1] << 8));
+		const uint16_t c1 = uint16_t(in[2] | (in[3] << 8));
+		uint32_t bits;
+		std::memcpy(&bits, in + 4, sizeof(bits));
+
+		glm::vec4 palette[4];
+		bc1Palette(c0, c1, forceFourColors || c0 > c1, palette);
+		for (int i = 0; i < 16; i++)
+		{
+			const glm::vec4& color = palette[(bits >> (2 * i)) & 3];
+			for (int c = 0; c < 3; c++)
+				pixels[i][c] = (unsigned char)color[c];
+		}
+	}
+
+	// BC4: one channel, two 8-bit endpoints and 3-bit indices. a0 > a1 selects 8 interpolated values,
+	// otherwise 6 interpolated values with 0 and 255.
+
+	struct Bc4Fit
+	{
+		int a0;
+		int a1;
+		uint8_t indices[16];
+		float error;
+	};
+
+	static void bc4Palette(int a0, int a1, float palette[8])
+	{
+		palette[0] = float(a0);
+		palette[1] = float(a1);
+		if (a0 > a1)
+		{
+			for (int i = 1; i <= 6; i++)
+				palette[i + 1] = float(((7 - i) * a0 + i * a1 + 3) / 7);
+		}
+		else
+		{
+			for (int i = 1; i <= 4; i++)
+				palette[i + 1] = float(((5 - i) * a0 + i * a1 + 2) / 5);
+			palette[6] = 0.0f;
+			palette[7] = 255.0f;
+		}
+	}
+
+	static void tryBc4(const Block& block, int channel, int a0, int a1, Bc4Fit& best)
+	{
+		float values[8];
+		bc4Palette(a0, a1, values);
+
+		glm::vec4 palette[8];
+		for (int i = 0; i < 8; i++)
+		{
+			palette[i] = glm::vec4(0.0f);
+			palette[i][channel] = values[i];
+		}
+		glm::vec4 weights(0.0f);
+		weights[channel] = 1.0f;
+
+		Bc4Fit fit;
+		fit.a0 = a0;
+		fit.a1 = a1;
+		fit.error = selectIndices(block, palette, 8, weights, fit.indices);
+		if (fit.error < best.error)
+			best = fit;
+	}
+
+	static void encodeBc4(const Block& block, int channel, Quality quality, uint8_t* out)
+	{
+		int minValue = 255;
+		int maxValue = 0;
+		int innerMin = 255; // Extremes without 0 and 255, which the 6-value mode has for free
+		int innerMax = 0;
+		for (int i = 0; i < 16; i++)
+		{
+			const int value = int(block.channels[channel][i]);
+			minValue = std::min(minValue, value);
+			maxValue = std::max(maxValue, value);
+			if (value != 0 && value != 255)
+			{
+				innerMin = std::min(innerMin, value);
+				innerMax = std::max(innerMax, value);
+			}
+		}
+
+		Bc4Fit best;
+		best.error = std::numeric_limits<float>::max();
+		tryBc4(block, channel, maxValue, minValue, best);
+
+		if (quality != Quality::Fast && innerMin <= innerMax)
+			tryBc4(block, channel, innerMin, innerMax, best);
+
+		// Shrinking the range trades exact extremes for finer steps in between
+		if (quality == Quality::High)
+		{
+			for (int shrinkMax = 0; shrinkMax < 4; shrinkMax++)
+			{
+				for (int shrinkMin = 0; shrinkMin < 4; shrinkMin++)
+				{
+					if (maxValue - shrinkMax > minValue + shrinkMin)
+						tryBc4(block, channel, maxValue - shrinkMax, minValue + shrinkMin, best);
+				}
+			}
+		}
+
+		out[0] = uint8_t(best.a0);
+		out[1] = uint8_t(best.a1);
+		uint64_t bits = 0;
+		for (int i = 0; i < 16; i++)
+			bits |= uint64_t(best.indices[i]) << (3 * i);
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = uint8_t(bits >> (8 * i));
+	}
+
+	static void decodeBc4(const uint8_t* in, int channel, unsigned char pixels[16][4])
+	{
+		float palette[8];
+		bc4Palette(in[0], in[1], palette);
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; i++)
+			bits |= uint64_t(in[2 + i]) << (8 * i);
+		for (int i = 0; i < 16; i++)
+			pixels[i][channel] = (unsigned char)palette[(bits >> (3 * i)) & 7];
+	}
+
+	// BC7 mode 6: one subset, RGBA 7.7.7.7 endpoints with a parity bit each and 4-bit indices.
+	// The other modes partition blocks or rotate channels, mode 6 alone is already well above BC1/BC3 quality.
+
+	static constexpr int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	static const glm::vec4 RgbaWeights(1.0f);
+
+	struct Bc7Fit
+	{
+		glm::ivec4 q0;
+		glm::ivec4 q1;
+		int p0;
+		int p1;
+		uint8_t indices[16];
+		float error;
+	};
+
+	static glm::ivec4 quantizeBc7(const glm::vec4& endpoint, int parity)
+	{
+		return glm::clamp(glm::ivec4(glm::round((endpoint - float(parity)) * 0.5f)), 0, 127);
+	}
+
+	static glm::vec4 bc7Endpoint(const glm::ivec4& quantized, int parity)
+	{
+		return glm::vec4((quantized << 1) | parity);
+	}
+
+	static void bc7Palette(const glm::vec4& e0, const glm::vec4& e1, glm::vec4 palette[16])
+	{
+		for (int i = 0; i < 16; i++)
+			palette[i] = glm::floor(((64.0f - Bc7Weights[i]) * e0 + float(Bc7Weights[i]) * e1 + 32.0f) / 64.0f);
+	}
+
+	// Parity bit with the smallest quantization error for an endpoint
+	static int closestParity(const glm::vec4& endpoint)
+	{
+		const glm::vec4 even = endpoint - bc7Endpoint(quantizeBc7(endpoint, 0), 0);
+		const glm::vec4 odd = endpoint - bc7Endpoint(quantizeBc7(endpoint, 1), 1);
+		return glm::dot(odd, odd) < glm::dot(even, even) ? 1 : 0;
+	}
+
+	static void encodeBc7(const Block& block, Quality quality, uint8_t* out)
+	{
+		static constexpr float PaletteWeights[16] = { 0.0f / 64.0f, 4.0f / 64.0f, 9.0f / 64.0f, 13.0f / 64.0f,
+			17.0f / 64.0f, 21.0f / 64.0f, 26.0f / 64.0f, 30.0f / 64.0f, 34.0f / 64.0f, 38.0f / 64.0f, 43.0f / 64.0f,
+			47.0f / 64.0f, 51.0f / 64.0f, 55.0f / 64.0f, 60.0f / 64.0f, 64.0f / 64.0f };
+
+		glm::vec4 e0, e1;
+		axisEndpoints(block, RgbaWeights, e0, e1);
+
+		const int refinements = quality == Quality::Fast ? 0 : quality == Quality::Normal ? 2 : 6;
+		Bc7Fit best;
+		best.error = std::numeric_limits<float>::max();
+		for (int iteration = 0; ; iteration++)
+		{
+			// Fast only keeps the closest parity bits, the others try the 4 combinations
+			const int parities = quality == Quality::Fast ? 1 : 4;
+			Bc7Fit iterationBest;
+			iterationBest.error = std::numeric_limits<float>::max();
+			for (int parity = 0; parity < parities; parity++)
+			{
+				Bc7Fit fit;
+				fit.p0 = quality == Quality::Fast ? closestParity(e0) : parity & 1;
+				fit.p1 = quality == Quality::Fast ? closestParity(e1) : parity >> 1;
+				fit.q0 = quantizeBc7(e0, fit.p0);
+				fit.q1 = quantizeBc7(e1, fit.p1);
+
+				glm::vec4 palette[16];
+				bc7Palette(bc7Endpoint(fit.q0, fit.p0), bc7Endpoint(fit.q1, fit.p1), palette);
+				fit.error = selectIndices(block, palette, 16, RgbaWeights, fit.indices);
+				if (fit.error < iterationBest.error)
+					iterationBest = fit;
+			}
+
+			if (iterationBest.error < best.error)
+				best = iterationBest;
+			if (iteration == refinements || !refineEndpoints(block, iterationBest.indices, PaletteWeights, e0, e1))
+				break;
+		}
+
+		// The most significant bit of the first index is implicitly 0
+		if (best.indices[0] >= 8)
+		{
+			std::swap(best.q0, best.q1);
+			std::swap(best.p0, best.p1);
+			for (uint8_t& index : best.indices)
+				index = uint8_t(15 - index);
+		}
+
+		std::memset(out, 0, 16);
+		int position = 0;
+		writeBits(out, position, 1 << 6, 7);
+		for (int c = 0; c < 4; c++)
+		{
+			writeBits(out, position, uint32_t(best.q0[c]), 7);
+			writeBits(out, position, uint32_t(best.q1[c]), 7);
+		}
+		writeBits(out, position, uint32_t(best.p0), 1);
+		writeBits(out, position, uint32_t(best.p1), 1);
+		writeBits(out, position, best.indices[0], 3);
+		for (int i = 1; i < 16; i++)
+			writeBits(out, position, best.indices[i], 4);
+	}
+
+	static void decodeBc7(const uint8_t* in, unsigned char pixels[16][4])
+	{
+		int position = 0;
+		if (readBits(in, position, 7) != 1 << 6)
+		{
+			// Only mode 6 is written by the encoder
+			std::memset(pixels, 0, 16 * 4);
+			return;
+		}
+
+		glm::ivec4 q0, q1;
+		for (int c = 0; c < 4; c++)
+		{
+			q0[c] = int(readBits(in, position, 7));
+			q1[c] = int(readBits(in, position, 7));
+		}
+		const int p0 = int(readBits(in, position, 1));
+		const int p1 = int(readBits(in, position, 1));
+
+		glm::vec4 palette[16];
+		bc7Palette(bc7Endpoint(q0, p0), bc7Endpoint(q1, p1), palette);
+		for (int i = 0; i < 16; i++)
+		{
+			const glm::vec4& color = palette[readBits(in, position, i == 0 ? 3 : 4)];
+			for (int c = 0; c < 4; c++)
+				pixels[i][c] = (unsigned char)color[c];
+		}
+	}
+
+	size_t blockSize(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::BC1_UNORM:
+		case TextureFormat::BC4_UNORM:
+			return 8;
+		case TextureFormat::BC3_UNORM:
+		case TextureFormat::BC5_UNORM:
+		case TextureFormat::BC7_UNORM:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	size_t compressedSize(TextureFormat format, int width, int height)
+	{
+		return size_t((width + 3) / 4) * size_t((height + 3) / 4) * blockSize(format);
+	}
+
+	std::vector<std::byte> compress(std::span<const unsigned char> pixels, int width, int height,
+									TextureFormat format, Quality quality)
+	{
+		const size_t bytesPerBlock = blockSize(format);
+		if (bytesPerBlock == 0)
+			FATAL("Texture format is not block-compressed.");
+
+		const int blocksX = (width + 3) / 4;
+		const int blocksY = (height + 3) / 4;
+		std::vector<std::byte> blocks(compressedSize(format, width, height));
+
+		ThreadPool::global().parallelFor(size_t(blocksY), [&](size_t blockY)
+			{
+				for (int blockX = 0; blockX < blocksX; blockX++)
+				{
+					const Block block = loadBlock(pixels, width, height, blockX, int(blockY));
+					uint8_t* out = reinterpret_cast<uint8_t*>(blocks.data()) + (blockY * blocksX + blockX) * bytesPerBlock;
+
+					switch (format)
+					{
+					case TextureFormat::BC1_UNORM:
+						encodeBc1(block, quality, true, out);
+						break;
+					case TextureFormat::BC3_UNORM:
+						encodeBc4(block, 3, quality, out);
+						encodeBc1(block, quality, false, out + 8);
+						break;
+					case TextureFormat::BC4_UNORM:
+						encodeBc4(block, 0, quality, out);
+						break;
+					case TextureFormat::BC5_UNORM:
+						encodeBc4(block, 0, quality, out);
+						encodeBc4(block, 1, quality, out + 8);
+						break;
+					case TextureFormat::BC7_UNORM:
+						encodeBc7(block, quality, out);
+						break;
+					default:
+						break;
+					}
+				}
+			});
+
+		return blocks;
+	}
+
+	std::vector<unsigned char> decompress(std::span<const std::byte> blocks, int width, int height, TextureFormat format)
+	{
+		const size_t bytesPerBlock = blockSize(format);
+		if (bytesPerBlock == 0 || blocks.size() < compressedSize(format, width, height))
+			FATAL("Invalid block-compressed image.");
+
+		const int blocksX = (width + 3) / 4;
+		const int blocksY = (height + 3) / 4;
+		std::vector<unsigned char> pixels(size_t(width) * height * 4);
+
+		for (int blockY = 0; blockY < blocksY; blockY++)
+		{
+			for (int blockX = 0; blockX < blocksX; blockX++)
+			{
+				const uint8_t* in = reinterpret_cast<const uint8_t*>(blocks.data())
+					+ (size_t(blockY) * blocksX + blockX) * bytesPerBlock;
+
+				unsigned char decoded[16][4];
+				for (auto& pixel : decoded)
+				{
+					pixel[0] = pixel[1] = pixel[2] = 0;
+					pixel[3] = 255;
+				}
+
+				switch (format)
+				{
+				case TextureFormat::BC1_UNORM:
+					decodeBc1(in, false, decoded);
+					break;
+				case TextureFormat::BC3_UNORM:
+					decodeBc4(in, 3, decoded);
+					decodeBc1(in + 8, true, decoded);
+					break;
+				case TextureFormat::BC4_UNORM:
+					decodeBc4(in, 0, decoded);
+					break;
+				case TextureFormat::BC5_UNORM:
+					decodeBc4(in, 0, decoded);
+					decodeBc4(in + 8, 1, decoded);
+					break;
+				case TextureFormat::BC7_UNORM:
+					decodeBc7(in, decoded);
+					break;
+				default:
+					break;
+				}
+
+				for (int y = 0; y < 4 && blockY * 4 + y < height; y++)
+				{
+					for (int x = 0; x < 4 && blockX * 4 + x < width; x++)
+					{
+						unsigned char* pixel = &pixels[(size_t(blockY * 4 + y) * width + blockX * 4 + x) * 4];
+						std::memcpy(pixel, decoded[y * 4 + x], 4);
+					}
+				}
+			}
+		}
+
+		return pixels;
+	}
+
+	float psnr(std::span<const unsigned char> reference, std::span<const unsigned char> decoded, TextureFormat format)
+	{
+		int channelCount = 4;
+		if (format == TextureFormat::BC1_UNORM || format == TextureFormat::RGB8_UNORM)
+			channelCount = 3;
+		else if (format == TextureFormat::BC5_UNORM)
+			channelCount = 2;
+		else if (format == TextureFormat::BC4_UNORM)
+			channelCount = 1;
+
+		const size_t pixelCount = std::min(reference.size(), decoded.size()) / 4;
+		double squaredError = 0.0;
+		for (size_t i = 0; i < pixelCount; i++)
+		{
+			for (int c = 0; c < channelCount; c++)
+			{
+				const double difference = double(reference[i * 4 + c]) - double(decoded[i * 4 + c]);
+				squaredError += difference * difference;
+			}
+		}
+
+		if (squaredError == 0.0)
+			return std::numeric_limits<float>::infinity();
+
+		const double meanSquaredError = squaredError / double(pixelCount * channelCount);
+		return float(10.0 * std::log10(255.0 * 255.0 / meanSquaredError));
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "Texture.h"
+
+/// <summary>
+/// CPU encoder and decoder for the BCn block-compressed texture formats.
+/// Images are given as RGBA8 pixels and encoded in 4x4 blocks, edge blocks repeat the last row and column.
+/// </summary>
+namespace BerylEngine::BlockCompression
+{
+	/// <summary>
+	/// Speed to quality trade-off of the encoder, see Texture::CompressionQuality.
+	/// </summary>
+	using Quality = Texture::CompressionQuality;
+
+	/// <summary>
+	/// Bytes per 4x4 block, 0 for formats that are not block-compressed.
+	/// </summary>
+	size_t blockSize(Texture::TextureFormat format);
+
+	/// <summary>
+	/// Bytes of a width x height image in the given block-compressed format.
+	/// </summary>
+	size_t compressedSize(Texture::TextureFormat format, int width, int height);
+
+	/// <summary>
+	/// Encode RGBA8 pixels. BC1 ignores alpha, BC4 keeps red and BC5 red and green. BC7 only uses mode 6.
+	/// Rows of blocks are encoded in parallel on the global thread pool.
+	/// </summary>
+	std::vector<std::byte> compress(std::span<const unsigned char> pixels, int width, int height,
+									Texture::TextureFormat format, Quality quality = Quality::Normal);
+
+	/// <summary>
+	/// Decode blocks written by compress() to RGBA8. Channels the format lacks decode to 0, alpha to 255.
+	/// </summary>
+	std::vector<unsigned char> decompress(std::span<const std::byte> blocks, int width, int height,
+										  Texture::TextureFormat format);
+
+	/// <summary>
+	/// Peak signal to noise ratio of decoded against reference, both RGBA8, over the channels the format stores.
+	/// Infinite when the images are identical.
+	/// </summary>
+	float psnr(std::span<const unsigned char> reference, std::span<const unsigned char> decoded,
+			   Texture::TextureFormat format);
+}
@@ -0,0 +1,97 @@
+#include "Bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace BerylEngine
+{
+	glm::vec3 AABB::center() const
+	{
+		return (min + max) * 0.5f;
+	}
+
+	glm::vec3 AABB::extents() const
+	{
+		return (max - min) * 0.5f;
+	}
+
+	AABB AABB::transformed(const glm::mat4& matrix) const
+	{
+		// Transform the center and project the extents on each axis (Arvo)
+		const glm::vec3 newCenter = glm::vec3(matrix * glm::vec4(center(), 1.0f));
+		const glm::vec3 halfSize = extents();
+		const glm::mat3 absolute(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])),
+			glm::abs(glm::vec3(matrix[2])));
+		const glm::vec3 newExtents = absolute * halfSize;
+
+		return { newCenter - newExtents, newCenter + newExtents };
+	}
+
+	bool AABB::overlaps(const AABB& other) const
+	{
+		return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::lessThanEqual(other.min, max));
+	}
+
+	bool AABB::contains(const AABB& other) const
+	{
+		return glm::all(glm::lessThanEqual(min, other.min)) && glm::all(glm::lessThanEqual(other.max, max));
+	}
+
+	AABB AABB::merged(const AABB& other) const
+	{
+		return { glm::min(min, other.min), glm::max(max, other.max) };
+	}
+
+	float AABB::surfaceArea() const
+	{
+		const glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	BoundingSphere BoundingSphere::transformed(const glm::mat4& matrix) const
+	{
+		const float scale = std::sqrt(std::max({ glm::dot(glm::vec3(matrix[0]), glm::vec3(matrix[0])),
+			glm::dot(glm::vec3(matrix[1]), glm::vec3(matrix[1])),
+			glm::dot(glm::vec3(matrix[2]), glm::vec3(matrix[2])) }));
+
+		return { glm::vec3(matrix * glm::vec4(center, 1.0f)), radius * scale };
+	}
+
+	Bounds Bounds::fromPoints(std::span<const glm::vec3> points)
+	{
+		return fromPoints(points.data(), sizeof(glm::vec3), points.size());
+	}
+
+	Bounds Bounds::fromPoints(const void* firstPoint, size_t stride, size_t count)
+	{
+		auto point = [&](size_t i) -> const glm::vec3&
+		{
+			return *reinterpret_cast<const glm::vec3*>(static_cast<const unsigned char*>(firstPoint) + i * stride);
+		};
+
+		if (count == 0)
+			return { { glm::vec3(0.0f), glm::vec3(0.0f) }, { glm::vec3(0.0f), 0.0f } };
+
+		AABB box = { point(0), point(0) };
+		for (size_t i = 1; i < count; i++)
+		{
+			box.min = glm::min(box.min, point(i));
+			box.max = glm::max(box.max, point(i));
+		}
+
+		const glm::vec3 center = box.center();
+		float radiusSquared = 0.0f;
+		for (size_t i = 0; i < count; i++)
+		{
+			const glm::vec3 offset = point(i) - center;
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+
+		return { box, { center, std::sqrt(radiusSquared) } };
+	}
+
+	Bounds Bounds::transformed(const glm::mat4& matrix) const
+	{
+		return { box.transformed(matrix), sphere.transformed(matrix) };
+	}
+}
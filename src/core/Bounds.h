@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <span>
+
+namespace BerylEngine
+{
+	struct AABB
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+
+		glm::vec3 center() const;
+		glm::vec3 extents() const;
+
+		/// <summary>
+		/// Smallest box containing this box transformed by the given affine matrix.
+		/// </summary>
+		AABB transformed(const glm::mat4& matrix) const;
+
+		bool overlaps(const AABB& other) const;
+		bool contains(const AABB& other) const;
+		AABB merged(const AABB& other) const;
+		float surfaceArea() const;
+	};
+
+	struct BoundingSphere
+	{
+		glm::vec3 center;
+		float radius;
+
+		/// <summary>
+		/// Sphere containing this sphere transformed by the given affine matrix. Non-uniform scales
+		/// use the largest axis scale, so the result is conservative.
+		/// </summary>
+		BoundingSphere transformed(const glm::mat4& matrix) const;
+	};
+
+	struct Bounds
+	{
+		AABB box;
+		BoundingSphere sphere;
+
+		/// <summary>
+		/// The sphere is centered on the box, its radius is the distance to the farthest point.
+		/// </summary>
+		static Bounds fromPoints(std::span<const glm::vec3> points);
+
+		/// <summary>
+		/// Same as fromPoints, for points stored in an array of structures (e.g. vertex positions).
+		/// </summary>
+		static Bounds fromPoints(const void* firstPoint, size_t stride, size_t count);
+
+		Bounds transformed(const glm::mat4& matrix) const;
+	};
+}
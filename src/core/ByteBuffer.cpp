@@ -1,38 +1,183 @@
 #include "ByteBuffer.h"
 
+#include <cstring>
 #include <spdlog/spdlog.h>
+#include <utility>
+
+#include "RenderState.h"
 
 namespace BerylEngine
 {
+	BufferMapping::BufferMapping(unsigned int handle, void* data, size_t size)
+		: m_handle(handle), m_data(data), m_size(size)
+	{
+	}
+
+	BufferMapping::BufferMapping(BufferMapping&& other) noexcept
+		: m_handle(std::exchange(other.m_handle, 0)),
+		m_data(std::exchange(other.m_data, nullptr)),
+		m_size(std::exchange(other.m_size, 0))
+	{
+	}
+
+	BufferMapping& BufferMapping::operator=(BufferMapping&& other) noexcept
+	{
+		std::swap(m_handle, other.m_handle);
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		return *this;
+	}
+
+	BufferMapping::~BufferMapping()
+	{
+		if (m_handle != 0 && m_data != nullptr)
+			glUnmapNamedBuffer(m_handle);
+	}
+
+	void* BufferMapping::data() const
+	{
+		return m_data;
+	}
+
+	size_t BufferMapping::size() const
+	{
+		return m_size;
+	}
 
 	ByteBuffer::ByteBuffer(const void* data, size_t size)
+		: ByteBuffer(data, size, BufferUsageHint::Static)
+	{
+	}
+
+	ByteBuffer::ByteBuffer(size_t size)
+		: ByteBuffer(nullptr, size)
+	{
+	}
+
+	ByteBuffer::ByteBuffer(const void* data, size_t size, BufferUsageHint usageHint)
+		: m_usageHint(usageHint)
 	{
 		m_size = size;
 		glCreateBuffers(1, &m_handle);
-		glNamedBufferData(m_handle, size, data, GL_STATIC_DRAW);
+		glNamedBufferData(m_handle, size, data, usageHint2GL(usageHint));
 
 		spdlog::trace("Buffer {} allocated. Size is {}.", m_handle, size);
 	}
 
-	ByteBuffer::ByteBuffer(size_t size)
-		: ByteBuffer(nullptr, size)
+	ByteBuffer::ByteBuffer(const void* data, size_t size, BufferStorage storage)
+		: m_immutable(true), m_storage(storage)
 	{
+		m_size = size;
+		glCreateBuffers(1, &m_handle);
+		glNamedBufferStorage(m_handle, size, data, bufferStorage2GL(storage));
+
+		if (storage & BufferStorage::Persistent)
+		{
+			GLbitfield mapFlags = bufferStorage2GL(storage) & ~GL_DYNAMIC_STORAGE_BIT;
+			if (!(storage & BufferStorage::Coherent))
+				mapFlags |= GL_MAP_FLUSH_EXPLICIT_BIT;
+
+			m_persistentData = static_cast<unsigned char*>(glMapNamedBufferRange(m_handle, 0, size, mapFlags));
+			if (m_persistentData == nullptr)
+				spdlog::error("Failed to persistently map buffer {}.", m_handle);
+		}
+
+		spdlog::trace("Buffer {} allocated with immutable storage. Size is {}.", m_handle, size);
+	}
+
+	ByteBuffer::ByteBuffer(ByteBuffer&& other) noexcept
+		: m_handle(std::exchange(other.m_handle, 0)),
+		m_immutable(other.m_immutable),
+		m_usageHint(other.m_usageHint),
+		m_storage(other.m_storage),
+		m_persistentData(std::exchange(other.m_persistentData, nullptr))
+	{
+		m_size = std::exchange(other.m_size, 0);
+	}
+
+	ByteBuffer& ByteBuffer::operator=(ByteBuffer&& other) noexcept
+	{
+		std::swap(m_handle, other.m_handle);
+		std::swap(m_immutable, other.m_immutable);
+		std::swap(m_usageHint, other.m_usageHint);
+		std::swap(m_storage, other.m_storage);
+		std::swap(m_persistentData, other.m_persistentData);
+		std::swap(m_size, other.m_size);
+		return *this;
 	}
 
 	ByteBuffer::~ByteBuffer()
 	{
+		if (m_handle == 0)
+			return;
+
+		if (m_persistentData != nullptr)
+			glUnmapNamedBuffer(m_handle);
+
+		RenderState::releaseBuffer(m_handle);
 		glDeleteBuffers(1, &m_handle);
 
 		spdlog::trace("Buffer {} deleted.", m_handle);
 	}
 
+	unsigned int ByteBuffer::getHandle() const
+	{
+		return m_handle;
+	}
+
+	size_t ByteBuffer::getSize() const
+	{
+		return m_size;
+	}
+
 	void ByteBuffer::bind(BufferUsageType usageType) const
 	{
-		glBindBuffer(usageType2GL(usageType), m_handle);
+		RenderState::bindBuffer(usageType2GL(usageType), m_handle);
+	}
+
+	void ByteBuffer::update(std::span<const std::byte> data, size_t offset)
+	{
+		if (offset + data.size() > m_size)
+		{
+			spdlog::error("Update of buffer {} is out of bounds ({} bytes at offset {}, size is {}).",
+				m_handle, data.size(), offset, m_size);
+			return;
+		}
+
+		if (m_persistentData != nullptr)
+		{
+			std::memcpy(m_persistentData + offset, data.data(), data.size());
+			if (!(m_storage & BufferStorage::Coherent))
+				glFlushMappedNamedBufferRange(m_handle, offset, data.size());
+		}
+		else if (!m_immutable || (m_storage & BufferStorage::Dynamic))
+			glNamedBufferSubData(m_handle, offset, data.size(), data.data());
+		else
+			spdlog::error("Buffer {} has immutable storage without dynamic flag. It cannot be updated.", m_handle);
+	}
+
+	void ByteBuffer::orphan()
+	{
+		if (m_immutable)
+			glInvalidateBufferData(m_handle);
+		else
+			glNamedBufferData(m_handle, m_size, nullptr, usageHint2GL(m_usageHint));
+	}
+
+	BufferMapping ByteBuffer::map(size_t offset, size_t size, AccessType accessType) const
+	{
+		if (m_persistentData != nullptr)
+			return BufferMapping(0, m_persistentData + offset, size);
+
+		void* data = glMapNamedBufferRange(m_handle, offset, size, accessType2GLMapBits(accessType));
+		if (data == nullptr)
+			spdlog::error("Failed to map {} bytes of buffer {} at offset {}.", size, m_handle, offset);
+
+		return BufferMapping(m_handle, data, size);
 	}
 
-	void ByteBuffer::setAccess(AccessType accessType) const
+	void* ByteBuffer::persistentData() const
 	{
-		glMapNamedBuffer(m_handle, accessType2GL(accessType));
+		return m_persistentData;
 	}
-}
\ No newline at end of file
+}
@@ -1,18 +1,49 @@
 #pragma once
 
+#include <cstddef>
+#include <span>
+
 #include "graphicsDefs.h"
+#include "RenderState.h"
 
 #include "utils.h"
 
 namespace BerylEngine
 {
+	/// <summary>
+	/// Mapped range of a buffer. The range is unmapped when the mapping is destroyed,
+	/// unless it is a view of a persistently mapped buffer.
+	/// </summary>
+	class BufferMapping : NonCopyable
+	{
+	private:
+		unsigned int m_handle = 0;
+		void* m_data = nullptr;
+		size_t m_size = 0;
+
+	public:
+		BufferMapping() = default;
+		BufferMapping(unsigned int handle, void* data, size_t size);
+
+		BufferMapping(BufferMapping&& other) noexcept;
+		BufferMapping& operator=(BufferMapping&& other) noexcept;
+		~BufferMapping();
+
+		void* data() const;
+		size_t size() const;
+	};
+
 	class ByteBuffer : NonCopyable
 	{
 	private:
-		unsigned int m_handle;
+		unsigned int m_handle = 0;
+		bool m_immutable = false;
+		BufferUsageHint m_usageHint = BufferUsageHint::Static;
+		BufferStorage m_storage = BufferStorage::None;
+		unsigned char* m_persistentData = nullptr;
 
 	protected:
-		size_t m_size;
+		size_t m_size = 0;
 
 	public:
 		ByteBuffer() = default;
@@ -20,18 +51,54 @@ namespace BerylEngine
 		ByteBuffer(const void* data, size_t size);
 		ByteBuffer(size_t size);
 
-		ByteBuffer(ByteBuffer&&) = default;
-		ByteBuffer& operator=(ByteBuffer&&) = default;
+		/// <summary>
+		/// Create a buffer with mutable storage.
+		/// </summary>
+		ByteBuffer(const void* data, size_t size, BufferUsageHint usageHint);
+
+		/// <summary>
+		/// Create a buffer with immutable storage. Persistent buffers are mapped for their whole lifetime.
+		/// </summary>
+		ByteBuffer(const void* data, size_t size, BufferStorage storage);
+
+		ByteBuffer(ByteBuffer&& other) noexcept;
+		ByteBuffer& operator=(ByteBuffer&& other) noexcept;
 		~ByteBuffer();
 
+		unsigned int getHandle() const;
+		size_t getSize() const;
+
 		void bind(BufferUsageType usageType) const;
 		template<BufferUsageType U>
 		void bind(int bindingPoint) const
 		{
 			static_assert(U == BufferUsageType::UniformBuffer || U == BufferUsageType::ShaderStorage, "Bad usage type");
-			glBindBufferBase(usageType2GL(U), bindingPoint, m_handle);
+			RenderState::bindBufferRange(usageType2GL(U), bindingPoint, m_handle, 0, 0);
+		}
+
+		template<BufferUsageType U>
+		void bindRange(int bindingPoint, size_t offset, size_t size) const
+		{
+			static_assert(U == BufferUsageType::UniformBuffer || U == BufferUsageType::ShaderStorage, "Bad usage type");
+			RenderState::bindBufferRange(usageType2GL(U), bindingPoint, m_handle, offset, size);
 		}
 
-		void setAccess(AccessType accessType) const;
+		/// <summary>
+		/// Copy data into the buffer without reallocating it.
+		/// Immutable buffers must be created with BufferStorage::Dynamic or be persistently mapped.
+		/// </summary>
+		void update(std::span<const std::byte> data, size_t offset);
+
+		/// <summary>
+		/// Give the current storage back to the driver so that new writes do not wait on pending draws.
+		/// </summary>
+		void orphan();
+
+		BufferMapping map(size_t offset, size_t size, AccessType accessType) const;
+
+		/// <summary>
+		/// Pointer to the whole buffer for persistently mapped buffers, nullptr otherwise.
+		/// </summary>
+		void* persistentData() const;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,204 @@
+#include "GeometryArena.h"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+namespace BerylEngine
+{
+	static constexpr BufferStorage arenaStorage = BufferStorage::Dynamic;
+
+	GeometryArena::GeometryArena(const VertexBufferLayout& layout, IndexType indexType, size_t vertexCapacity,
+		size_t indexCapacity)
+		: m_vertexStride(layout.get_stride()),
+		m_indexType(indexType),
+		m_indexSize(indexType == IndexType::UInt16 ? sizeof(uint16_t) : sizeof(uint32_t)),
+		m_vertexBuffer(nullptr, vertexCapacity * layout.get_stride(), arenaStorage),
+		m_indexBuffer(nullptr, indexCapacity * m_indexSize, arenaStorage),
+		m_vertexAllocator(vertexCapacity),
+		m_indexAllocator(indexCapacity)
+	{
+		m_vao = std::make_unique<VertexArray>(m_vertexBuffer, m_indexBuffer, layout);
+
+		spdlog::trace("Geometry arena created for {} vertices and {} indices.", vertexCapacity, indexCapacity);
+	}
+
+	size_t GeometryArena::allocateVertices(size_t count)
+	{
+		size_t offset = m_vertexAllocator.allocate(count);
+		if (offset == OffsetAllocator::InvalidOffset)
+		{
+			const size_t capacity = std::max(m_vertexAllocator.capacity() * 2, m_vertexAllocator.capacity() + count);
+			resizeBuffers(capacity, m_indexAllocator.capacity());
+			offset = m_vertexAllocator.allocate(count);
+		}
+
+		return offset;
+	}
+
+	size_t GeometryArena::allocateIndices(size_t count)
+	{
+		size_t offset = m_indexAllocator.allocate(count);
+		if (offset == OffsetAllocator::InvalidOffset)
+		{
+			const size_t capacity = std::max(m_indexAllocator.capacity() * 2, m_indexAllocator.capacity() + count);
+			resizeBuffers(m_vertexAllocator.capacity(), capacity);
+			offset = m_indexAllocator.allocate(count);
+		}
+
+		return offset;
+	}
+
+	GeometryArena::AllocationId GeometryArena::allocate(const void* vertices, size_t vertexCount,
+		const void* indices, size_t indexCount)
+	{
+		Range range = { 0, (unsigned int)vertexCount, 0, (unsigned int)indexCount };
+
+		if (vertexCount > 0)
+		{
+			range.baseVertex = (unsigned int)allocateVertices(vertexCount);
+			m_vertexBuffer.update(std::span(static_cast<const std::byte*>(vertices), vertexCount * m_vertexStride),
+				size_t(range.baseVertex) * m_vertexStride);
+		}
+
+		if (indexCount > 0)
+		{
+			range.firstIndex = (unsigned int)allocateIndices(indexCount);
+			m_indexBuffer.update(std::span(static_cast<const std::byte*>(indices), indexCount * m_indexSize),
+				size_t(range.firstIndex) * m_indexSize);
+		}
+
+		AllocationId id;
+		if (m_freeIds.empty())
+		{
+			id = AllocationId(m_allocations.size());
+			m_allocations.push_back(range);
+			m_liveAllocations.push_back(true);
+		}
+		else
+		{
+			id = m_freeIds.back();
+			m_freeIds.pop_back();
+			m_allocations[id] = range;
+			m_liveAllocations[id] = true;
+		}
+
+		return id;
+	}
+
+	void GeometryArena::free(AllocationId allocation)
+	{
+		if (allocation >= m_allocations.size() || !m_liveAllocations[allocation])
+		{
+			spdlog::warn("Geometry arena allocation {} freed twice or never allocated.", allocation);
+			return;
+		}
+
+		const Range& range = m_allocations[allocation];
+		if (range.vertexCount > 0)
+			m_vertexAllocator.free(range.baseVertex, range.vertexCount);
+		if (range.indexCount > 0)
+			m_indexAllocator.free(range.firstIndex, range.indexCount);
+
+		m_liveAllocations[allocation] = false;
+		m_freeIds.push_back(allocation);
+	}
+
+	const GeometryArena::Range& GeometryArena::range(AllocationId allocation) const
+	{
+		return m_allocations[allocation];
+	}
+
+	void GeometryArena::resizeBuffers(size_t vertexCapacity, size_t indexCapacity)
+	{
+		ByteBuffer vertexBuffer(nullptr, vertexCapacity * m_vertexStride, arenaStorage);
+		ByteBuffer indexBuffer(nullptr, indexCapacity * m_indexSize, arenaStorage);
+
+		glCopyNamedBufferSubData(m_vertexBuffer.getHandle(), vertexBuffer.getHandle(), 0, 0,
+			std::min(m_vertexBuffer.getSize(), vertexBuffer.getSize()));
+		glCopyNamedBufferSubData(m_indexBuffer.getHandle(), indexBuffer.getHandle(), 0, 0,
+			std::min(m_indexBuffer.getSize(), indexBuffer.getSize()));
+
+		m_vertexBuffer = std::move(vertexBuffer);
+		m_indexBuffer = std::move(indexBuffer);
+		m_vertexAllocator.grow(vertexCapacity);
+		m_indexAllocator.grow(indexCapacity);
+
+		m_vao->setVertexBuffer(m_vertexBuffer, m_vertexStride);
+		m_vao->setIndexBuffer(m_indexBuffer);
+
+		spdlog::debug("Geometry arena resized to {} vertices and {} indices.", vertexCapacity, indexCapacity);
+	}
+
+	void GeometryArena::compact()
+	{
+		ByteBuffer vertexBuffer(nullptr, m_vertexBuffer.getSize(), arenaStorage);
+		ByteBuffer indexBuffer(nullptr, m_indexBuffer.getSize(), arenaStorage);
+
+		unsigned int vertexCursor = 0;
+		unsigned int indexCursor = 0;
+		for (size_t id = 0; id != m_allocations.size(); ++id)
+		{
+			if (!m_liveAllocations[id])
+				continue;
+
+			Range& range = m_allocations[id];
+			if (range.vertexCount > 0)
+			{
+				glCopyNamedBufferSubData(m_vertexBuffer.getHandle(), vertexBuffer.getHandle(),
+					size_t(range.baseVertex) * m_vertexStride, size_t(vertexCursor) * m_vertexStride,
+					size_t(range.vertexCount) * m_vertexStride);
+			}
+			if (range.indexCount > 0)
+			{
+				glCopyNamedBufferSubData(m_indexBuffer.getHandle(), indexBuffer.getHandle(),
+					size_t(range.firstIndex) * m_indexSize, size_t(indexCursor) * m_indexSize,
+					size_t(range.indexCount) * m_indexSize);
+			}
+
+			range.baseVertex = vertexCursor;
+			range.firstIndex = indexCursor;
+			vertexCursor += range.vertexCount;
+			indexCursor += range.indexCount;
+		}
+
+		m_vertexBuffer = std::move(vertexBuffer);
+		m_indexBuffer = std::move(indexBuffer);
+		m_vertexAllocator.reset(vertexCursor);
+		m_indexAllocator.reset(indexCursor);
+
+		m_vao->setVertexBuffer(m_vertexBuffer, m_vertexStride);
+		m_vao->setIndexBuffer(m_indexBuffer);
+
+		spdlog::debug("Geometry arena compacted to {} vertices and {} indices.", vertexCursor, indexCursor);
+	}
+
+	void GeometryArena::bind() const
+	{
+		m_vao->bind();
+	}
+
+	GeometryArena::IndexType GeometryArena::indexType() const
+	{
+		return m_indexType;
+	}
+
+	unsigned int GeometryArena::glIndexType() const
+	{
+		return m_indexType == IndexType::UInt16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	}
+
+	unsigned int GeometryArena::indexSize() const
+	{
+		return m_indexSize;
+	}
+
+	const ByteBuffer& GeometryArena::vertexBuffer() const
+	{
+		return m_vertexBuffer;
+	}
+
+	const ByteBuffer& GeometryArena::indexBuffer() const
+	{
+		return m_indexBuffer;
+	}
+}
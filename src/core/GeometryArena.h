@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ByteBuffer.h"
+#include "OffsetAllocator.h"
+#include "VertexArray.h"
+#include "VertexBufferLayout.h"
+
+namespace BerylEngine
+{
+	/// <summary>
+	/// One vertex buffer and one index buffer shared by every mesh of a given vertex layout.
+	/// Meshes are views (base vertex, first index, count) into it, so they can all be drawn
+	/// through a single vertex array without switching buffers.
+	/// </summary>
+	class GeometryArena : NonCopyable
+	{
+	public:
+		using AllocationId = uint32_t;
+		static constexpr AllocationId InvalidAllocation = ~AllocationId(0);
+
+		enum class IndexType
+		{
+			UInt16,
+			UInt32
+		};
+
+		struct Range
+		{
+			unsigned int baseVertex;
+			unsigned int vertexCount;
+			unsigned int firstIndex;
+			unsigned int indexCount;
+		};
+
+		GeometryArena(const VertexBufferLayout& layout, IndexType indexType, size_t vertexCapacity, size_t indexCapacity);
+
+		/// <summary>
+		/// Copy vertices in the arena's layout and indices of the arena's index type.
+		/// </summary>
+		AllocationId allocate(const void* vertices, size_t vertexCount, const void* indices, size_t indexCount);
+		void free(AllocationId allocation);
+
+		/// <summary>
+		/// Ranges may move when the arena is compacted. Do not keep them across frames.
+		/// </summary>
+		const Range& range(AllocationId allocation) const;
+
+		/// <summary>
+		/// Pack every live allocation at the start of the buffers to get rid of fragmentation.
+		/// </summary>
+		void compact();
+
+		void bind() const;
+
+		IndexType indexType() const;
+		/// <summary>
+		/// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, for draw calls.
+		/// </summary>
+		unsigned int glIndexType() const;
+		unsigned int indexSize() const;
+
+		const ByteBuffer& vertexBuffer() const;
+		const ByteBuffer& indexBuffer() const;
+
+	private:
+		unsigned int m_vertexStride;
+		IndexType m_indexType;
+		unsigned int m_indexSize;
+		ByteBuffer m_vertexBuffer;
+		ByteBuffer m_indexBuffer;
+		std::unique_ptr<VertexArray> m_vao;
+
+		OffsetAllocator m_vertexAllocator;
+		OffsetAllocator m_indexAllocator;
+
+		std::vector<Range> m_allocations;
+		std::vector<bool> m_liveAllocations;
+		std::vector<AllocationId> m_freeIds;
+
+		size_t allocateVertices(size_t count);
+		size_t allocateIndices(size_t count);
+		void resizeBuffers(size_t vertexCapacity, size_t indexCapacity);
+	};
+}
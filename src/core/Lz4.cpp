@@ -0,0 +1,193 @@
+#include "Lz4.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace BerylEngine::Lz4
+{
+	static constexpr size_t MinMatch = 4;
+	// The last match must start at least 12 bytes before the end, the last 5 bytes are always literals
+	static constexpr size_t MatchSearchLimit = 12;
+	static constexpr size_t LastLiterals = 5;
+	static constexpr size_t MaxOffset = 65535;
+	static constexpr int HashBits = 16;
+
+	size_t compressBound(size_t size)
+	{
+		return size + size / 255 + 16;
+	}
+
+	static uint32_t read32(const uint8_t* p)
+	{
+		uint32_t value;
+		std::memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	static uint32_t hashSequence(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	static uint8_t* writeLength(uint8_t* out, size_t length)
+	{
+		while (length >= 255)
+		{
+			*out++ = 255;
+			length -= 255;
+		}
+		*out++ = uint8_t(length);
+		return out;
+	}
+
+	static uint8_t* writeSequence(uint8_t* out, const uint8_t* literals, size_t literalLength, size_t offset,
+									size_t matchLength)
+	{
+		uint8_t* token = out++;
+		*token = uint8_t((literalLength >= 15 ? 15 : literalLength) << 4);
+		if (literalLength >= 15)
+			out = writeLength(out, literalLength - 15);
+
+		if (literalLength > 0)
+			std::memcpy(out, literals, literalLength);
+		out += literalLength;
+
+		if (matchLength == 0)
+			return out;
+
+		*out++ = uint8_t(offset);
+		*out++ = uint8_t(offset >> 8);
+
+		const size_t matchCode = matchLength - MinMatch;
+		*token |= uint8_t(matchCode >= 15 ? 15 : matchCode);
+		if (matchCode >= 15)
+			out = writeLength(out, matchCode - 15);
+
+		return out;
+	}
+
+	size_t compress(std::span<const std::byte> source, std::span<std::byte> destination)
+	{
+		const uint8_t* const begin = reinterpret_cast<const uint8_t*>(source.data());
+		const uint8_t* const end = begin + source.size();
+		uint8_t* out = reinterpret_cast<uint8_t*>(destination.data());
+		uint8_t* const outBegin = out;
+
+		const uint8_t* anchor = begin;
+		if (source.size() > MatchSearchLimit)
+		{
+			// Positions of the last occurrence of each hashed 4-byte sequence
+			std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+			const uint8_t* const matchLimit = end - LastLiterals;
+			const uint8_t* const searchLimit = end - MatchSearchLimit;
+
+			const uint8_t* current = begin + 1;
+			while (current < searchLimit)
+			{
+				const uint32_t sequence = read32(current);
+				const uint32_t hash = hashSequence(sequence);
+				const uint8_t* candidate = begin + table[hash];
+				table[hash] = uint32_t(current - begin);
+
+				if (candidate >= current || size_t(current - candidate) > MaxOffset || read32(candidate) != sequence)
+				{
+					current++;
+					continue;
+				}
+
+				// Extend the match backwards over pending literals, then forwards
+				while (current > anchor && candidate > begin && current[-1] == candidate[-1])
+				{
+					current--;
+					candidate--;
+				}
+
+				size_t matchLength = MinMatch;
+				while (current + matchLength < matchLimit && current[matchLength] == candidate[matchLength])
+					matchLength++;
+
+				out = writeSequence(out, anchor, size_t(current - anchor), size_t(current - candidate), matchLength);
+				current += matchLength;
+				anchor = current;
+
+				if (current < searchLimit)
+					table[hashSequence(read32(current - 2))] = uint32_t(current - 2 - begin);
+			}
+		}
+
+		out = writeSequence(out, anchor, size_t(end - anchor), 0, 0);
+		return size_t(out - outBegin);
+	}
+
+	bool decompress(std::span<const std::byte> source, std::span<std::byte> destination)
+	{
+		const uint8_t* in = reinterpret_cast<const uint8_t*>(source.data());
+		const uint8_t* const inEnd = in + source.size();
+		uint8_t* out = reinterpret_cast<uint8_t*>(destination.data());
+		uint8_t* const outBegin = out;
+		uint8_t* const outEnd = out + destination.size();
+
+		auto readLength = [&](size_t& length)
+		{
+			uint8_t byte;
+			do
+			{
+				if (in == inEnd)
+					return false;
+				byte = *in++;
+				length += byte;
+			} while (byte == 255);
+			return true;
+		};
+
+		while (in < inEnd)
+		{
+			const uint8_t token = *in++;
+
+			size_t literalLength = token >> 4;
+			if (literalLength == 15 && !readLength(literalLength))
+				return false;
+			if (literalLength > size_t(inEnd - in) || literalLength > size_t(outEnd - out))
+				return false;
+
+			if (literalLength > 0)
+				std::memcpy(out, in, literalLength);
+			in += literalLength;
+			out += literalLength;
+
+			// The last sequence has no match
+			if (in == inEnd)
+				break;
+
+			if (inEnd - in < 2)
+				return false;
+			const size_t offset = size_t(in[0]) | (size_t(in[1]) << 8);
+			in += 2;
+			if (offset == 0 || offset > size_t(out - outBegin))
+				return false;
+
+			size_t matchLength = token & 15;
+			if (matchLength == 15 && !readLength(matchLength))
+				return false;
+			matchLength += MinMatch;
+			if (matchLength > size_t(outEnd - out))
+				return false;
+
+			// Matches may overlap their own output, copy byte by byte in that case
+			const uint8_t* match = out - offset;
+			if (offset >= matchLength)
+			{
+				std::memcpy(out, match, matchLength);
+				out += matchLength;
+			}
+			else
+			{
+				for (size_t i = 0; i < matchLength; i++)
+					*out++ = *match++;
+			}
+		}
+
+		return out == outEnd;
+	}
+}
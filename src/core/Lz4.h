@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+/// <summary>
+/// Codec for the LZ4 block format (no frame format), following its end-of-block rules.
+/// </summary>
+namespace BerylEngine::Lz4
+{
+	/// <summary>
+	/// Size of the destination buffer needed to compress size bytes in the worst case.
+	/// </summary>
+	size_t compressBound(size_t size);
+
+	/// <summary>
+	/// Compress source into destination, which must hold compressBound(source.size()) bytes.
+	/// Return the compressed size.
+	/// </summary>
+	size_t compress(std::span<const std::byte> source, std::span<std::byte> destination);
+
+	/// <summary>
+	/// Decompress a block whose decompressed size is exactly destination.size().
+	/// Return false on malformed input, without reading or writing out of bounds.
+	/// </summary>
+	bool decompress(std::span<const std::byte> source, std::span<std::byte> destination);
+}
@@ -0,0 +1,174 @@
+#include "MappedFile.h"
+
+#include <spdlog/spdlog.h>
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace BerylEngine
+{
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& path)
+	{
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			spdlog::error("Failed to open {} for mapping.", path);
+			return;
+		}
+		m_file = file;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size))
+		{
+			spdlog::error("Failed to get size of {}.", path);
+			close();
+			return;
+		}
+		m_size = size_t(size.QuadPart);
+		m_open = true;
+
+		// Empty files cannot be mapped, they are open with no data
+		if (m_size == 0)
+			return;
+
+		m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_mapping != nullptr)
+			m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+
+		if (m_data == nullptr)
+		{
+			spdlog::error("Failed to map {}.", path);
+			close();
+		}
+	}
+
+	void MappedFile::close()
+	{
+		if (m_data != nullptr)
+			UnmapViewOfFile(m_data);
+		if (m_mapping != nullptr)
+			CloseHandle(m_mapping);
+		if (m_file != nullptr)
+			CloseHandle(m_file);
+
+		m_data = nullptr;
+		m_mapping = nullptr;
+		m_file = nullptr;
+		m_size = 0;
+		m_open = false;
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+		: m_data(std::exchange(other.m_data, nullptr)),
+		m_size(std::exchange(other.m_size, 0)),
+		m_open(std::exchange(other.m_open, false)),
+		m_file(std::exchange(other.m_file, nullptr)),
+		m_mapping(std::exchange(other.m_mapping, nullptr))
+	{
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_open, other.m_open);
+		std::swap(m_file, other.m_file);
+		std::swap(m_mapping, other.m_mapping);
+		return *this;
+	}
+#else
+	MappedFile::MappedFile(const std::string& path)
+	{
+		m_file = open(path.c_str(), O_RDONLY);
+		if (m_file < 0)
+		{
+			spdlog::error("Failed to open {} for mapping.", path);
+			return;
+		}
+
+		struct stat status;
+		if (fstat(m_file, &status) != 0)
+		{
+			spdlog::error("Failed to get size of {}.", path);
+			close();
+			return;
+		}
+		m_size = size_t(status.st_size);
+		m_open = true;
+
+		// Empty files cannot be mapped, they are open with no data
+		if (m_size == 0)
+			return;
+
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+		if (data == MAP_FAILED)
+		{
+			spdlog::error("Failed to map {}.", path);
+			close();
+			return;
+		}
+
+		madvise(data, m_size, MADV_SEQUENTIAL);
+		m_data = static_cast<const std::byte*>(data);
+	}
+
+	void MappedFile::close()
+	{
+		if (m_data != nullptr)
+			munmap(const_cast<std::byte*>(m_data), m_size);
+		if (m_file >= 0)
+			::close(m_file);
+
+		m_data = nullptr;
+		m_file = -1;
+		m_size = 0;
+		m_open = false;
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+		: m_data(std::exchange(other.m_data, nullptr)),
+		m_size(std::exchange(other.m_size, 0)),
+		m_open(std::exchange(other.m_open, false)),
+		m_file(std::exchange(other.m_file, -1))
+	{
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_open, other.m_open);
+		std::swap(m_file, other.m_file);
+		return *this;
+	}
+#endif
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+	bool MappedFile::isOpen() const
+	{
+		return m_open;
+	}
+
+	std::span<const std::byte> MappedFile::data() const
+	{
+		return { m_data, m_size };
+	}
+
+	size_t MappedFile::size() const
+	{
+		return m_size;
+	}
+}
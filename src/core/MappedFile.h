@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <string>
+
+#include "utils.h"
+
+namespace BerylEngine
+{
+	/// <summary>
+	/// Read-only memory mapping of a whole file. The file stays mapped while the object lives.
+	/// </summary>
+	class MappedFile : NonCopyable
+	{
+	public:
+		MappedFile() = default;
+
+		/// <summary>
+		/// Map the file at path. Check isOpen() for failures.
+		/// </summary>
+		MappedFile(const std::string& path);
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		~MappedFile();
+
+		bool isOpen() const;
+		std::span<const std::byte> data() const;
+		size_t size() const;
+
+	private:
+		const std::byte* m_data = nullptr;
+		size_t m_size = 0;
+		bool m_open = false;
+
+#ifdef _WIN32
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#else
+		int m_file = -1;
+#endif
+
+		void close();
+	};
+}
@@ -1,6 +1,10 @@
 #include "Material.h"
 
 #include <GL/glew.h>
+#include <algorithm>
+#include <array>
+
+#include "RenderState.h"
 
 namespace BerylEngine
 {
@@ -99,65 +103,106 @@ namespace BerylEngine
 			existIt->first = unit;
 		else
 			m_textures.emplace_back(unit, texture);
+
+		// Keep textures sorted by unit so that contiguous units are bound with a single call
+		std::sort(m_textures.begin(), m_textures.end(),
+			[](const auto& a, const auto& b) { return a.first < b.first; });
 	}
 
 	void Material::bind() const
 	{
 		switch (m_blendMode) {
 		case BlendMode::None:
-			glDisable(GL_BLEND);
-			glEnable(GL_CULL_FACE);
+			RenderState::setCapability(GL_BLEND, false);
 			break;
 
 		case BlendMode::Alpha:
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-			glDisable(GL_CULL_FACE);
+			RenderState::setCapability(GL_BLEND, true);
+			RenderState::setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 			break;
 
 		case BlendMode::Add:
-			glEnable(GL_BLEND);
-			glBlendFunc(GL_SRC_COLOR, GL_ONE);
-			glEnable(GL_CULL_FACE);
+			RenderState::setCapability(GL_BLEND, true);
+			RenderState::setBlendFunc(GL_SRC_COLOR, GL_ONE);
 			break;
 		}
 
 		switch (m_depthMode) {
 		case DepthMode::None:
-			glDisable(GL_DEPTH_TEST);
+			RenderState::setCapability(GL_DEPTH_TEST, false);
 			break;
 
 		case DepthMode::Standard:
-			glEnable(GL_DEPTH_TEST);
-			glDepthFunc(GL_GEQUAL);
+			RenderState::setCapability(GL_DEPTH_TEST, true);
+			RenderState::setDepthFunc(GL_GEQUAL);
 			break;
 
 		case DepthMode::Reversed:
-			glEnable(GL_DEPTH_TEST);
-			glDepthFunc(GL_LEQUAL);
+			RenderState::setCapability(GL_DEPTH_TEST, true);
+			RenderState::setDepthFunc(GL_LEQUAL);
 			break;
 		}
 
 		switch (m_cullMode) {
 		case CullMode::None:
-			glDisable(GL_CULL_FACE);
+			RenderState::setCapability(GL_CULL_FACE, false);
 			break;
 		case CullMode::Frontface:
-			glEnable(GL_CULL_FACE);
-			glCullFace(GL_FRONT);
+			RenderState::setCapability(GL_CULL_FACE, true);
+			RenderState::setCullFace(GL_FRONT);
 			break;
 
 		case CullMode::Backface:
-			glEnable(GL_CULL_FACE);
-			glCullFace(GL_BACK);
+			RenderState::setCapability(GL_CULL_FACE, true);
+			RenderState::setCullFace(GL_BACK);
 			break;
 		}
 
-		glDepthMask(m_writeDepth ? GL_TRUE : GL_FALSE);
+		RenderState::setDepthMask(m_writeDepth);
+
+		std::array<unsigned int, 32> handles;
+		size_t first = 0;
+		while (first < m_textures.size())
+		{
+			size_t count = 0;
+			while (first + count < m_textures.size() && count < handles.size()
+				&& m_textures[first + count].first == m_textures[first].first + int(count))
+			{
+				// Textures still loading are replaced by the placeholder
+				const Texture& texture = *m_textures[first + count].second;
+				handles[count] = texture.isReady() ? texture.getId() : Texture::placeholder().getId();
+				count++;
+			}
+
+			if (count == 1)
+				RenderState::bindTextureUnit(m_textures[first].first, handles[0]);
+			else
+				RenderState::bindTextures(m_textures[first].first, std::span(handles.data(), count));
+
+			first += count;
+		}
 
-		for (const auto& texture : m_textures)
-			texture.second->bindToUnit(texture.first);
+		// Programs still compiling are replaced by the fallback
+		(m_program->isReady() ? *m_program : Program::fallback()).bind();
+	}
 
-		m_program->bind();
+	const std::shared_ptr<Program>& Material::program() const
+	{
+		return m_program;
+	}
+
+	Material::BlendMode Material::blendMode() const
+	{
+		return m_blendMode;
+	}
+
+	bool Material::operator==(const Material& other) const
+	{
+		return m_program == other.m_program
+			&& m_textures == other.m_textures
+			&& m_blendMode == other.m_blendMode
+			&& m_depthMode == other.m_depthMode
+			&& m_writeDepth == other.m_writeDepth
+			&& m_cullMode == other.m_cullMode;
 	}
 }
\ No newline at end of file
@@ -66,6 +66,14 @@ namespace BerylEngine
 
 		void bind() const;
 
+		const std::shared_ptr<Program>& program() const;
+		BlendMode blendMode() const;
+
+		/// <summary>
+		/// Materials are equal when binding either of them results in the same pipeline state.
+		/// </summary>
+		bool operator==(const Material& other) const;
+
 	private:
 		std::shared_ptr<Program> m_program;
 		std::vector<std::pair<int, std::shared_ptr<Texture>>> m_textures;
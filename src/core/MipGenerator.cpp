@@ -0,0 +1,195 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "ThreadPool.h"
+
+namespace BerylEngine::MipGenerator
+{
+	// Half width of the filter in destination texels, and Kaiser window shape: larger alphas trade sharpness
+	// for less ringing
+	static constexpr float FilterRadius = 2.0f;
+	static constexpr float KaiserAlpha = 4.0f;
+
+	// Zeroth order modified Bessel function of the first kind, from its power series
+	static float besselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (int k = 1; k < 32; k++)
+		{
+			term *= (x * 0.5f / float(k)) * (x * 0.5f / float(k));
+			sum += term;
+			if (term < sum * 1e-7f)
+				break;
+		}
+		return sum;
+	}
+
+	static float sinc(float x)
+	{
+		if (std::abs(x) < 1e-5f)
+			return 1.0f;
+
+		const float pix = glm::pi<float>() * x;
+		return std::sin(pix) / pix;
+	}
+
+	// x is in destination texels
+	static float kaiserSinc(float x)
+	{
+		const float t = x / FilterRadius;
+		if (std::abs(t) >= 1.0f)
+			return 0.0f;
+
+		return sinc(x) * besselI0(KaiserAlpha * std::sqrt(1.0f - t * t)) / besselI0(KaiserAlpha);
+	}
+
+	// Source texels and normalized weights contributing to each destination texel along one axis
+	struct FilterTaps
+	{
+		std::vector<int> first;
+		std::vector<int> count;
+		std::vector<int> sources;
+		std::vector<float> weights;
+	};
+
+	static FilterTaps computeTaps(int sourceSize, int destinationSize)
+	{
+		const float scale = float(sourceSize) / float(destinationSize);
+		const float support = FilterRadius * scale;
+
+		FilterTaps taps;
+		for (int i = 0; i < destinationSize; i++)
+		{
+			const float center = (float(i) + 0.5f) * scale;
+			const int begin = int(std::floor(center - support));
+			const int end = int(std::ceil(center + support));
+
+			const size_t first = taps.weights.size();
+			float total = 0.0f;
+			for (int j = begin; j <= end; j++)
+			{
+				const float weight = kaiserSinc((float(j) + 0.5f - center) / scale);
+				if (weight == 0.0f)
+					continue;
+
+				taps.sources.push_back(std::clamp(j, 0, sourceSize - 1));
+				taps.weights.push_back(weight);
+				total += weight;
+			}
+
+			for (size_t k = first; k < taps.weights.size(); k++)
+				taps.weights[k] /= total;
+			taps.first.push_back(int(first));
+			taps.count.push_back(int(taps.weights.size() - first));
+		}
+		return taps;
+	}
+
+	static float srgbToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	static float linearToSrgb(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// Separable filtering of a float RGBA image to half size, rows first
+	static std::vector<glm::vec4> downsample(const std::vector<glm::vec4>& source, int width, int height,
+											 int halfWidth, int halfHeight)
+	{
+		const FilterTaps horizontal = computeTaps(width, halfWidth);
+		const FilterTaps vertical = computeTaps(height, halfHeight);
+
+		std::vector<glm::vec4> rows(size_t(halfWidth) * height);
+		ThreadPool::global().parallelFor(size_t(height), [&](size_t y)
+			{
+				const glm::vec4* sourceRow = &source[y * width];
+				for (int x = 0; x < halfWidth; x++)
+				{
+					glm::vec4 sum(0.0f);
+					for (int k = horizontal.first[x]; k < horizontal.first[x] + horizontal.count[x]; k++)
+						sum += sourceRow[horizontal.sources[k]] * horizontal.weights[k];
+					rows[y * halfWidth + x] = sum;
+				}
+			});
+
+		std::vector<glm::vec4> half(size_t(halfWidth) * halfHeight);
+		ThreadPool::global().parallelFor(size_t(halfHeight), [&](size_t y)
+			{
+				for (int x = 0; x < halfWidth; x++)
+				{
+					glm::vec4 sum(0.0f);
+					for (int k = vertical.first[y]; k < vertical.first[y] + vertical.count[y]; k++)
+						sum += rows[size_t(vertical.sources[k]) * halfWidth + x] * vertical.weights[k];
+					half[y * halfWidth + x] = sum;
+				}
+			});
+
+		return half;
+	}
+
+	static std::vector<unsigned char> encode(const std::vector<glm::vec4>& level, Content content)
+	{
+		std::vector<unsigned char> pixels(level.size() * 4);
+		ThreadPool::global().parallelFor((level.size() + 1023) / 1024, [&](size_t chunk)
+			{
+				const size_t end = std::min(level.size(), (chunk + 1) * 1024);
+				for (size_t i = chunk * 1024; i < end; i++)
+				{
+					// Negative lobes of the filter may overshoot
+					glm::vec4 value = glm::clamp(level[i], 0.0f, 1.0f);
+					if (content == Content::Color)
+						value = glm::vec4(linearToSrgb(value.r), linearToSrgb(value.g), linearToSrgb(value.b), value.a);
+					else if (content == Content::NormalMap)
+					{
+						const glm::vec3 normal = glm::vec3(level[i]) * 2.0f - 1.0f;
+						const float length = glm::length(normal);
+						if (length > 1e-6f)
+							value = glm::vec4(normal / length * 0.5f + 0.5f, value.a);
+					}
+
+					for (int c = 0; c < 4; c++)
+						pixels[i * 4 + c] = (unsigned char)std::lround(value[c] * 255.0f);
+				}
+			});
+		return pixels;
+	}
+
+	std::vector<std::vector<unsigned char>> generate(std::span<const unsigned char> pixels, int width, int height,
+													 Content content)
+	{
+		std::array<float, 256> toLinear;
+		for (int i = 0; i < 256; i++)
+			toLinear[i] = content == Content::Color ? srgbToLinear(float(i) / 255.0f) : float(i) / 255.0f;
+
+		std::vector<glm::vec4> level(size_t(width) * height);
+		for (size_t i = 0; i < level.size(); i++)
+		{
+			level[i] = glm::vec4(toLinear[pixels[i * 4]], toLinear[pixels[i * 4 + 1]], toLinear[pixels[i * 4 + 2]],
+				float(pixels[i * 4 + 3]) / 255.0f);
+		}
+
+		std::vector<std::vector<unsigned char>> levels;
+		levels.emplace_back(pixels.begin(), pixels.end());
+		while (width > 1 || height > 1)
+		{
+			const int halfWidth = std::max(width / 2, 1);
+			const int halfHeight = std::max(height / 2, 1);
+			level = downsample(level, width, height, halfWidth, halfHeight);
+			levels.push_back(encode(level, content));
+
+			width = halfWidth;
+			height = halfHeight;
+		}
+
+		return levels;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+/// <summary>
+/// CPU generation of mip chains, so that they can be cooked and compressed ahead of the GPU.
+/// </summary>
+namespace BerylEngine::MipGenerator
+{
+	/// <summary>
+	/// How the channels of an image are filtered.
+	/// - Color: RGB is sRGB encoded and filtered in linear space, so that mips keep the image's brightness.
+	/// - Linear: every channel is filtered as is, for data such as masks.
+	/// - NormalMap: RGB is a unit vector, filtered as is and renormalized.
+	/// Alpha is always filtered as is.
+	/// </summary>
+	enum class Content
+	{
+		Color,
+		Linear,
+		NormalMap
+	};
+
+	/// <summary>
+	/// Mip chain of an RGBA8 image, from the image itself down to 1x1, with a Kaiser-windowed sinc filter.
+	/// Each level is filtered from the previous one at full precision. Edges are clamped.
+	/// </summary>
+	std::vector<std::vector<unsigned char>> generate(std::span<const unsigned char> pixels, int width, int height,
+													 Content content);
+}
@@ -0,0 +1,134 @@
+#include "OffsetAllocator.h"
+
+#include <iterator>
+
+#include "utils.h"
+
+namespace BerylEngine
+{
+	OffsetAllocator::OffsetAllocator(size_t capacity)
+		: m_capacity(capacity)
+	{
+		if (capacity > 0)
+			insertFreeBlock(0, capacity);
+	}
+
+	void OffsetAllocator::insertFreeBlock(size_t offset, size_t size)
+	{
+		m_freeByOffset.emplace(offset, size);
+		m_freeBySize.emplace(size, offset);
+	}
+
+	void OffsetAllocator::eraseFreeBlock(std::map<size_t, size_t>::iterator it)
+	{
+		auto range = m_freeBySize.equal_range(it->second);
+		for (auto sizeIt = range.first; sizeIt != range.second; ++sizeIt)
+		{
+			if (sizeIt->second == it->first)
+			{
+				m_freeBySize.erase(sizeIt);
+				break;
+			}
+		}
+
+		m_freeByOffset.erase(it);
+	}
+
+	size_t OffsetAllocator::allocate(size_t size)
+	{
+		if (size == 0)
+			return InvalidOffset;
+
+		auto bestFit = m_freeBySize.lower_bound(size);
+		if (bestFit == m_freeBySize.end())
+			return InvalidOffset;
+
+		const size_t blockSize = bestFit->first;
+		const size_t offset = bestFit->second;
+		eraseFreeBlock(m_freeByOffset.find(offset));
+
+		if (blockSize > size)
+			insertFreeBlock(offset + size, blockSize - size);
+
+		m_usedSize += size;
+
+		return offset;
+	}
+
+	void OffsetAllocator::free(size_t offset, size_t size)
+	{
+		if (size == 0)
+			return;
+
+		size_t blockOffset = offset;
+		size_t blockSize = size;
+
+		auto next = m_freeByOffset.lower_bound(offset);
+		if (next != m_freeByOffset.end() && next->first == offset + size)
+		{
+			blockSize += next->second;
+			auto toErase = next++;
+			eraseFreeBlock(toErase);
+		}
+
+		if (next != m_freeByOffset.begin())
+		{
+			auto previous = std::prev(next);
+			if (previous->first + previous->second == offset)
+			{
+				blockOffset = previous->first;
+				blockSize += previous->second;
+				eraseFreeBlock(previous);
+			}
+		}
+
+		insertFreeBlock(blockOffset, blockSize);
+		m_usedSize -= size;
+	}
+
+	void OffsetAllocator::grow(size_t capacity)
+	{
+		if (capacity <= m_capacity)
+			return;
+
+		const size_t oldCapacity = m_capacity;
+		m_capacity = capacity;
+
+		// Freeing the new tail merges it with a trailing free block if there is one.
+		m_usedSize += capacity - oldCapacity;
+		free(oldCapacity, capacity - oldCapacity);
+	}
+
+	void OffsetAllocator::reset(size_t usedSize)
+	{
+		if (usedSize > m_capacity)
+			FATAL("Offset allocator reset beyond its capacity");
+
+		m_freeByOffset.clear();
+		m_freeBySize.clear();
+		m_usedSize = usedSize;
+
+		if (usedSize < m_capacity)
+			insertFreeBlock(usedSize, m_capacity - usedSize);
+	}
+
+	size_t OffsetAllocator::capacity() const
+	{
+		return m_capacity;
+	}
+
+	size_t OffsetAllocator::usedSize() const
+	{
+		return m_usedSize;
+	}
+
+	size_t OffsetAllocator::largestFreeBlock() const
+	{
+		return m_freeBySize.empty() ? 0 : m_freeBySize.rbegin()->first;
+	}
+
+	size_t OffsetAllocator::freeBlockCount() const
+	{
+		return m_freeByOffset.size();
+	}
+}
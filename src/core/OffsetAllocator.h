@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+
+namespace BerylEngine
+{
+	/// <summary>
+	/// Best-fit allocator handing out ranges of an abstract address space (e.g. elements of a GPU buffer).
+	/// Free blocks are indexed by offset for coalescing and by size for O(log n) best-fit lookups.
+	/// </summary>
+	class OffsetAllocator
+	{
+	public:
+		static constexpr size_t InvalidOffset = ~size_t(0);
+
+		OffsetAllocator(size_t capacity);
+
+		/// <summary>
+		/// Return the offset of a free range of the given size, or InvalidOffset when none is big enough.
+		/// </summary>
+		size_t allocate(size_t size);
+		void free(size_t offset, size_t size);
+
+		/// <summary>
+		/// Extend the address space. Existing allocations are kept.
+		/// </summary>
+		void grow(size_t capacity);
+
+		/// <summary>
+		/// Forget all allocations, then mark [0, usedSize) as allocated.
+		/// </summary>
+		void reset(size_t usedSize);
+
+		size_t capacity() const;
+		size_t usedSize() const;
+		size_t largestFreeBlock() const;
+		size_t freeBlockCount() const;
+
+	private:
+		size_t m_capacity;
+		size_t m_usedSize = 0;
+		std::map<size_t, size_t> m_freeByOffset;
+		std::multimap<size_t, size_t> m_freeBySize;
+
+		void insertFreeBlock(size_t offset, size_t size);
+		void eraseFreeBlock(std::map<size_t, size_t>::iterator it);
+	};
+}
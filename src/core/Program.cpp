@@ -2,9 +2,16 @@
 
 #include <GL/glew.h>
 #include <glm/ext.hpp>
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <spdlog/spdlog.h>
-#include <sstream>
+#include <vector>
+
+#include "ProgramBinaryCache.h"
+#include "RenderState.h"
+#include "ShaderPreprocessor.h"
+#include "ThreadPool.h"
 
 namespace BerylEngine
 {
@@ -25,14 +32,20 @@ namespace BerylEngine
 		}
 	}
 
-	static unsigned int compileShader(const std::string& source, unsigned int type)
+	// Start compiling without waiting for the result, which checkShader() reads
+	static unsigned int submitShader(const ShaderStage& stage)
 	{
-		unsigned int id = glCreateShader(type);
+		unsigned int id = glCreateShader(stage.type);
 
-		const GLchar* src = source.c_str();
+		const GLchar* src = stage.source.c_str();
 		glShaderSource(id, 1, &src, 0);
 		glCompileShader(id);
 
+		return id;
+	}
+
+	static bool checkShader(const ShaderStage& stage, unsigned int id)
+	{
 		GLint compile_status = GL_TRUE;
 		glGetShaderiv(id, GL_COMPILE_STATUS, &compile_status);
 
@@ -43,23 +56,23 @@ namespace BerylEngine
 			if (log != nullptr) {
 				glGetShaderInfoLog(id, log_size, &log_size, log);
 
-				spdlog::error("Failed to compile {} shader:\n{}", glShader2Str(type), log);
+				// Messages locate lines as source string number and line, the number indexes the files
+				std::string files;
+				for (size_t i = 0; i < stage.files.size(); i++)
+					files += fmt::format("\n{}: {}", i, stage.files[i]);
+
+				spdlog::error("Failed to compile {} shader:\n{}{}", glShader2Str(stage.type), log, files);
 				std::free(log);
 			}
 
-			glDeleteShader(id);
-
-			return 0;
+			return false;
 		}
 
-		return id;
-
+		return true;
 	}
 
-	static bool linkProgram(unsigned int programId)
+	static bool checkLink(unsigned int programId)
 	{
-		glLinkProgram(programId);
-
 		GLint link_status = GL_TRUE;
 		glGetProgramiv(programId, GL_LINK_STATUS, &link_status);
 
@@ -81,193 +94,324 @@ namespace BerylEngine
 		return true;
 	}
 
-	Program::Program(const std::string& compute_src)
+	// Attach the shaders and start linking. Retrievable programs can be saved with glGetProgramBinary.
+	static unsigned int submitProgram(std::span<const unsigned int> shaders, bool retrievable)
+	{
+		unsigned int programId = glCreateProgram();
+		for (unsigned int shader : shaders)
+			glAttachShader(programId, shader);
+
+		if (retrievable)
+			glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+		glLinkProgram(programId);
+		return programId;
+	}
+
+	// Check the shaders only when linking failed, so that a successful build waits on a single query
+	static bool checkProgram(unsigned int programId, std::span<const ShaderStage> stages,
+							 std::span<const unsigned int> shaders)
 	{
-		m_handle = glCreateProgram();
+		GLint link_status = GL_TRUE;
+		glGetProgramiv(programId, GL_LINK_STATUS, &link_status);
+		if (link_status == GL_TRUE)
+			return true;
+
+		bool compiled = true;
+		for (size_t i = 0; i < stages.size(); i++)
+			compiled = checkShader(stages[i], shaders[i]) && compiled;
 
-		auto compute = compileShader(compute_src, GL_COMPUTE_SHADER);
+		return compiled ? checkLink(programId) : false;
+	}
 
-		glAttachShader(m_handle, compute);
+	// Compile and link the stages, return 0 on failure
+	static unsigned int linkStages(std::span<const ShaderStage> stages, bool retrievable)
+	{
+		std::vector<unsigned int> shaders;
+		for (const ShaderStage& stage : stages)
+			shaders.push_back(submitShader(stage));
 
-		bool linkSuccess = linkProgram(m_handle);
+		unsigned int programId = submitProgram(shaders, retrievable);
+		const bool linkSuccess = checkProgram(programId, stages, shaders);
 
-		glDeleteShader(compute);
+		for (unsigned int shader : shaders)
+			glDeleteShader(shader);
 
 		if (!linkSuccess)
 		{
-			glDeleteProgram(m_handle);
+			glDeleteProgram(programId);
+			return 0;
 		}
 
-		fetchUniformLocations();
+		return programId;
+	}
+
+	Program::Program(unsigned int handle, std::unique_ptr<PendingBuild> pending)
+		: m_handle(handle), m_pending(std::move(pending)), m_ready(handle != 0 && !m_pending)
+	{
+		if (m_ready)
+			fetchUniformLocations();
+	}
+
+	Program::Program(const std::string& compute_src)
+		: Program(linkStages(std::array{ ShaderStage{ GL_COMPUTE_SHADER, compute_src } }, false))
+	{
 	}
 
 	Program::Program(const std::string& vertex_src, const std::string& fragment_src)
+		: Program(linkStages(std::array{ ShaderStage{ GL_VERTEX_SHADER, vertex_src },
+			ShaderStage{ GL_FRAGMENT_SHADER, fragment_src } }, false))
 	{
-		m_handle = glCreateProgram();
+	}
 
-		auto vertex = compileShader(vertex_src, GL_VERTEX_SHADER);
-		auto fragment = compileShader(fragment_src, GL_FRAGMENT_SHADER);
+	Program::Program(const std::string& vertex_src, const std::string& geometry_src, const std::string& fragment_src)
+		: Program(linkStages(std::array{ ShaderStage{ GL_VERTEX_SHADER, vertex_src },
+			ShaderStage{ GL_GEOMETRY_SHADER, geometry_src }, ShaderStage{ GL_FRAGMENT_SHADER, fragment_src } }, false))
+	{
+	}
 
-		glAttachShader(m_handle, vertex);
-		glAttachShader(m_handle, fragment);
+	static Program::BuildStats s_buildStats;
 
-		bool linkSuccess = linkProgram(m_handle);
+	static double elapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
 
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
+	std::shared_ptr<Program> Program::fromStages(std::span<const ShaderStage> stages)
+	{
+		const auto start = std::chrono::steady_clock::now();
 
-		if (!linkSuccess)
+		// A key of 0 means the driver cannot save binaries
+		const uint64_t key = ProgramBinaryCache::key(stages);
+		unsigned int handle = key != 0 ? ProgramBinaryCache::load(key) : 0;
+		const bool cached = handle != 0;
+		if (!cached)
 		{
-			glDeleteProgram(m_handle);
+			handle = linkStages(stages, key != 0);
+			if (handle != 0 && key != 0)
+				ProgramBinaryCache::store(key, handle);
 		}
 
-		fetchUniformLocations();
+		const double duration = elapsedMs(start);
+		spdlog::debug("Program {} {} in {:.1f} ms.", handle, cached ? "loaded from its binary" : "built from source",
+			duration);
+		s_buildStats.buildMs += duration;
+		if (handle == 0)
+			s_buildStats.failed++;
+		else if (cached)
+			s_buildStats.fromBinary++;
+		else
+			s_buildStats.fromSource++;
+
+		return std::shared_ptr<Program>(new Program(handle));
 	}
 
-	Program::Program(const std::string& vertex_src, const std::string& geometry_src, const std::string& fragment_src)
+	std::shared_ptr<Program> Program::submitStages(std::vector<ShaderStage> stages)
 	{
-		m_handle = glCreateProgram();
+		const auto start = std::chrono::steady_clock::now();
 
-		auto vertex = compileShader(vertex_src, GL_VERTEX_SHADER);
-		auto geometry = compileShader(geometry_src, GL_GEOMETRY_SHADER);
-		auto fragment = compileShader(fragment_src, GL_FRAGMENT_SHADER);
+		const uint64_t key = ProgramBinaryCache::key(stages);
+		if (key != 0)
+		{
+			if (unsigned int handle = ProgramBinaryCache::load(key))
+			{
+				s_buildStats.fromBinary++;
+				s_buildStats.buildMs += elapsedMs(start);
+				return std::shared_ptr<Program>(new Program(handle));
+			}
+		}
+
+		auto pending = std::make_unique<PendingBuild>();
+		for (const ShaderStage& stage : stages)
+			pending->shaders.push_back(submitShader(stage));
+		pending->binaryKey = key;
 
-		glAttachShader(m_handle, vertex);
-		glAttachShader(m_handle, geometry);
-		glAttachShader(m_handle, fragment);
+		const unsigned int handle = submitProgram(pending->shaders, key != 0);
+		pending->stages = std::move(stages);
+		s_buildStats.compiling++;
+		s_buildStats.buildMs += elapsedMs(start);
 
-		bool linkSuccess = linkProgram(m_handle);
+		return std::shared_ptr<Program>(new Program(handle, std::move(pending)));
+	}
 
-		glDeleteShader(vertex);
-		glDeleteShader(geometry);
-		glDeleteShader(fragment);
+	static bool parallelCompileSupported()
+	{
+		return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+	}
 
-		if (!linkSuccess)
+	bool Program::isReady()
+	{
+		if (!m_pending)
+			return m_ready;
+
+		if (parallelCompileSupported())
 		{
-			glDeleteProgram(m_handle);
+			GLint completed = GL_FALSE;
+			glGetProgramiv(m_handle, GL_COMPLETION_STATUS_KHR, &completed);
+			if (completed != GL_TRUE)
+				return false;
 		}
 
-		fetchUniformLocations();
+		finishBuild();
+		return m_ready;
 	}
 
-	Program::~Program()
+	bool Program::hasFailed() const
 	{
-		glDeleteProgram(m_handle);
+		return !m_ready && !m_pending;
 	}
 
-	static std::string retrieveInclude(const std::string& includeLine, const std::string& startPath)
+	void Program::finishBuild()
 	{
-		char startGuard = '\"';
-		size_t startGuardPos = includeLine.find(startGuard);
-		if (startGuardPos == std::string::npos)
+		const auto start = std::chrono::steady_clock::now();
+		const bool linkSuccess = checkProgram(m_handle, m_pending->stages, m_pending->shaders);
+
+		for (unsigned int shader : m_pending->shaders)
+			glDeleteShader(shader);
+
+		if (linkSuccess)
 		{
-			startGuard = '<';
-			startGuardPos = includeLine.find(startGuard);
-			if (startGuardPos == std::string::npos)
-			{
-				spdlog::warn("Include first guard not found. Nothing will be included.");
-				return "";
-			}
+			fetchUniformLocations();
+			if (m_pending->binaryKey != 0)
+				ProgramBinaryCache::store(m_pending->binaryKey, m_handle);
+			spdlog::debug("Program {} built asynchronously.", m_handle);
 		}
-
-		size_t endGuardPos = includeLine.find(startGuard == '\"' ? '\"' : '>', startGuardPos + 1);
-		if (endGuardPos == std::string::npos)
+		else
 		{
-			spdlog::warn("Include second guard not found. Nothing will be included.");
-			return "";
+			glDeleteProgram(m_handle);
+			m_handle = 0;
 		}
 
-		const std::string includePath = includeLine.substr(startGuardPos + 1, endGuardPos - startGuardPos - 1);
-		std::ifstream stream(startPath + includePath);
-		std::stringstream includeContent;
-		if (stream.is_open())
-			includeContent << stream.rdbuf();
-		else
-			spdlog::warn("Include {} not found. Nothing will be included.\nInclude path was evaluated at {}.",
-				includePath, startPath + includePath);
+		m_ready = linkSuccess;
+		m_pending.reset();
+
+		s_buildStats.compiling--;
+		(linkSuccess ? s_buildStats.fromSource : s_buildStats.failed)++;
+		s_buildStats.buildMs += elapsedMs(start);
+	}
 
-		return includeContent.str();
+	static std::shared_ptr<Program> s_fallback;
+
+	Program& Program::fallback()
+	{
+		if (!s_fallback)
+			s_fallback = fromFiles("shaders/fallback.vert", "shaders/fallback.frag");
+
+		return *s_fallback;
+	}
+
+	void Program::releaseFallback()
+	{
+		s_fallback.reset();
 	}
 
-	static std::string loadShaderFile(const std::string& path, std::span<std::string> defines)
+	const Program::BuildStats& Program::buildStats()
 	{
-		std::ifstream stream(path);
-		std::stringstream shader;
-		if (stream.is_open())
+		return s_buildStats;
+	}
+
+	void Program::logBuildStats()
+	{
+		spdlog::info("Programs: {} loaded from binaries, {} built from source, {} failed, {} still compiling. "
+			"{:.1f} ms spent building.", s_buildStats.fromBinary, s_buildStats.fromSource, s_buildStats.failed,
+			s_buildStats.compiling, s_buildStats.buildMs);
+	}
+
+	Program::~Program()
+	{
+		// Abandoned while compiling, it will never be checked
+		if (m_pending)
 		{
-			size_t folderPathEnd = path.find_last_of("\\/");
-			const std::string folderPath = folderPathEnd == std::string::npos ? "./"
-				: path.substr(0, folderPathEnd + 1);
+			for (unsigned int shader : m_pending->shaders)
+				glDeleteShader(shader);
+			s_buildStats.compiling--;
+		}
 
-			std::string line;
-			bool isFirstLine = true;
-			while (std::getline(stream, line))
-			{
-				if (isFirstLine)
-				{
-					if (line.starts_with("#version"))
-					{
-						shader << line << "\n";
-						for (const auto& def : defines)
-							shader << "#define " << def << " 1\n";
-					}
-					else
-					{
-						spdlog::warn("Loading of {} was cancelled as it does not specify GLSL version on first line.",
-							path);
-						return "";
-					}
-
-					isFirstLine = false;
-					continue;
-				}
-
-				if (line[0] == '#')
-				{
-					if (line.starts_with("#include"))
-						shader << retrieveInclude(line, folderPath) << "\n";
-					else
-						shader << line << "\n";
-				}
-				else
-					shader << line << "\n";
-			}
+		glDeleteProgram(m_handle);
+	}
+
+	static ShaderStage loadShaderFile(unsigned int type, const std::string& path, std::span<const std::string> defines)
+	{
+		ShaderStage stage = { type };
+		ShaderPreprocessor::PreprocessedShader shader;
+		if (ShaderPreprocessor::global().preprocess(path, defines, shader))
+		{
+			stage.source = std::move(shader.source);
+			stage.files = std::move(shader.files);
 		}
 
-		return shader.str();
+		return stage;
 	}
 
 	std::shared_ptr<Program> Program::fromFiles(const std::string& compute_path, std::span<std::string> defines)
 	{
-		auto compute_src = loadShaderFile(compute_path, defines);
+		const ShaderStage stages[] = { loadShaderFile(GL_COMPUTE_SHADER, compute_path, defines) };
 
 		spdlog::debug("Generating program from:\n- Compute: {}", compute_path);
 
-		return std::make_shared<Program>(compute_src);
+		return fromStages(stages);
 	}
 
 	std::shared_ptr<Program> Program::fromFiles(const std::string& vertex_path, const std::string& fragment_path,
 												std::span<std::string> defines)
 	{
-		auto vertex_src = loadShaderFile(vertex_path, defines);
-		auto fragment_src = loadShaderFile(fragment_path, defines);
+		const ShaderStage stages[] = {
+			loadShaderFile(GL_VERTEX_SHADER, vertex_path, defines),
+			loadShaderFile(GL_FRAGMENT_SHADER, fragment_path, defines)
+		};
 
 		spdlog::debug("Generating program from:\n- Vertex: {}\n- Fragment: {}", vertex_path, fragment_path);
 
-		return std::make_shared<Program>(vertex_src, fragment_src);
+		return fromStages(stages);
 	}
 
 	std::shared_ptr<Program> Program::fromFiles(const std::string& vertex_path, const std::string& geometry_path,
 												const std::string& fragment_path, std::span<std::string> defines)
 	{
-		auto vertex_src = loadShaderFile(vertex_path, defines);
-		auto geometry_src = loadShaderFile(geometry_path, defines);
-		auto fragment_src = loadShaderFile(fragment_path, defines);
+		const ShaderStage stages[] = {
+			loadShaderFile(GL_VERTEX_SHADER, vertex_path, defines),
+			loadShaderFile(GL_GEOMETRY_SHADER, geometry_path, defines),
+			loadShaderFile(GL_FRAGMENT_SHADER, fragment_path, defines)
+		};
 
 		spdlog::debug("Generating program from:\n- Vertex: {}\n- Geometry: {}\n- Fragment: {}", vertex_path,
 			geometry_path, fragment_path);
 
-		return std::make_shared<Program>(vertex_src, geometry_src, fragment_src);
+		return fromStages(stages);
+	}
+
+	static std::vector<ShaderStage> loadStages(const ProgramFiles& program)
+	{
+		const std::span<const std::string> defines = program.defines;
+		if (!program.computePath.empty())
+			return { loadShaderFile(GL_COMPUTE_SHADER, program.computePath, defines) };
+
+		std::vector<ShaderStage> stages;
+		stages.push_back(loadShaderFile(GL_VERTEX_SHADER, program.vertexPath, defines));
+		if (!program.geometryPath.empty())
+			stages.push_back(loadShaderFile(GL_GEOMETRY_SHADER, program.geometryPath, defines));
+		stages.push_back(loadShaderFile(GL_FRAGMENT_SHADER, program.fragmentPath, defines));
+		return stages;
+	}
+
+	std::vector<std::shared_ptr<Program>> Program::fromFilesAsync(std::span<const ProgramFiles> programs)
+	{
+		// Preprocessing is plain CPU work, only the GL calls have to stay on this thread
+		std::vector<std::vector<ShaderStage>> stages(programs.size());
+		ThreadPool::global().parallelFor(programs.size(), [&](size_t i) { stages[i] = loadStages(programs[i]); });
+
+		std::vector<std::shared_ptr<Program>> submitted;
+		for (std::vector<ShaderStage>& programStages : stages)
+			submitted.push_back(submitStages(std::move(programStages)));
+
+		spdlog::debug("Submitted {} programs for compilation.", submitted.size());
+
+		return submitted;
+	}
+
+	std::shared_ptr<Program> Program::fromFilesAsync(const ProgramFiles& program)
+	{
+		return submitStages(loadStages(program));
 	}
 
 	std::shared_ptr<Program> Program::fromFiles(const std::string& compute_path)
@@ -289,7 +433,7 @@ namespace BerylEngine
 
 	void Program::bind()
 	{
-		glUseProgram(m_handle);
+		RenderState::useProgram(m_handle);
 	}
 
 	void Program::fetchUniformLocations()
@@ -297,6 +441,8 @@ namespace BerylEngine
 		int uniform_count = 0;
 		glGetProgramiv(m_handle, GL_ACTIVE_UNIFORMS, &uniform_count);
 
+		m_uniformLocations.clear();
+		m_uniformLocations.reserve(uniform_count);
 		for (int i = 0; i != uniform_count; ++i) {
 			char name[1024] = {};
 			int len = 0;
@@ -305,56 +451,89 @@ namespace BerylEngine
 
 			glGetActiveUniform(m_handle, i, sizeof(name), &len, &discard, &type, name);
 
-			m_uniformLocations.emplace(name, glGetUniformLocation(m_handle, name));
+			m_uniformLocations.emplace_back(UniformName(std::string_view(name, len)).hash, glGetUniformLocation(m_handle, name));
+		}
+
+		std::sort(m_uniformLocations.begin(), m_uniformLocations.end());
+		for (size_t i = 1; i < m_uniformLocations.size(); i++)
+		{
+			if (m_uniformLocations[i].first == m_uniformLocations[i - 1].first)
+				spdlog::error("Two uniforms of program {} have the same name hash, one of them cannot be set.", m_handle);
 		}
 	}
 
-	int Program::getUniformLocation(const char* name) const
+	int Program::getUniformLocation(UniformName name) const
 	{
-		if (m_uniformLocations.find(name) == m_uniformLocations.end())
+		auto it = std::lower_bound(m_uniformLocations.begin(), m_uniformLocations.end(), name.hash,
+			[](const std::pair<uint64_t, int>& entry, uint64_t hash) { return entry.first < hash; });
+		if (it == m_uniformLocations.end() || it->first != name.hash)
 			return -1;
 
-		return m_uniformLocations.at(name);
+		return it->second;
+	}
+
+	void Program::setUniform(Uniform<int> uniform, int v0) const
+	{
+		glProgramUniform1i(m_handle, uniform.location, v0);
+	}
+
+	void Program::setUniform(Uniform<float> uniform, float v0) const
+	{
+		glProgramUniform1f(m_handle, uniform.location, v0);
+	}
+
+	void Program::setUniform(Uniform<glm::vec3> uniform, const glm::vec3& v) const
+	{
+		glProgramUniform3f(m_handle, uniform.location, v.x, v.y, v.z);
+	}
+
+	void Program::setUniform(Uniform<glm::vec4> uniform, const glm::vec4& v) const
+	{
+		glProgramUniform4f(m_handle, uniform.location, v.x, v.y, v.z, v.w);
+	}
+
+	void Program::setUniform(Uniform<glm::mat3> uniform, const glm::mat3& matrix, bool transpose) const
+	{
+		glProgramUniformMatrix3fv(m_handle, uniform.location, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(matrix));
+	}
+
+	void Program::setUniform(Uniform<glm::mat4> uniform, const glm::mat4& matrix, bool transpose) const
+	{
+		glProgramUniformMatrix4fv(m_handle, uniform.location, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(matrix));
 	}
 
-	void Program::setUniform(const char* name, int v0) const
+	void Program::setUniform(UniformName name, int v0) const
 	{
-		int location = getUniformLocation(name);
-		glProgramUniform1i(m_handle, location, v0);
+		setUniform(uniform<int>(name), v0);
 	}
 
-	void Program::setUniform(const char* name, float v0) const
+	void Program::setUniform(UniformName name, float v0) const
 	{
-		int location = getUniformLocation(name);
-		glProgramUniform1f(m_handle, location, v0);
+		setUniform(uniform<float>(name), v0);
 	}
 
-	void Program::setUniform(const char* name, float v0, float v1, float v2) const
+	void Program::setUniform(UniformName name, float v0, float v1, float v2) const
 	{
-		int location = getUniformLocation(name);
-		glProgramUniform3f(m_handle, location, v0, v1, v2);
+		setUniform(uniform<glm::vec3>(name), glm::vec3(v0, v1, v2));
 	}
 
-	void Program::setUniform(const char* name, const glm::vec3& v) const
+	void Program::setUniform(UniformName name, const glm::vec3& v) const
 	{
-		setUniform(name, v.x, v.y, v.z);
+		setUniform(uniform<glm::vec3>(name), v);
 	}
 
-	void Program::setUniform(const char* name, float v0, float v1, float v2, float v3) const
+	void Program::setUniform(UniformName name, float v0, float v1, float v2, float v3) const
 	{
-		int location = getUniformLocation(name);
-		glProgramUniform4f(m_handle, location, v0, v1, v2, v3);
+		setUniform(uniform<glm::vec4>(name), glm::vec4(v0, v1, v2, v3));
 	}
 
-	void Program::setUniform(const char* name, const glm::mat3& matrix, bool transpose) const
+	void Program::setUniform(UniformName name, const glm::mat3& matrix, bool transpose) const
 	{
-		int location = getUniformLocation(name);
-		glProgramUniformMatrix3fv(m_handle, location, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(matrix));
+		setUniform(uniform<glm::mat3>(name), matrix, transpose);
 	}
 
-	void Program::setUniform(const char* name, const glm::mat4& matrix, bool transpose) const
+	void Program::setUniform(UniformName name, const glm::mat4& matrix, bool transpose) const
 	{
-		int location = getUniformLocation(name);
-		glProgramUniformMatrix4fv(m_handle, location, 1, transpose ? GL_TRUE : GL_FALSE, glm::value_ptr(matrix));
+		setUniform(uniform<glm::mat4>(name), matrix, transpose);
 	}
 }
\ No newline at end of file
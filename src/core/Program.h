@@ -1,12 +1,17 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
-#include <unordered_map>
 #include <string>
+#include <string_view>
 #include <span>
+#include <utility>
+#include <vector>
 
 #include <glm/glm.hpp>
 
+#include "utils.h"
+
 namespace BerylEngine
 {
 	struct ShaderSources
@@ -15,14 +20,104 @@ namespace BerylEngine
 		std::string fragmentShader;
 	};
 
+	/// <summary>
+	/// Preprocessed source of one stage of a program. type is the GL shader type.
+	/// files names the source string numbers of its #line directives, for compiler messages.
+	/// </summary>
+	struct ShaderStage
+	{
+		unsigned int type;
+		std::string source;
+		std::vector<std::string> files;
+	};
+
+	/// <summary>
+	/// Files of a program built with Program::fromFilesAsync. Compute programs only set computePath,
+	/// the others set vertexPath and fragmentPath, and optionally geometryPath.
+	/// </summary>
+	struct ProgramFiles
+	{
+		std::string computePath;
+		std::string vertexPath;
+		std::string geometryPath;
+		std::string fragmentPath;
+		std::vector<std::string> defines;
+	};
+
+	/// <summary>
+	/// Name of a uniform, reduced to its hash. Hashed at compile time when constant, e.g.
+	/// static constexpr UniformName ModelMatrix("modelMatrix");
+	/// </summary>
+	struct UniformName
+	{
+		uint64_t hash;
+
+		constexpr UniformName(std::string_view name) : hash(fnv1a(name)) {}
+		constexpr UniformName(const char* name) : hash(fnv1a(name)) {}
+	};
+
+	/// <summary>
+	/// Location of a uniform of type T, resolved once by Program::uniform() so that setting it costs no lookup.
+	/// Uniforms that are not active in the program have an invalid location, which GL ignores.
+	/// </summary>
+	template<typename T>
+	struct Uniform
+	{
+		int location = -1;
+
+		bool isValid() const { return location >= 0; }
+	};
+
 	class Program
 	{
+	public:
+		/// <summary>
+		/// Programs built since startup. buildMs is the time spent in the build calls on the thread owning the
+		/// context, preprocessing and the driver's parallel compilation excluded.
+		/// </summary>
+		struct BuildStats
+		{
+			size_t fromBinary = 0;
+			size_t fromSource = 0;
+			size_t failed = 0;
+			size_t compiling = 0; // Submitted by fromFilesAsync and not checked yet
+			double buildMs = 0.0;
+		};
+
 	private:
+		// Shaders of a program whose compilation was submitted but not checked yet
+		struct PendingBuild
+		{
+			std::vector<ShaderStage> stages;
+			std::vector<unsigned int> shaders;
+			uint64_t binaryKey;
+		};
+
 		unsigned int m_handle;
-		std::unordered_map<std::string, int> m_uniformLocations;
+		std::vector<std::pair<uint64_t, int>> m_uniformLocations; // Sorted by name hash
+		std::unique_ptr<PendingBuild> m_pending;
+		bool m_ready;
+
+		/// <summary>
+		/// Take ownership of a linked program, 0 for a program that failed to build.
+		/// With pending, the program is still being compiled and linked by the driver.
+		/// </summary>
+		explicit Program(unsigned int handle, std::unique_ptr<PendingBuild> pending = nullptr);
+
+		/// <summary>
+		/// Load the program from the binary cache, or compile and link it and store its binary.
+		/// </summary>
+		static std::shared_ptr<Program> fromStages(std::span<const ShaderStage> stages);
+
+		/// <summary>
+		/// Like fromStages, but only submit the compilation and link to the driver.
+		/// </summary>
+		static std::shared_ptr<Program> submitStages(std::vector<ShaderStage> stages);
+
+		void finishBuild();
 
 		void fetchUniformLocations();
-		int getUniformLocation(const char* name) const;
+		int getUniformLocation(UniformName name) const;
 
 	public:
 		Program(const std::string& compute_src);
@@ -41,14 +136,59 @@ namespace BerylEngine
 		static std::shared_ptr<Program> fromFiles(const std::string& vertex_path, const std::string& geometry_path,
 													const std::string& fragment_path);
 
+		/// <summary>
+		/// Start building every program at once and return without waiting for the driver, whose compiler threads
+		/// then work on all of them in parallel (GL_KHR_parallel_shader_compile). Poll isReady() before use.
+		/// Meant to submit every known program at startup. Sources are preprocessed on the global thread pool.
+		/// </summary>
+		static std::vector<std::shared_ptr<Program>> fromFilesAsync(std::span<const ProgramFiles> programs);
+		static std::shared_ptr<Program> fromFilesAsync(const ProgramFiles& program);
+
+		/// <summary>
+		/// True once the program is linked. Polls the driver without blocking when it supports parallel
+		/// compilation, otherwise waits for it. Programs that failed to build are never ready.
+		/// </summary>
+		bool isReady();
+
+		/// <summary>
+		/// True once the program is known to have failed to build, as of the last isReady(). It then never becomes ready.
+		/// </summary>
+		bool hasFailed() const;
+
+		/// <summary>
+		/// Cheap program bound by materials instead of programs that are not ready. Built on first use.
+		/// </summary>
+		static Program& fallback();
+		static void releaseFallback();
+
+		static const BuildStats& buildStats();
+		static void logBuildStats();
+
 		void bind();
 
-		void setUniform(const char* name, int v0) const;
-		void setUniform(const char* name, float v0) const;
-		void setUniform(const char* name, float v0, float v1, float v2) const;
-		void setUniform(const char* name, const glm::vec3& v) const;
-		void setUniform(const char* name, float v0, float v1, float v2, float v3) const;
-		void setUniform(const char* name, const glm::mat3& matrix, bool transpose = false) const;
-		void setUniform(const char* name, const glm::mat4& matrix, bool transpose = false) const;
+		/// <summary>
+		/// Handle of a uniform, to resolve once the program is ready and keep for the frames setting it.
+		/// </summary>
+		template<typename T>
+		Uniform<T> uniform(UniformName name) const
+		{
+			return { getUniformLocation(name) };
+		}
+
+		void setUniform(Uniform<int> uniform, int v0) const;
+		void setUniform(Uniform<float> uniform, float v0) const;
+		void setUniform(Uniform<glm::vec3> uniform, const glm::vec3& v) const;
+		void setUniform(Uniform<glm::vec4> uniform, const glm::vec4& v) const;
+		void setUniform(Uniform<glm::mat3> uniform, const glm::mat3& matrix, bool transpose = false) const;
+		void setUniform(Uniform<glm::mat4> uniform, const glm::mat4& matrix, bool transpose = false) const;
+
+		// Resolve the name on every call, with a binary search
+		void setUniform(UniformName name, int v0) const;
+		void setUniform(UniformName name, float v0) const;
+		void setUniform(UniformName name, float v0, float v1, float v2) const;
+		void setUniform(UniformName name, const glm::vec3& v) const;
+		void setUniform(UniformName name, float v0, float v1, float v2, float v3) const;
+		void setUniform(UniformName name, const glm::mat3& matrix, bool transpose = false) const;
+		void setUniform(UniformName name, const glm::mat4& matrix, bool transpose = false) const;
 	};
 }
\ No newline at end of file
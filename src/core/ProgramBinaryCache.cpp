@@ -0,0 +1,124 @@
+#include "ProgramBinaryCache.h"
+
+#include <GL/glew.h>
+#include <cstring>
+#include <filesystem>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+#include "MappedFile.h"
+#include "utils.h"
+
+namespace BerylEngine::ProgramBinaryCache
+{
+	namespace
+	{
+		constexpr uint32_t ProgramFileMagic = 0x47525042; // "BPRG"
+		constexpr uint32_t ProgramFileVersion = 1;
+
+		struct ProgramFileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t binaryFormat;
+			uint32_t binarySize;
+			uint64_t key;
+		};
+	}
+
+	static std::string filePath(uint64_t key)
+	{
+		return fmt::format("{}{:016x}.bprog", Directory, key);
+	}
+
+	uint64_t key(std::span<const ShaderStage> stages)
+	{
+		GLint formatCount = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+		if (formatCount == 0)
+			return 0;
+
+		// Binaries are only valid for the driver that produced them
+		uint64_t hash = Fnv1aOffsetBasis;
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+		{
+			const char* value = reinterpret_cast<const char*>(glGetString(name));
+			hash = fnv1a(value != nullptr ? value : "", hash);
+		}
+
+		// The sources are preprocessed, so they already hold the includes and defines
+		for (const ShaderStage& stage : stages)
+		{
+			hash = fnv1a(std::as_bytes(std::span(&stage.type, 1)), hash);
+			hash = fnv1a(stage.source, hash);
+		}
+
+		return hash != 0 ? hash : 1;
+	}
+
+	unsigned int load(uint64_t key)
+	{
+		const std::string path = filePath(key);
+		if (!std::filesystem::exists(path))
+			return 0;
+
+		MappedFile file(path);
+		const std::span<const std::byte> data = file.data();
+		ProgramFileHeader header;
+		if (!file.isOpen() || data.size() < sizeof(header))
+			return 0;
+		std::memcpy(&header, data.data(), sizeof(header));
+
+		if (header.magic != ProgramFileMagic || header.version != ProgramFileVersion || header.key != key
+			|| header.binarySize != data.size() - sizeof(header))
+		{
+			spdlog::debug("Program binary {} has an unsupported format or is corrupted.", path);
+			return 0;
+		}
+
+		unsigned int program = glCreateProgram();
+		glProgramBinary(program, header.binaryFormat, data.data() + sizeof(header), GLsizei(header.binarySize));
+
+		// Drivers may reject binaries at any time, e.g. after an update that kept the same version string
+		GLint linkStatus = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+		if (linkStatus != GL_TRUE)
+		{
+			spdlog::debug("Program binary {} was rejected by the driver, building from source.", path);
+			glDeleteProgram(program);
+
+			file = MappedFile();
+			std::error_code error;
+			std::filesystem::remove(path, error);
+			return 0;
+		}
+
+		return program;
+	}
+
+	bool store(uint64_t key, unsigned int program)
+	{
+		GLint binarySize = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+		if (binarySize <= 0)
+			return false;
+
+		std::vector<std::byte> binary(static_cast<size_t>(binarySize));
+		GLenum binaryFormat = 0;
+		glGetProgramBinary(program, binarySize, &binarySize, &binaryFormat, binary.data());
+
+		ProgramFileHeader header = {};
+		header.magic = ProgramFileMagic;
+		header.version = ProgramFileVersion;
+		header.binaryFormat = binaryFormat;
+		header.binarySize = uint32_t(binarySize);
+		header.key = key;
+
+		std::error_code error;
+		std::filesystem::create_directories(Directory, error);
+
+		const std::span<const std::byte> parts[] = { std::as_bytes(std::span(&header, 1)),
+			std::span(binary.data(), size_t(binarySize)) };
+		return writeFileAtomically(filePath(key), parts);
+	}
+}
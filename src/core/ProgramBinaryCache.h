@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "Program.h"
+
+/// <summary>
+/// On-disk cache of linked program binaries, so that programs are only compiled from source once per driver.
+/// </summary>
+namespace BerylEngine::ProgramBinaryCache
+{
+	/// <summary>
+	/// Directory the binaries are stored in, relative to the working directory.
+	/// </summary>
+	constexpr const char* Directory = "cache/programs/";
+
+	/// <summary>
+	/// Key of a program built from these stages with the current driver, so that a driver update invalidates
+	/// the binaries. 0 when the driver has no binary format, the cache is then not used.
+	/// </summary>
+	uint64_t key(std::span<const ShaderStage> stages);
+
+	/// <summary>
+	/// Create a program from its cached binary. Return 0 on a miss, or when the driver rejects the binary,
+	/// in which case the file is removed and the program has to be built from source.
+	/// </summary>
+	unsigned int load(uint64_t key);
+
+	/// <summary>
+	/// Save the binary of a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+	/// </summary>
+	bool store(uint64_t key, unsigned int program);
+}
@@ -0,0 +1,72 @@
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <array>
+
+namespace BerylEngine
+{
+	static constexpr size_t DigitBits = 8;
+	static constexpr size_t DigitCount = 64 / DigitBits;
+	static constexpr size_t BucketCount = size_t(1) << DigitBits;
+
+	void radixSort(std::span<uint64_t> keys, std::span<uint32_t> values,
+					std::vector<uint64_t>& keyScratch, std::vector<uint32_t>& valueScratch)
+	{
+		const size_t count = keys.size();
+		if (count < 2)
+			return;
+
+		if (keyScratch.size() < count)
+			keyScratch.resize(count);
+		if (valueScratch.size() < count)
+			valueScratch.resize(count);
+
+		// Histograms of every digit are built in a single pass over the keys
+		std::array<std::array<uint32_t, BucketCount>, DigitCount> histograms = {};
+		for (uint64_t key : keys)
+		{
+			for (size_t digit = 0; digit < DigitCount; digit++)
+				histograms[digit][(key >> (digit * DigitBits)) & (BucketCount - 1)]++;
+		}
+
+		uint64_t* srcKeys = keys.data();
+		uint32_t* srcValues = values.data();
+		uint64_t* dstKeys = keyScratch.data();
+		uint32_t* dstValues = valueScratch.data();
+
+		for (size_t digit = 0; digit < DigitCount; digit++)
+		{
+			auto& histogram = histograms[digit];
+			const size_t shift = digit * DigitBits;
+
+			// Every key falls in the same bucket, this pass would not change the order
+			if (histogram[(srcKeys[0] >> shift) & (BucketCount - 1)] == count)
+				continue;
+
+			uint32_t offset = 0;
+			for (auto& bucket : histogram)
+			{
+				const uint32_t size = bucket;
+				bucket = offset;
+				offset += size;
+			}
+
+			for (size_t i = 0; i < count; i++)
+			{
+				const uint32_t position = histogram[(srcKeys[i] >> shift) & (BucketCount - 1)]++;
+				dstKeys[position] = srcKeys[i];
+				dstValues[position] = srcValues[i];
+			}
+
+			std::swap(srcKeys, dstKeys);
+			std::swap(srcValues, dstValues);
+		}
+
+		// An odd number of passes leaves the result in the scratch buffers
+		if (srcKeys != keys.data())
+		{
+			std::copy(srcKeys, srcKeys + count, keys.data());
+			std::copy(srcValues, srcValues + count, values.data());
+		}
+	}
+}
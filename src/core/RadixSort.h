@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace BerylEngine
+{
+	/// <summary>
+	/// Sort 64-bit keys in ascending order along with a 32-bit value per key, in place.
+	/// LSD radix sort with 8-bit digits. Digits that are equal for every key are skipped, which
+	/// makes sorting keys with mostly constant high bits (e.g. few programs) cheaper.
+	/// The scratch vectors are grown as needed and can be kept between calls to avoid allocations.
+	/// The sort is stable.
+	/// </summary>
+	void radixSort(std::span<uint64_t> keys, std::span<uint32_t> values,
+					std::vector<uint64_t>& keyScratch, std::vector<uint32_t>& valueScratch);
+}
@@ -0,0 +1,247 @@
+#include "RenderState.h"
+
+#include <GL/glew.h>
+#include <array>
+
+namespace BerylEngine::RenderState
+{
+	static constexpr unsigned int Unknown = ~0u;
+	static constexpr size_t TrackedTextureUnits = 32;
+	static constexpr size_t TrackedBufferBindings = 16;
+
+	struct BufferBinding
+	{
+		unsigned int buffer = Unknown;
+		size_t offset = 0;
+		size_t size = 0;
+	};
+
+	struct State
+	{
+		unsigned int blend = Unknown;
+		unsigned int depthTest = Unknown;
+		unsigned int cullFace = Unknown;
+		unsigned int blendSourceFactor = Unknown;
+		unsigned int blendDestinationFactor = Unknown;
+		unsigned int depthFunc = Unknown;
+		unsigned int depthMask = Unknown;
+		unsigned int cullFaceMode = Unknown;
+
+		unsigned int program = Unknown;
+		unsigned int vertexArray = Unknown;
+		unsigned int drawIndirectBuffer = Unknown;
+
+		std::array<unsigned int, TrackedTextureUnits> textures;
+		std::array<unsigned int, TrackedTextureUnits> samplers;
+		std::array<BufferBinding, TrackedBufferBindings> uniformBuffers;
+		std::array<BufferBinding, TrackedBufferBindings> storageBuffers;
+
+		State()
+		{
+			textures.fill(Unknown);
+			samplers.fill(Unknown);
+		}
+	};
+
+	static State s_state;
+	static Counters s_counters = {};
+
+	// Return true when the call must be emitted, updating the shadowed value.
+	static bool update(unsigned int& shadow, unsigned int value)
+	{
+		if (shadow == value)
+		{
+			s_counters.skipped++;
+			return false;
+		}
+
+		shadow = value;
+		s_counters.emitted++;
+		return true;
+	}
+
+	void invalidate()
+	{
+		s_state = State();
+	}
+
+	const Counters& counters()
+	{
+		return s_counters;
+	}
+
+	void resetCounters()
+	{
+		s_counters = {};
+	}
+
+	static unsigned int* capabilityShadow(unsigned int capability)
+	{
+		switch (capability)
+		{
+		case GL_BLEND:
+			return &s_state.blend;
+		case GL_DEPTH_TEST:
+			return &s_state.depthTest;
+		case GL_CULL_FACE:
+			return &s_state.cullFace;
+		default:
+			return nullptr;
+		}
+	}
+
+	void setCapability(unsigned int capability, bool enabled)
+	{
+		unsigned int* shadow = capabilityShadow(capability);
+		if (shadow != nullptr && !update(*shadow, enabled ? 1 : 0))
+			return;
+
+		if (enabled)
+			glEnable(capability);
+		else
+			glDisable(capability);
+	}
+
+	void setBlendFunc(unsigned int sourceFactor, unsigned int destinationFactor)
+	{
+		if (s_state.blendSourceFactor == sourceFactor && s_state.blendDestinationFactor == destinationFactor)
+		{
+			s_counters.skipped++;
+			return;
+		}
+
+		s_state.blendSourceFactor = sourceFactor;
+		s_state.blendDestinationFactor = destinationFactor;
+		s_counters.emitted++;
+		glBlendFunc(sourceFactor, destinationFactor);
+	}
+
+	void setDepthFunc(unsigned int func)
+	{
+		if (update(s_state.depthFunc, func))
+			glDepthFunc(func);
+	}
+
+	void setDepthMask(bool writeDepth)
+	{
+		if (update(s_state.depthMask, writeDepth ? GL_TRUE : GL_FALSE))
+			glDepthMask(writeDepth ? GL_TRUE : GL_FALSE);
+	}
+
+	void setCullFace(unsigned int face)
+	{
+		if (update(s_state.cullFaceMode, face))
+			glCullFace(face);
+	}
+
+	void useProgram(unsigned int program)
+	{
+		if (update(s_state.program, program))
+			glUseProgram(program);
+	}
+
+	void bindVertexArray(unsigned int vertexArray)
+	{
+		if (update(s_state.vertexArray, vertexArray))
+			glBindVertexArray(vertexArray);
+	}
+
+	void bindTextureUnit(unsigned int unit, unsigned int texture)
+	{
+		if (unit >= TrackedTextureUnits || update(s_state.textures[unit], texture))
+			glBindTextureUnit(unit, texture);
+	}
+
+	void bindTextures(unsigned int firstUnit, std::span<const unsigned int> textures)
+	{
+		bool changed = firstUnit + textures.size() > TrackedTextureUnits;
+		for (size_t i = 0; i < textures.size() && !changed; i++)
+			changed = s_state.textures[firstUnit + i] != textures[i];
+
+		if (!changed)
+		{
+			s_counters.skipped++;
+			return;
+		}
+
+		for (size_t i = 0; i < textures.size() && firstUnit + i < TrackedTextureUnits; i++)
+			s_state.textures[firstUnit + i] = textures[i];
+
+		s_counters.emitted++;
+		glBindTextures(firstUnit, GLsizei(textures.size()), textures.data());
+	}
+
+	void bindSampler(unsigned int unit, unsigned int sampler)
+	{
+		if (unit >= TrackedTextureUnits || update(s_state.samplers[unit], sampler))
+			glBindSampler(unit, sampler);
+	}
+
+	void bindBuffer(unsigned int target, unsigned int buffer)
+	{
+		if (target != GL_DRAW_INDIRECT_BUFFER || update(s_state.drawIndirectBuffer, buffer))
+			glBindBuffer(target, buffer);
+	}
+
+	void bindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size)
+	{
+		BufferBinding* shadow = nullptr;
+		if (index < TrackedBufferBindings)
+		{
+			if (target == GL_UNIFORM_BUFFER)
+				shadow = &s_state.uniformBuffers[index];
+			else if (target == GL_SHADER_STORAGE_BUFFER)
+				shadow = &s_state.storageBuffers[index];
+		}
+
+		if (shadow != nullptr)
+		{
+			if (shadow->buffer == buffer && shadow->offset == offset && shadow->size == size)
+			{
+				s_counters.skipped++;
+				return;
+			}
+
+			*shadow = { buffer, offset, size };
+		}
+
+		s_counters.emitted++;
+		if (size == 0)
+			glBindBufferBase(target, index, buffer);
+		else
+			glBindBufferRange(target, index, buffer, offset, size);
+	}
+
+	void releaseVertexArray(unsigned int vertexArray)
+	{
+		if (s_state.vertexArray == vertexArray)
+			s_state.vertexArray = 0;
+	}
+
+	void releaseTexture(unsigned int texture)
+	{
+		for (auto& unit : s_state.textures)
+		{
+			if (unit == texture)
+				unit = 0;
+		}
+	}
+
+	void releaseBuffer(unsigned int buffer)
+	{
+		if (s_state.drawIndirectBuffer == buffer)
+			s_state.drawIndirectBuffer = 0;
+
+		for (auto& binding : s_state.uniformBuffers)
+		{
+			if (binding.buffer == buffer)
+				binding = { 0, 0, 0 };
+		}
+
+		for (auto& binding : s_state.storageBuffers)
+		{
+			if (binding.buffer == buffer)
+				binding = { 0, 0, 0 };
+		}
+	}
+}
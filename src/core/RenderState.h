@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+
+/// <summary>
+/// Shadow of the GL state touched by the engine. Calls that would not change anything are skipped.
+/// Code that changes GL state behind the tracker's back (e.g. UI libraries) must call invalidate() afterwards.
+/// </summary>
+namespace BerylEngine::RenderState
+{
+	struct Counters
+	{
+		size_t emitted;
+		size_t skipped;
+	};
+
+	/// <summary>
+	/// Forget the shadowed state. The next call of each kind is always emitted.
+	/// </summary>
+	void invalidate();
+
+	const Counters& counters();
+	void resetCounters();
+
+	/// <summary>
+	/// Only GL_BLEND, GL_DEPTH_TEST and GL_CULL_FACE are tracked. Other capabilities are forwarded.
+	/// </summary>
+	void setCapability(unsigned int capability, bool enabled);
+	void setBlendFunc(unsigned int sourceFactor, unsigned int destinationFactor);
+	void setDepthFunc(unsigned int func);
+	void setDepthMask(bool writeDepth);
+	void setCullFace(unsigned int face);
+
+	void useProgram(unsigned int program);
+	void bindVertexArray(unsigned int vertexArray);
+
+	void bindTextureUnit(unsigned int unit, unsigned int texture);
+	/// <summary>
+	/// Bind textures to consecutive units starting at firstUnit with a single multi-bind call.
+	/// </summary>
+	void bindTextures(unsigned int firstUnit, std::span<const unsigned int> textures);
+	void bindSampler(unsigned int unit, unsigned int sampler);
+
+	/// <summary>
+	/// Non-indexed binding. Only GL_DRAW_INDIRECT_BUFFER is tracked, other targets are forwarded.
+	/// </summary>
+	void bindBuffer(unsigned int target, unsigned int buffer);
+	/// <summary>
+	/// Indexed binding of uniform and shader storage buffers. A size of 0 binds the whole buffer.
+	/// </summary>
+	void bindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, size_t offset, size_t size);
+
+	// Deleting a bound object resets its bindings to 0 and its name may be reused.
+	// Call these when deleting objects to keep the shadow in sync.
+	void releaseVertexArray(unsigned int vertexArray);
+	void releaseTexture(unsigned int texture);
+	void releaseBuffer(unsigned int buffer);
+}
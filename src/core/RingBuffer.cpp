@@ -0,0 +1,121 @@
+#include "RingBuffer.h"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+namespace BerylEngine
+{
+	static size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	RingBuffer::RingBuffer(size_t frameCapacity)
+	{
+		GLint uniformAlignment = 0;
+		GLint storageAlignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+		m_uniformAlignment = std::max<size_t>(uniformAlignment, 4);
+		m_storageAlignment = std::max<size_t>(storageAlignment, 4);
+
+		createStorage(frameCapacity);
+	}
+
+	RingBuffer::~RingBuffer()
+	{
+		releaseStorage();
+	}
+
+	void RingBuffer::createStorage(size_t frameCapacity)
+	{
+		m_frameCapacity = alignUp(frameCapacity, maxAlignment());
+		const size_t size = m_frameCapacity * FramesInFlight;
+
+		m_buffer = ByteBuffer(nullptr, size,
+			BufferStorage::MapWrite | BufferStorage::Persistent | BufferStorage::Coherent);
+
+		if (m_buffer.persistentData() == nullptr)
+			FATAL("Failed to map ring buffer");
+
+		spdlog::trace("Ring buffer {} allocated. Size is {} ({} frames of {}).", m_buffer.getHandle(), size,
+			FramesInFlight, m_frameCapacity);
+	}
+
+	void RingBuffer::releaseStorage()
+	{
+		for (int i = 0; i != FramesInFlight; ++i)
+			waitFence(i);
+
+		m_buffer = ByteBuffer();
+	}
+
+	void RingBuffer::waitFence(int index)
+	{
+		GLsync& fence = m_fences[index];
+		if (fence == nullptr)
+			return;
+
+		GLenum result = GL_TIMEOUT_EXPIRED;
+		while (result == GL_TIMEOUT_EXPIRED)
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000);
+
+		if (result == GL_WAIT_FAILED)
+			spdlog::error("Waiting on ring buffer fence failed.");
+
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	size_t RingBuffer::maxAlignment() const
+	{
+		return std::max(m_uniformAlignment, m_storageAlignment);
+	}
+
+	size_t RingBuffer::alignment(BufferUsageType usageType) const
+	{
+		switch (usageType)
+		{
+		case BufferUsageType::UniformBuffer:
+			return m_uniformAlignment;
+		case BufferUsageType::ShaderStorage:
+			return m_storageAlignment;
+		default:
+			return 4;
+		}
+	}
+
+	void RingBuffer::beginFrame(size_t requiredSize)
+	{
+		if (requiredSize > m_frameCapacity)
+		{
+			spdlog::debug("Ring buffer frame region grows from {} to {} bytes.", m_frameCapacity, requiredSize);
+			releaseStorage();
+			createStorage(std::max(requiredSize, m_frameCapacity * 2));
+		}
+
+		m_frameIndex = (m_frameIndex + 1) % FramesInFlight;
+		m_cursor = 0;
+
+		waitFence(m_frameIndex);
+	}
+
+	void RingBuffer::endFrame()
+	{
+		m_fences[m_frameIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	RingBuffer::Range RingBuffer::allocate(size_t size, size_t alignment, void** data)
+	{
+		const size_t offset = alignUp(m_cursor, alignment);
+		if (offset + size > m_frameCapacity)
+			FATAL("Ring buffer frame region overflow");
+
+		m_cursor = offset + size;
+
+		const size_t absoluteOffset = m_frameCapacity * m_frameIndex + offset;
+		*data = static_cast<unsigned char*>(m_buffer.persistentData()) + absoluteOffset;
+
+		return { absoluteOffset, size };
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <span>
+
+#include "ByteBuffer.h"
+
+namespace BerylEngine
+{
+	/// <summary>
+	/// Persistently mapped buffer split into one region per frame in flight.
+	/// Each region is guarded by a fence so the CPU never overwrites data the GPU may still read.
+	/// </summary>
+	class RingBuffer : NonCopyable
+	{
+	public:
+		static constexpr int FramesInFlight = 3;
+
+		struct Range
+		{
+			size_t offset;
+			size_t size;
+		};
+
+		RingBuffer(size_t frameCapacity);
+		~RingBuffer();
+
+		/// <summary>
+		/// Wait for the GPU to release the next region and make it the current one.
+		/// The region grows if it cannot hold requiredSize bytes.
+		/// </summary>
+		void beginFrame(size_t requiredSize);
+		void endFrame();
+
+		/// <summary>
+		/// Largest alignment an allocation may require. Use it to account for padding in beginFrame.
+		/// </summary>
+		size_t maxAlignment() const;
+
+		Range allocate(size_t size, size_t alignment, void** data);
+
+		template<BufferUsageType U, typename T>
+		std::span<T> allocate(size_t count, Range* range)
+		{
+			void* dst = nullptr;
+			*range = allocate(std::max<size_t>(count, 1) * sizeof(T), alignment(U), &dst);
+
+			return std::span<T>(static_cast<T*>(dst), count);
+		}
+
+		template<BufferUsageType U, typename T>
+		Range write(const T* data, size_t count)
+		{
+			void* dst = nullptr;
+			Range range = allocate(std::max<size_t>(count, 1) * sizeof(T), alignment(U), &dst);
+			if (count > 0)
+				std::memcpy(dst, data, count * sizeof(T));
+
+			return range;
+		}
+
+		void bind(BufferUsageType usageType) const
+		{
+			m_buffer.bind(usageType);
+		}
+
+		template<BufferUsageType U>
+		void bindRange(int bindingPoint, const Range& range) const
+		{
+			m_buffer.bindRange<U>(bindingPoint, range.offset, range.size);
+		}
+
+	private:
+		ByteBuffer m_buffer;
+		size_t m_frameCapacity = 0;
+		size_t m_uniformAlignment = 0;
+		size_t m_storageAlignment = 0;
+
+		int m_frameIndex = 0;
+		size_t m_cursor = 0;
+		std::array<GLsync, FramesInFlight> m_fences = {};
+
+		size_t alignment(BufferUsageType usageType) const;
+
+		void createStorage(size_t frameCapacity);
+		void releaseStorage();
+		void waitFence(int index);
+	};
+}
@@ -0,0 +1,246 @@
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <spdlog/spdlog.h>
+
+namespace BerylEngine
+{
+	static std::string_view trimStart(std::string_view text)
+	{
+		const size_t first = text.find_first_not_of(" \t");
+		return first == std::string_view::npos ? std::string_view() : text.substr(first);
+	}
+
+	// Path between the quotes or angle brackets of an include line, empty if they are missing
+	static std::string_view includeTarget(std::string_view line)
+	{
+		const size_t open = line.find_first_of("\"<");
+		if (open == std::string_view::npos)
+			return {};
+
+		const size_t close = line.find(line[open] == '\"' ? '\"' : '>', open + 1);
+		if (close == std::string_view::npos)
+			return {};
+
+		return line.substr(open + 1, close - open - 1);
+	}
+
+	std::shared_ptr<const ShaderPreprocessor::SourceFile> ShaderPreprocessor::loadFile(const std::string& canonicalPath)
+	{
+		std::error_code error;
+		const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(canonicalPath, error);
+		if (error)
+			return nullptr;
+
+		{
+			std::lock_guard lock(m_mutex);
+			auto cached = m_files.find(canonicalPath);
+			if (cached != m_files.end() && cached->second->writeTime == writeTime)
+			{
+				m_stats.cacheHits++;
+				return cached->second;
+			}
+		}
+
+		// Threads missing the same file at once both read it, the last one replaces the entry
+		std::ifstream stream(canonicalPath, std::ios::binary);
+		if (!stream.is_open())
+			return nullptr;
+
+		auto file = std::make_shared<SourceFile>();
+		file->writeTime = writeTime;
+		file->text.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+
+		// Directives are found once per read, expanding only splices the text around them
+		const std::filesystem::path folder = std::filesystem::path(canonicalPath).parent_path();
+		int lineNumber = 1;
+		for (size_t begin = 0; begin < file->text.size(); lineNumber++)
+		{
+			size_t end = file->text.find('\n', begin);
+			end = end == std::string::npos ? file->text.size() : end + 1;
+			const std::string_view line = trimStart(std::string_view(file->text).substr(begin, end - begin));
+
+			if (line.starts_with("#include"))
+			{
+				const std::string_view target = includeTarget(line);
+				if (target.empty())
+				{
+					spdlog::warn("Malformed include in {}:{}. Nothing will be included.", canonicalPath, lineNumber);
+					file->directives.push_back({ begin, end, lineNumber, "" });
+				}
+				else
+					file->directives.push_back({ begin, end, lineNumber, BerylEngine::canonicalPath(folder / target) });
+			}
+			else if (line.starts_with("#pragma") && trimStart(line.substr(7)).starts_with("once"))
+			{
+				file->pragmaOnce = true;
+				file->directives.push_back({ begin, end, lineNumber, "" });
+			}
+
+			begin = end;
+		}
+
+		std::lock_guard lock(m_mutex);
+		m_stats.fileReads++;
+		m_files[canonicalPath] = file;
+		return file;
+	}
+
+	void ShaderPreprocessor::expand(const SourceFile& file, size_t begin, int fileIndex, PreprocessedShader& shader,
+									std::vector<std::string>& includeStack)
+	{
+		size_t position = begin;
+		for (const Directive& directive : file.directives)
+		{
+			if (directive.begin < begin)
+				continue;
+
+			shader.source.append(file.text, position, directive.begin - position);
+			position = directive.end;
+
+			// Dropped lines are replaced by empty ones, so that the numbering does not need a #line
+			const std::string& includePath = directive.includePath;
+			if (includePath.empty())
+			{
+				shader.source += '\n';
+				continue;
+			}
+
+			if (std::find(includeStack.begin(), includeStack.end(), includePath) != includeStack.end())
+			{
+				spdlog::warn("Include cycle on {} from {}:{}. Nothing will be included.", includePath,
+					includeStack.back(), directive.line);
+				shader.source += '\n';
+				continue;
+			}
+
+			const std::shared_ptr<const SourceFile> included = loadFile(includePath);
+			if (included == nullptr)
+			{
+				spdlog::warn("Include {} not found from {}:{}. Nothing will be included.", includePath,
+					includeStack.back(), directive.line);
+				shader.source += '\n';
+				continue;
+			}
+
+			auto known = std::find(shader.files.begin(), shader.files.end(), includePath);
+			if (known != shader.files.end() && included->pragmaOnce)
+			{
+				shader.source += '\n';
+				continue;
+			}
+
+			const int includedIndex = int(known - shader.files.begin());
+			if (known == shader.files.end())
+				shader.files.push_back(includePath);
+
+			shader.source += fmt::format("#line 1 {}\n", includedIndex);
+			includeStack.push_back(includePath);
+			expand(*included, 0, includedIndex, shader, includeStack);
+			includeStack.pop_back();
+			if (!shader.source.ends_with('\n'))
+				shader.source += '\n';
+			shader.source += fmt::format("#line {} {}\n", directive.line + 1, fileIndex);
+		}
+
+		shader.source.append(file.text, position);
+	}
+
+	bool ShaderPreprocessor::preprocess(const std::string& path, std::span<const std::string> defines,
+										PreprocessedShader& shader)
+	{
+		const std::string rootPath = canonicalPath(path);
+
+		const std::shared_ptr<const SourceFile> root = loadFile(rootPath);
+		if (root == nullptr)
+		{
+			spdlog::error("Failed to open shader file {}.", path);
+			return false;
+		}
+
+		if (!root->text.starts_with("#version"))
+		{
+			spdlog::warn("Loading of {} was cancelled as it does not specify GLSL version on first line.", path);
+			return false;
+		}
+
+		size_t versionEnd = root->text.find('\n');
+		versionEnd = versionEnd == std::string::npos ? root->text.size() : versionEnd + 1;
+
+		shader.source.clear();
+		shader.source.reserve(root->text.size() * 2);
+		shader.source.append(root->text, 0, versionEnd);
+		if (!shader.source.ends_with('\n'))
+			shader.source += '\n';
+		for (const std::string& define : defines)
+			shader.source += fmt::format("#define {} 1\n", define);
+		shader.source += "#line 2 0\n";
+
+		shader.files = { rootPath };
+		std::vector<std::string> includeStack = { rootPath };
+		expand(*root, versionEnd, 0, shader, includeStack);
+
+		return true;
+	}
+
+	void ShaderPreprocessor::collect(const std::string& canonicalPath, std::vector<std::string>& files) const
+	{
+		auto file = m_files.find(canonicalPath);
+		if (file == m_files.end())
+			return;
+
+		for (const Directive& directive : file->second->directives)
+		{
+			if (!directive.includePath.empty()
+				&& std::find(files.begin(), files.end(), directive.includePath) == files.end())
+			{
+				files.push_back(directive.includePath);
+				collect(directive.includePath, files);
+			}
+		}
+	}
+
+	std::vector<std::string> ShaderPreprocessor::dependencies(const std::string& path) const
+	{
+		std::lock_guard lock(m_mutex);
+		std::vector<std::string> files;
+		collect(canonicalPath(path), files);
+		return files;
+	}
+
+	std::vector<std::string> ShaderPreprocessor::dependents(const std::string& path) const
+	{
+		const std::string target = canonicalPath(path);
+
+		std::lock_guard lock(m_mutex);
+		std::vector<std::string> files;
+		for (const auto& [candidate, file] : m_files)
+		{
+			std::vector<std::string> included;
+			collect(candidate, included);
+			if (std::find(included.begin(), included.end(), target) != included.end())
+				files.push_back(candidate);
+		}
+		return files;
+	}
+
+	ShaderPreprocessor::Stats ShaderPreprocessor::stats() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_stats;
+	}
+
+	void ShaderPreprocessor::clear()
+	{
+		std::lock_guard lock(m_mutex);
+		m_files.clear();
+	}
+
+	ShaderPreprocessor& ShaderPreprocessor::global()
+	{
+		static ShaderPreprocessor preprocessor;
+		return preprocessor;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils.h"
+
+namespace BerylEngine
+{
+	/// <summary>
+	/// Expands #include directives of GLSL files, from an in-memory cache of the files that is only read again
+	/// when their modification time changes. Building many programs from the same files costs one read per file.
+	/// - Includes are resolved relative to the including file and expanded recursively.
+	/// - Files with #pragma once are expanded once per program, include cycles are skipped with a warning.
+	/// - #line directives keep compiler messages pointing at the right file and line: the source string number
+	///   of a line is the index of its file in PreprocessedShader::files.
+	/// The include graph of every file read is kept, so that the programs depending on a file can be found.
+	/// Cached files are immutable and the lock is only held to look them up, so shaders can be preprocessed
+	/// from several threads at once.
+	/// </summary>
+	class ShaderPreprocessor : NonMovable
+	{
+	public:
+		struct PreprocessedShader
+		{
+			std::string source;
+			std::vector<std::string> files; // Canonical paths, indexed by source string number
+		};
+
+		struct Stats
+		{
+			size_t fileReads = 0;
+			size_t cacheHits = 0;
+		};
+
+		/// <summary>
+		/// Preprocess the shader at path, which must start with its #version. Every define is set to 1
+		/// right after the version. Return false if the file cannot be read or has no version.
+		/// </summary>
+		bool preprocess(const std::string& path, std::span<const std::string> defines, PreprocessedShader& shader);
+
+		/// <summary>
+		/// Files included by path, directly or not, as of their last preprocessing.
+		/// </summary>
+		std::vector<std::string> dependencies(const std::string& path) const;
+
+		/// <summary>
+		/// Files including path, directly or not, as of their last preprocessing.
+		/// </summary>
+		std::vector<std::string> dependents(const std::string& path) const;
+
+		Stats stats() const;
+
+		/// <summary>
+		/// Forget every cached file, e.g. when reloading all shaders.
+		/// </summary>
+		void clear();
+
+		/// <summary>
+		/// Preprocessor used by Program. Created on first use.
+		/// </summary>
+		static ShaderPreprocessor& global();
+
+	private:
+		struct Directive
+		{
+			size_t begin; // Offsets of the directive line in the text, end includes its new line
+			size_t end;
+			int line; // 1-based
+			std::string includePath; // Canonical, empty for lines that are dropped such as #pragma once
+		};
+
+		struct SourceFile
+		{
+			std::filesystem::file_time_type writeTime;
+			std::string text;
+			std::vector<Directive> directives;
+			bool pragmaOnce = false;
+		};
+
+		// Protects the cache and the counters. Files are read and expanded outside of it.
+		mutable std::mutex m_mutex;
+		std::unordered_map<std::string, std::shared_ptr<const SourceFile>> m_files;
+		Stats m_stats;
+
+		std::shared_ptr<const SourceFile> loadFile(const std::string& canonicalPath);
+		void expand(const SourceFile& file, size_t begin, int fileIndex, PreprocessedShader& shader,
+					std::vector<std::string>& includeStack);
+		void collect(const std::string& canonicalPath, std::vector<std::string>& files) const;
+	};
+}
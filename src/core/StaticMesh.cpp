@@ -1,31 +1,178 @@
 #include "StaticMesh.h"
 
+#include <array>
+#include <glm/gtc/packing.hpp>
 #include <spdlog/spdlog.h>
 
 #include "utils.h"
 
 namespace BerylEngine
 {
+	static_assert(sizeof(StaticMesh::PackedVertex) == 20);
+
+	static std::array<std::unique_ptr<GeometryArena>, 2> s_arenas;
+
+	GeometryArena& StaticMesh::arena(GeometryArena::IndexType indexType)
+	{
+		std::unique_ptr<GeometryArena>& arena = s_arenas[size_t(indexType)];
+		if (!arena)
+		{
+			VertexBufferLayout layout;
+			layout.Add<int16_t>(4, true);
+			layout.Add<Packed1010102>(4, true);
+			layout.Add<Packed1010102>(4, true);
+			layout.Add<HalfFloat>(2);
+
+			arena = std::make_unique<GeometryArena>(layout, indexType, 64 * 1024, 256 * 1024);
+		}
+
+		return *arena;
+	}
+
+	void StaticMesh::releaseArenas()
+	{
+		for (auto& arena : s_arenas)
+			arena.reset();
+	}
+
+	std::vector<StaticMesh::PackedVertex> StaticMesh::packVertices(std::span<const Vertex> vertices, const AABB& box)
+	{
+		const glm::vec3 center = box.center();
+		const glm::vec3 extents = box.extents();
+		const glm::vec3 inverseExtents = glm::vec3(
+			extents.x > 0.0f ? 1.0f / extents.x : 0.0f,
+			extents.y > 0.0f ? 1.0f / extents.y : 0.0f,
+			extents.z > 0.0f ? 1.0f / extents.z : 0.0f);
+
+		std::vector<PackedVertex> packed(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const Vertex& vertex = vertices[i];
+			const glm::vec3 position = glm::clamp((vertex.coords - center) * inverseExtents, -1.0f, 1.0f);
+
+			packed[i].position = glm::i16vec4(glm::round(position * 32767.0f), 0);
+			packed[i].normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.normals, 0.0f));
+			packed[i].tangentData = glm::packSnorm3x10_1x2(glm::vec4(glm::vec3(vertex.tangentData),
+				vertex.tangentData.w < 0.0f ? -1.0f : 1.0f));
+			packed[i].uvs = glm::packHalf2x16(vertex.uvs);
+		}
+
+		return packed;
+	}
+
+	std::vector<uint16_t> StaticMesh::narrowIndices(std::span<const unsigned int> indices)
+	{
+		return std::vector<uint16_t>(indices.begin(), indices.end());
+	}
+
 	StaticMesh::StaticMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
-		: m_vbo(vertices.data(), vertices.size())
+		// coords is the first member of Vertex
+		: StaticMesh(vertices, indices, Bounds::fromPoints(vertices.data(), sizeof(Vertex), vertices.size()))
 	{
-		VertexBufferLayout layout;
-		layout.Add<float>(3);
-		layout.Add<float>(3);
-		layout.Add<float>(2);
-		layout.Add<float>(4);
+	}
 
-		m_vao = std::make_unique<VertexArray>(m_vbo, layout);
-		m_ibo = std::make_unique<TypedBuffer<unsigned int>>(indices.data(), indices.size());
+	StaticMesh::StaticMesh(std::span<const Vertex> vertices, std::span<const unsigned int> indices,
+							const Bounds& bounds, std::vector<Submesh> submeshes, std::vector<Lod> lods)
+	{
+		const std::vector<PackedVertex> packed = packVertices(vertices, bounds.box);
+		if (vertices.size() <= MaxShortIndexVertices)
+			upload(packed, std::span<const uint16_t>(narrowIndices(indices)), bounds, std::move(submeshes), std::move(lods));
+		else
+			upload(packed, indices, bounds, std::move(submeshes), std::move(lods));
+	}
 
-		spdlog::trace("Static mesh created with {} vertices for {} triangles.",
-						vertices.size(), indices.size() / 3);
+	StaticMesh::StaticMesh(std::span<const PackedVertex> vertices, std::span<const uint16_t> indices,
+							const Bounds& bounds, std::vector<Submesh> submeshes, std::vector<Lod> lods)
+	{
+		upload(vertices, indices, bounds, std::move(submeshes), std::move(lods));
+	}
+
+	StaticMesh::StaticMesh(std::span<const PackedVertex> vertices, std::span<const uint32_t> indices,
+							const Bounds& bounds, std::vector<Submesh> submeshes, std::vector<Lod> lods)
+	{
+		upload(vertices, indices, bounds, std::move(submeshes), std::move(lods));
+	}
+
+	void StaticMesh::upload(std::span<const PackedVertex> vertices, std::span<const uint16_t> indices,
+							const Bounds& bounds, std::vector<Submesh> submeshes, std::vector<Lod> lods)
+	{
+		m_indexType = GeometryArena::IndexType::UInt16;
+		m_bounds = bounds;
+		m_submeshes = std::move(submeshes);
+		m_lods = std::move(lods);
+		uploadGeometry(vertices, indices.data(), indices.size());
+	}
+
+	void StaticMesh::upload(std::span<const PackedVertex> vertices, std::span<const uint32_t> indices,
+							const Bounds& bounds, std::vector<Submesh> submeshes, std::vector<Lod> lods)
+	{
+		m_indexType = GeometryArena::IndexType::UInt32;
+		m_bounds = bounds;
+		m_submeshes = std::move(submeshes);
+		m_lods = std::move(lods);
+		uploadGeometry(vertices, indices.data(), indices.size());
+	}
+
+	void StaticMesh::uploadGeometry(std::span<const PackedVertex> vertices, const void* indices, size_t indexCount)
+	{
+		m_allocation = arena(m_indexType).allocate(vertices.data(), vertices.size(), indices, indexCount);
+		if (m_lods.empty())
+			m_lods.push_back({ 0, (unsigned int)indexCount, 0.0f });
+		if (m_submeshes.empty())
+			m_submeshes.push_back({ 0, m_lods.front().indexCount });
+		m_ready = true;
+
+		spdlog::trace("Static mesh created with {} vertices for {} triangles.", vertices.size(), indexCount / 3);
+	}
+
+	StaticMesh::~StaticMesh()
+	{
+		if (m_ready && s_arenas[size_t(m_indexType)])
+			s_arenas[size_t(m_indexType)]->free(m_allocation);
+	}
+
+	const GeometryArena::Range& StaticMesh::range() const
+	{
+		return arena(m_indexType).range(m_allocation);
+	}
+
+	const Bounds& StaticMesh::bounds() const
+	{
+		return m_bounds;
+	}
+
+	const std::vector<StaticMesh::Submesh>& StaticMesh::submeshes() const
+	{
+		return m_submeshes;
+	}
+
+	const std::vector<StaticMesh::Lod>& StaticMesh::lods() const
+	{
+		return m_lods;
+	}
+
+	GeometryArena::IndexType StaticMesh::indexType() const
+	{
+		return m_indexType;
+	}
+
+	bool StaticMesh::isReady() const
+	{
+		return m_ready;
+	}
+
+	bool StaticMesh::hasFailed() const
+	{
+		return m_failed;
 	}
 
 	void StaticMesh::draw() const
 	{
-		m_vao->bind();
-		m_ibo->bind(BufferUsageType::IndexBuffer);
-		glDrawElements(GL_TRIANGLES, (unsigned int)m_ibo->getCount(), GL_UNSIGNED_INT, nullptr);
+		const GeometryArena& meshArena = arena(m_indexType);
+		const GeometryArena::Range& meshRange = meshArena.range(m_allocation);
+
+		meshArena.bind();
+		glDrawElementsBaseVertex(GL_TRIANGLES, m_lods.front().indexCount, meshArena.glIndexType(),
+			(void*)(size_t(meshRange.firstIndex + m_lods.front().firstIndex) * meshArena.indexSize()), meshRange.baseVertex);
 	}
-}
\ No newline at end of file
+}
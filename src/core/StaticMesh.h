@@ -1,18 +1,24 @@
 #pragma once
 
+#include <atomic>
 #include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
-#include "TypedBuffer.h"
-#include "StaticMesh.h"
-#include "VertexArray.h"
+#include "Bounds.h"
+#include "GeometryArena.h"
 
 namespace BerylEngine
 {
-	class StaticMesh
+	class AsyncLoader;
+
+	class StaticMesh : NonCopyable
 	{
+		friend class AsyncLoader;
+
 	public:
 		struct Vertex
 		{
@@ -22,14 +28,122 @@ namespace BerylEngine
 			glm::vec4 tangentData; // Tangent vector + bitangent sign
 		};
 
+		/// <summary>
+		/// GPU format of Vertex, 20 bytes instead of 48.
+		/// Positions are relative to the mesh bounding box: position = center + extents * packed position.
+		/// </summary>
+		struct PackedVertex
+		{
+			glm::i16vec4 position; // snorm16, w unused
+			glm::uint normal; // snorm 10:10:10:2
+			glm::uint tangentData; // snorm 10:10:10:2, w is the bitangent sign
+			glm::uint uvs; // half2
+		};
+
+		/// <summary>
+		/// Meshes with at most this many vertices use 16-bit indices.
+		/// </summary>
+		static constexpr size_t MaxShortIndexVertices = 1 << 16;
+
+		/// <summary>
+		/// Range of the mesh's indices, relative to the mesh's first index.
+		/// </summary>
+		struct Submesh
+		{
+			unsigned int firstIndex;
+			unsigned int indexCount;
+		};
+
+		/// <summary>
+		/// Level of detail, as a range of the mesh's indices over the same vertices.
+		/// error is the deviation from the full detail mesh in object space units, it grows with each level.
+		/// </summary>
+		struct Lod
+		{
+			unsigned int firstIndex;
+			unsigned int indexCount;
+			float error;
+		};
+
+		static constexpr size_t MaxLods = 8;
+
 	private:
-		TypedBuffer<StaticMesh::Vertex> m_vbo;
-		std::unique_ptr<VertexArray> m_vao;
-		std::unique_ptr<TypedBuffer<unsigned int>> m_ibo;
+		GeometryArena::AllocationId m_allocation = GeometryArena::InvalidAllocation;
+		GeometryArena::IndexType m_indexType = GeometryArena::IndexType::UInt16;
+		Bounds m_bounds;
+		std::vector<Submesh> m_submeshes;
+		std::vector<Lod> m_lods;
+		bool m_ready = false;
+		std::atomic<bool> m_failed = false; // Set on the render thread, read by asset caches on any thread
 
 	public:
+		/// <summary>
+		/// Mesh without geometry, filled later by upload(). Used as the handle of meshes loaded asynchronously.
+		/// </summary>
+		StaticMesh() = default;
 		StaticMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
 
+		/// <summary>
+		/// Pack the vertices and narrow the indices when possible before uploading them, with precomputed bounds.
+		/// Without submeshes, the whole mesh is a single submesh. Without LODs, the whole mesh is the only level.
+		/// Submeshes only apply to the first level.
+		/// </summary>
+		StaticMesh(std::span<const Vertex> vertices, std::span<const unsigned int> indices, const Bounds& bounds,
+					std::vector<Submesh> submeshes = {}, std::vector<Lod> lods = {});
+
+		/// <summary>
+		/// Upload packed vertices and indices straight from the given memory (e.g. a mapped file).
+		/// The vertices must have been packed with bounds.box.
+		/// </summary>
+		StaticMesh(std::span<const PackedVertex> vertices, std::span<const uint16_t> indices, const Bounds& bounds,
+					std::vector<Submesh> submeshes = {}, std::vector<Lod> lods = {});
+		StaticMesh(std::span<const PackedVertex> vertices, std::span<const uint32_t> indices, const Bounds& bounds,
+					std::vector<Submesh> submeshes = {}, std::vector<Lod> lods = {});
+		~StaticMesh();
+
+		/// <summary>
+		/// Fill a mesh created empty. Same arguments as the packed constructors, must run on the render thread.
+		/// </summary>
+		void upload(std::span<const PackedVertex> vertices, std::span<const uint16_t> indices, const Bounds& bounds,
+					std::vector<Submesh> submeshes = {}, std::vector<Lod> lods = {});
+		void upload(std::span<const PackedVertex> vertices, std::span<const uint32_t> indices, const Bounds& bounds,
+					std::vector<Submesh> submeshes = {}, std::vector<Lod> lods = {});
+
+		/// <summary>
+		/// False until the geometry of a mesh created empty is uploaded. Other accessors are meaningless until then.
+		/// </summary>
+		bool isReady() const;
+
+		/// <summary>
+		/// True once the load of a mesh created empty failed. It then never becomes ready.
+		/// </summary>
+		bool hasFailed() const;
+
+		static std::vector<PackedVertex> packVertices(std::span<const Vertex> vertices, const AABB& box);
+		static std::vector<uint16_t> narrowIndices(std::span<const unsigned int> indices);
+
+		/// <summary>
+		/// Location of the mesh inside the shared geometry arena.
+		/// </summary>
+		const GeometryArena::Range& range() const;
+
+		/// <summary>
+		/// Object space bounds, computed from the vertices at creation.
+		/// </summary>
+		const Bounds& bounds() const;
+		const std::vector<Submesh>& submeshes() const;
+		const std::vector<Lod>& lods() const;
+		GeometryArena::IndexType indexType() const;
+
 		void draw() const;
+
+		/// <summary>
+		/// Arena holding the vertices and indices of every static mesh using the given index type. Created on first use.
+		/// </summary>
+		static GeometryArena& arena(GeometryArena::IndexType indexType);
+		static void releaseArenas();
+
+	private:
+		void uploadGeometry(std::span<const PackedVertex> vertices, const void* indices, size_t indexCount);
 	};
-}
\ No newline at end of file
+}
@@ -3,9 +3,16 @@
 #include <GL/glew.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#include <chrono>
 #include <filesystem>
+#include <limits>
 #include <spdlog/spdlog.h>
 
+#include "BlockCompression.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "RenderState.h"
+#include "TextureFile.h"
 #include "utils.h"
 
 namespace BerylEngine
@@ -25,6 +32,16 @@ namespace BerylEngine
 			return { GL_RGB, GL_RGB8, GL_UNSIGNED_BYTE };
 		case Texture::TextureFormat::RGBA8_UNORM:
 			return { GL_RGBA, GL_RGBA8, GL_UNSIGNED_BYTE };
+		case Texture::TextureFormat::BC1_UNORM:
+			return { GL_RGB, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_UNSIGNED_BYTE };
+		case Texture::TextureFormat::BC3_UNORM:
+			return { GL_RGBA, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_UNSIGNED_BYTE };
+		case Texture::TextureFormat::BC4_UNORM:
+			return { GL_RED, GL_COMPRESSED_RED_RGTC1, GL_UNSIGNED_BYTE };
+		case Texture::TextureFormat::BC5_UNORM:
+			return { GL_RG, GL_COMPRESSED_RG_RGTC2, GL_UNSIGNED_BYTE };
+		case Texture::TextureFormat::BC7_UNORM:
+			return { GL_RGBA, GL_COMPRESSED_RGBA_BPTC_UNORM, GL_UNSIGNED_BYTE };
 		case Texture::TextureFormat::Depth32_FLOAT:
 			return { GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT32F, GL_FLOAT };
 		default:
@@ -32,6 +49,13 @@ namespace BerylEngine
 		}
 	}
 
+	// Color images are decoded to 4 channels. Drivers convert 3-channel uploads on the CPU and most
+	// hardware pads RGB8 texels to 4 bytes anyway.
+	static Texture::TextureFormat decodedFormat(Texture::TextureFormat format)
+	{
+		return format == Texture::TextureFormat::RGB8_UNORM ? Texture::TextureFormat::RGBA8_UNORM : format;
+	}
+
 	Texture::Texture(int width, int height, TextureFormat format)
 		: m_width(width), m_height(height)
 	{
@@ -54,30 +78,257 @@ namespace BerylEngine
 		glGenerateTextureMipmap(m_handle);
 	}
 
-	std::shared_ptr<Texture> Texture::fromFile(const std::string& path, TextureFormat textureFormat)
+	// Upload levels one after the other from data, which is an offset into the pixel unpack buffer if one is bound
+	static void uploadLevels(unsigned int handle, Texture::TextureFormat format, int width, int height,
+							 const std::byte* data, int levelCount)
+	{
+		const TextureFormatGL formatGL = textureFormat2GL(format);
+
+		size_t offset = 0;
+		for (int level = 0; level < levelCount; level++)
+		{
+			const int levelWidth = std::max(width >> level, 1);
+			const int levelHeight = std::max(height >> level, 1);
+			const size_t size = Texture::levelSize(format, levelWidth, levelHeight);
+			const void* levelData = reinterpret_cast<const void*>(reinterpret_cast<uintptr_t>(data) + offset);
+
+			if (Texture::isCompressed(format))
+			{
+				glCompressedTextureSubImage2D(handle, level, 0, 0, levelWidth, levelHeight, formatGL.internalFormat,
+					GLsizei(size), levelData);
+			}
+			else
+			{
+				glTextureSubImage2D(handle, level, 0, 0, levelWidth, levelHeight, formatGL.format,
+					formatGL.componentType, levelData);
+			}
+			offset += size;
+		}
+	}
+
+	// Block-compressed levels cannot be generated on the GPU, so only their chain is allocated
+	static int storageLevels(Texture::TextureFormat format, int levelCount, int fullChainLevels)
+	{
+		return Texture::isCompressed(format) ? levelCount : fullChainLevels;
+	}
+
+	Texture::Texture(int width, int height, TextureFormat format, std::span<const std::byte> levels, int levelCount)
+		: m_width(width), m_height(height)
+	{
+		glCreateTextures(GL_TEXTURE_2D, 1, &m_handle);
+
+		const int storageLevelCount = storageLevels(format, levelCount, getMipLevel(width, height));
+		glTextureStorage2D(m_handle, storageLevelCount, textureFormat2GL(format).internalFormat, width, height);
+		uploadLevels(m_handle, format, width, height, levels.data(), levelCount);
+		if (levelCount < storageLevelCount)
+			glGenerateTextureMipmap(m_handle);
+	}
+
+	bool Texture::isCompressed(TextureFormat format)
+	{
+		return BlockCompression::blockSize(format) != 0;
+	}
+
+	size_t Texture::levelSize(TextureFormat format, int width, int height)
+	{
+		switch (format)
+		{
+		case TextureFormat::RGB8_UNORM:
+			return size_t(width) * height * 3;
+		case TextureFormat::RGBA8_UNORM:
+		case TextureFormat::Depth32_FLOAT:
+			return size_t(width) * height * 4;
+		default:
+			return BlockCompression::compressedSize(format, width, height);
+		}
+	}
+
+	static const char* formatName(Texture::TextureFormat format)
+	{
+		switch (format)
+		{
+		case Texture::TextureFormat::BC1_UNORM:
+			return "BC1";
+		case Texture::TextureFormat::BC3_UNORM:
+			return "BC3";
+		case Texture::TextureFormat::BC4_UNORM:
+			return "BC4";
+		case Texture::TextureFormat::BC5_UNORM:
+			return "BC5";
+		case Texture::TextureFormat::BC7_UNORM:
+			return "BC7";
+		default:
+			return "uncompressed";
+		}
+	}
+
+	// One cooked file per format and quality, so that loading an image in several formats does not cook it
+	// again every time
+	static std::string cookedFilePath(const std::string& path, Texture::TextureFormat format,
+									  Texture::CompressionQuality quality)
+	{
+		if (!Texture::isCompressed(format))
+			return fmt::format("{}.rgba8{}", path, TextureFileExtension);
+
+		static constexpr const char* qualityNames[] = { "fast", "normal", "high" };
+		return fmt::format("{}.{}-{}{}", path, formatName(format), qualityNames[int(quality)], TextureFileExtension);
+	}
+
+	// Normal maps are expected in BC5 and single channels in BC4, every other format is filtered as a color
+	static MipGenerator::Content mipContent(Texture::TextureFormat format)
+	{
+		switch (format)
+		{
+		case Texture::TextureFormat::BC4_UNORM:
+			return MipGenerator::Content::Linear;
+		case Texture::TextureFormat::BC5_UNORM:
+			return MipGenerator::Content::NormalMap;
+		default:
+			return MipGenerator::Content::Color;
+		}
+	}
+
+	bool Texture::loadFile(const std::string& path, TextureFormat format, CompressionQuality quality,
+						   MipChain& mipChain)
 	{
-		auto absPath = std::filesystem::absolute(path).string();
+		if (path.ends_with(TextureFileExtension))
+			return loadTextureFile(path, nullptr, nullptr, mipChain);
+
+		MappedFile file(path);
+		if (!file.isOpen())
+			return false;
+
+		// The cooked file is keyed by the content of the source, so edited images are cooked again.
+		// The content is only hashed when the size or write time of the source changed, or cannot be queried.
+		FileStamp sourceStamp;
+		const bool hasStamp = fileStamp(path, sourceStamp);
+		if (!hasStamp)
+			sourceStamp = {};
+		uint64_t sourceHash = 0;
+		const TextureFormat cookedFormat = decodedFormat(format);
+		const std::string cookedPath = cookedFilePath(path, cookedFormat, quality);
+		std::error_code error;
+		if (std::filesystem::exists(cookedPath, error)
+			&& isTextureFileCurrent(cookedPath, hasStamp ? &sourceStamp : nullptr, file.data(), sourceHash)
+			&& loadTextureFile(cookedPath, &cookedFormat, &quality, mipChain))
+			return true;
+
+		// The flag is per thread, decoding may run on several threads at once
+		stbi_set_flip_vertically_on_load_thread(true);
 
 		int width, height, channels;
-		stbi_set_flip_vertically_on_load(true);
-		unsigned char* data = stbi_load(path.c_str(), &width, &height, &channels, 0);
-		if (data == nullptr)
+		unsigned char* decoded = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(file.data().data()),
+			int(file.size()), &width, &height, &channels, 4);
+		if (decoded == nullptr)
+			return false;
+
+		const auto start = std::chrono::steady_clock::now();
+		const std::vector<std::vector<unsigned char>> levels = MipGenerator::generate(
+			std::span<const unsigned char>(decoded, size_t(width) * height * 4), width, height, mipContent(format));
+		stbi_image_free(decoded);
+
+		mipChain.format = cookedFormat;
+		mipChain.width = width;
+		mipChain.height = height;
+		mipChain.levelCount = int(levels.size());
+		mipChain.quality = quality;
+		mipChain.data.clear();
+
+		float firstLevelPsnr = std::numeric_limits<float>::infinity();
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			if (!isCompressed(format))
+			{
+				const auto bytes = std::as_bytes(std::span(levels[i]));
+				mipChain.data.insert(mipChain.data.end(), bytes.begin(), bytes.end());
+				continue;
+			}
+
+			const int levelWidth = std::max(width >> i, 1);
+			const int levelHeight = std::max(height >> i, 1);
+			const std::vector<std::byte> blocks = BlockCompression::compress(levels[i], levelWidth, levelHeight, format,
+				quality);
+			if (i == 0)
+			{
+				firstLevelPsnr = BlockCompression::psnr(levels[i],
+					BlockCompression::decompress(blocks, levelWidth, levelHeight, format), format);
+			}
+			mipChain.data.insert(mipChain.data.end(), blocks.begin(), blocks.end());
+		}
+
+		const std::chrono::duration<float, std::milli> duration = std::chrono::steady_clock::now() - start;
+		spdlog::debug("Cooked {} to {} in {:.1f} ms: {} levels, {} KiB, PSNR {:.2f} dB.", path, formatName(format),
+			duration.count(), mipChain.levelCount, mipChain.data.size() / 1024, firstLevelPsnr);
+
+		if (sourceHash == 0)
+			sourceHash = fnv1a(file.data());
+		if (!writeTextureFile(cookedPath, mipChain, sourceHash, sourceStamp))
+			spdlog::warn("Failed to cache texture {}, it will be cooked again next time.", path);
+
+		return true;
+	}
+
+	std::shared_ptr<Texture> Texture::fromFile(const std::string& path, TextureFormat textureFormat,
+											   CompressionQuality quality)
+	{
+		MipChain mipChain;
+		if (!loadFile(path, textureFormat, quality, mipChain))
 		{
 			spdlog::error("Failed to load texture from {}.", path);
 			return nullptr;
 		}
 
-		auto texture = std::make_shared<Texture>(width, height, textureFormat, data);
-
-		stbi_image_free(data);
+		auto texture = std::make_shared<Texture>(mipChain.width, mipChain.height, mipChain.format,
+			std::span<const std::byte>(mipChain.data), mipChain.levelCount);
 
 		spdlog::trace("Loaded texture from {}.", path);
 
 		return texture;
 	}
 
+	unsigned int Texture::createFromPixelBuffer(unsigned int buffer, int width, int height, TextureFormat format,
+												int levelCount)
+	{
+		unsigned int handle;
+		glCreateTextures(GL_TEXTURE_2D, 1, &handle);
+
+		const int storageLevelCount = storageLevels(format, levelCount, getMipLevel(width, height));
+		glTextureStorage2D(handle, storageLevelCount, textureFormat2GL(format).internalFormat, width, height);
+
+		// With an unpack buffer bound, the pixel pointers are offsets into it and the copy does not stall the caller
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+		uploadLevels(handle, format, width, height, nullptr, levelCount);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (levelCount < storageLevelCount)
+			glGenerateTextureMipmap(handle);
+
+		return handle;
+	}
+
+	static std::unique_ptr<Texture> s_placeholder;
+
+	const Texture& Texture::placeholder()
+	{
+		if (!s_placeholder)
+		{
+			unsigned char white[4] = { 255, 255, 255, 255 };
+			s_placeholder = std::make_unique<Texture>(1, 1, TextureFormat::RGBA8_UNORM, white);
+		}
+
+		return *s_placeholder;
+	}
+
+	void Texture::releasePlaceholder()
+	{
+		s_placeholder.reset();
+	}
+
 	Texture::~Texture()
 	{
+		if (m_handle == 0)
+			return;
+
+		RenderState::releaseTexture(m_handle);
 		glDeleteTextures(1, &m_handle);
 
 		spdlog::trace("Texture {} deleted.", m_handle);
@@ -93,6 +344,16 @@ namespace BerylEngine
 		return glm::ivec2(m_width, m_height);
 	}
 
+	bool Texture::isReady() const
+	{
+		return m_ready;
+	}
+
+	bool Texture::hasFailed() const
+	{
+		return m_failed;
+	}
+
 	void Texture::bind() const
 	{
 		glBindTexture(GL_TEXTURE_2D, m_handle);
@@ -105,11 +366,10 @@ namespace BerylEngine
 
 	void Texture::bindToUnit(const int unit) const
 	{
-		glActiveTexture(GL_TEXTURE0 + unit);
-		bind();
+		RenderState::bindTextureUnit(unit, m_handle);
 	}
 
-	int Texture::getMipLevel(int width, int height) const
+	int Texture::getMipLevel(int width, int height)
 	{
 		unsigned int maxSize = std::max(width, height);
 		return 1 + int(std::floor(std::log2(maxSize)));
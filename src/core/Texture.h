@@ -1,43 +1,135 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <string>
 #include <memory>
+#include <span>
+#include <vector>
 #include <glm/glm.hpp>
 
 #include "utils.h"
 
 namespace BerylEngine
 {
+	class AsyncLoader;
+
 	class Texture : public NonCopyable
 	{
+		friend class AsyncLoader;
+
 	public:
 		enum class TextureFormat
 		{
 			RGBA8_UNORM,
 			RGB8_UNORM,
 
+			// Block-compressed, see BlockCompression
+			BC1_UNORM, // RGB, 4 bits per texel
+			BC3_UNORM, // RGBA, 8 bits per texel
+			BC4_UNORM, // R, 4 bits per texel
+			BC5_UNORM, // RG, 8 bits per texel, for normal maps
+			BC7_UNORM, // RGBA, 8 bits per texel, higher quality than BC1 and BC3
+
 			Depth32_FLOAT
 		};
 
+		/// <summary>
+		/// Speed to quality trade-off of the block compression encoder:
+		/// - Fast fits endpoints once, along the principal axis of the block's colors.
+		/// - Normal refines the endpoints with least squares and tries every BC7 parity bit and BC4 mode.
+		/// - High refines further, also tries the 3-color BC1 mode and searches around the BC4 endpoints.
+		/// </summary>
+		enum class CompressionQuality
+		{
+			Fast,
+			Normal,
+			High
+		};
+
 		Texture(int width, int height, TextureFormat format);
 		Texture(int width, int height, TextureFormat format, unsigned char* data);
+
+		/// <summary>
+		/// Upload levelCount mip levels stored one after the other, each tightly packed.
+		/// The rest of the chain is generated on the GPU, except for block-compressed formats.
+		/// </summary>
+		Texture(int width, int height, TextureFormat format, std::span<const std::byte> levels, int levelCount);
 		~Texture();
 
-		static std::shared_ptr<Texture> fromFile(const std::string& path, TextureFormat textureFormat);
+		/// <summary>
+		/// Levels of an image in the layout of the levels constructor, ready to upload.
+		/// </summary>
+		struct MipChain
+		{
+			std::vector<std::byte> data;
+			TextureFormat format;
+			int width;
+			int height;
+			int levelCount;
+			CompressionQuality quality = CompressionQuality::Normal; // Of the encoder, for block-compressed formats
+		};
+
+		/// <summary>
+		/// Load a cooked texture file, or an image file. Images are cooked on first load: their whole mip chain is
+		/// filtered on the CPU, encoded with quality when block-compressed, and cached next to them in a
+		/// TextureFileExtension file named after the format and quality, e.g. "albedo.png.BC7-normal.btex".
+		/// </summary>
+		static std::shared_ptr<Texture> fromFile(const std::string& path, TextureFormat textureFormat,
+												 CompressionQuality quality = CompressionQuality::Normal);
+
+		static bool isCompressed(TextureFormat format);
+
+		/// <summary>
+		/// Bytes of a single width x height level.
+		/// </summary>
+		static size_t levelSize(TextureFormat format, int width, int height);
 
 		unsigned int getId() const;
 		glm::ivec2 getSize() const;
 
+		/// <summary>
+		/// False while an asynchronously loaded texture is in flight. Its id is 0 and its size is 0 until then.
+		/// </summary>
+		bool isReady() const;
+
+		/// <summary>
+		/// True once an asynchronously loaded texture failed to load. It then never becomes ready.
+		/// </summary>
+		bool hasFailed() const;
+
+		/// <summary>
+		/// 1x1 white texture bound by materials instead of textures that are not ready. Created on first use.
+		/// </summary>
+		static const Texture& placeholder();
+		static void releasePlaceholder();
+
 		void bind() const;
 		void unbind() const;
 
 		void bindToUnit(const int unit) const;
 
 	private:
-		unsigned int m_handle;
-		int m_width;
-		int m_height;
+		unsigned int m_handle = 0;
+		int m_width = 0;
+		int m_height = 0;
+		bool m_ready = true;
+		std::atomic<bool> m_failed = false; // Set on the render thread, read by asset caches on any thread
+
+		Texture() = default;
+
+		/// <summary>
+		/// CPU part of fromFile: load the cooked file, or decode, filter and encode the image. Safe to call from any thread.
+		/// </summary>
+		static bool loadFile(const std::string& path, TextureFormat format, CompressionQuality quality,
+							 MipChain& mipChain);
 
-		int getMipLevel(int width, int height) const;
+		/// <summary>
+		/// Create a texture from a mip chain stored in the pixel unpack buffer.
+		/// Only issues GL calls, so it can run on a context shared with the main one.
+		/// </summary>
+		static unsigned int createFromPixelBuffer(unsigned int buffer, int width, int height, TextureFormat format,
+												  int levelCount);
+		static int getMipLevel(int width, int height);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,278 @@
+#include "TextureFile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+#include "Lz4.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+namespace BerylEngine
+{
+	namespace
+	{
+		constexpr uint32_t TextureFileMagic = 0x58455442; // "BTEX"
+		constexpr uint32_t TextureFileVersion = 3;
+		constexpr size_t TextureFileAlignment = 16;
+
+		// Large levels are split so that a single level still expands on several threads
+		constexpr size_t TextureFileChunkSize = 256 * 1024;
+
+		// The chunk table follows the header, then the chunks, each aligned to TextureFileAlignment.
+		// Chunks hold the levels one after the other, from the largest, and never span two levels.
+		struct TextureFileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t format;
+			uint32_t width;
+			uint32_t height;
+			uint32_t levelCount;
+			uint32_t quality; // Texture::CompressionQuality
+			uint32_t padding;
+			uint64_t sourceHash;
+			uint64_t sourceSize;
+			int64_t sourceWriteTime;
+			uint64_t chunkCount;
+			uint64_t dataSize; // Bytes of all levels once expanded
+		};
+
+		static_assert(sizeof(TextureFileHeader) % alignof(uint64_t) == 0);
+
+		struct TextureFileChunk
+		{
+			uint64_t offset;
+			uint32_t storedSize; // Equal to size when the chunk is not compressed
+			uint32_t size;
+		};
+
+		static size_t alignUp(size_t offset)
+		{
+			return (offset + TextureFileAlignment - 1) & ~(TextureFileAlignment - 1);
+		}
+	}
+
+	bool writeTextureFile(const std::string& path, const Texture::MipChain& mipChain, uint64_t sourceHash,
+						  const FileStamp& sourceStamp, bool compress)
+	{
+		std::vector<TextureFileChunk> chunks;
+		size_t levelOffset = 0;
+		for (int level = 0; level < mipChain.levelCount; level++)
+		{
+			const size_t levelSize = Texture::levelSize(mipChain.format, std::max(mipChain.width >> level, 1),
+				std::max(mipChain.height >> level, 1));
+			for (size_t offset = 0; offset < levelSize; offset += TextureFileChunkSize)
+			{
+				const uint32_t size = uint32_t(std::min(TextureFileChunkSize, levelSize - offset));
+				chunks.push_back({ levelOffset + offset, size, size });
+			}
+			levelOffset += levelSize;
+		}
+
+		if (levelOffset != mipChain.data.size())
+		{
+			spdlog::error("Failed to write texture file {}: the mip chain does not match its size.", path);
+			return false;
+		}
+
+		// Chunk offsets are into the mip chain until the chunks are compressed and laid out
+		std::vector<std::vector<std::byte>> stored(chunks.size());
+		if (compress)
+		{
+			ThreadPool::global().parallelFor(chunks.size(), [&](size_t i)
+				{
+					const std::span<const std::byte> source(mipChain.data.data() + chunks[i].offset, chunks[i].size);
+					std::vector<std::byte> compressed(Lz4::compressBound(source.size()));
+					compressed.resize(Lz4::compress(source, compressed));
+					if (compressed.size() < source.size())
+						stored[i] = std::move(compressed);
+				});
+		}
+
+		size_t offset = alignUp(sizeof(TextureFileHeader) + chunks.size() * sizeof(TextureFileChunk));
+		std::vector<std::span<const std::byte>> payloads(chunks.size());
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			payloads[i] = stored[i].empty()
+				? std::span<const std::byte>(mipChain.data.data() + chunks[i].offset, chunks[i].size)
+				: std::span<const std::byte>(stored[i]);
+			chunks[i].offset = offset;
+			chunks[i].storedSize = uint32_t(payloads[i].size());
+			offset = alignUp(offset + payloads[i].size());
+		}
+
+		TextureFileHeader header = {};
+		header.magic = TextureFileMagic;
+		header.version = TextureFileVersion;
+		header.format = uint32_t(mipChain.format);
+		header.width = uint32_t(mipChain.width);
+		header.height = uint32_t(mipChain.height);
+		header.levelCount = uint32_t(mipChain.levelCount);
+		header.quality = uint32_t(mipChain.quality);
+		header.sourceHash = sourceHash;
+		header.sourceSize = sourceStamp.size;
+		header.sourceWriteTime = sourceStamp.writeTime;
+		header.chunkCount = chunks.size();
+		header.dataSize = mipChain.data.size();
+
+		static constexpr std::byte padding[TextureFileAlignment] = {};
+		std::vector<std::span<const std::byte>> parts = { std::as_bytes(std::span(&header, 1)),
+			std::as_bytes(std::span(chunks)) };
+		size_t written = sizeof(header) + chunks.size() * sizeof(TextureFileChunk);
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			parts.push_back(std::span(padding, chunks[i].offset - written));
+			parts.push_back(payloads[i]);
+			written = chunks[i].offset + payloads[i].size();
+		}
+
+		return writeFileAtomically(path, parts);
+	}
+
+	bool isTextureFileCurrent(const std::string& path, const FileStamp* sourceStamp,
+							  std::span<const std::byte> source, uint64_t& sourceHash)
+	{
+		// Plain file streams, so that the file is not mapped while it is patched
+		TextureFileHeader header;
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+				|| header.magic != TextureFileMagic || header.version != TextureFileVersion)
+				return false;
+		}
+
+		if (sourceStamp && header.sourceSize == sourceStamp->size && header.sourceWriteTime == sourceStamp->writeTime)
+			return true;
+
+		sourceHash = fnv1a(source);
+		if (header.sourceHash != sourceHash)
+		{
+			spdlog::debug("Texture file {} is out of date.", path);
+			return false;
+		}
+		if (!sourceStamp)
+			return true;
+
+		header.sourceSize = sourceStamp->size;
+		header.sourceWriteTime = sourceStamp->writeTime;
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (!file)
+			spdlog::debug("Failed to update the source stamp of texture file {}.", path);
+
+		return true;
+	}
+
+	bool loadTextureFile(const std::string& path, const Texture::TextureFormat* expectedFormat,
+						 const Texture::CompressionQuality* expectedQuality, Texture::MipChain& mipChain)
+	{
+		MappedFile file(path);
+		if (!file.isOpen())
+		{
+			spdlog::error("Failed to open texture file {}.", path);
+			return false;
+		}
+
+		const std::span<const std::byte> data = file.data();
+		TextureFileHeader header;
+		if (data.size() < sizeof(header))
+		{
+			spdlog::error("Failed to load texture file {}: truncated header.", path);
+			return false;
+		}
+		std::memcpy(&header, data.data(), sizeof(header));
+
+		if (header.magic != TextureFileMagic || header.version != TextureFileVersion
+			|| header.format > uint32_t(Texture::TextureFormat::BC7_UNORM)
+			|| header.quality > uint32_t(Texture::CompressionQuality::High))
+		{
+			spdlog::debug("Texture file {} has an unsupported format or version.", path);
+			return false;
+		}
+
+		// The quality only matters to the encoder, uncompressed levels are the same whatever it is
+		const auto format = Texture::TextureFormat(header.format);
+		const auto quality = Texture::CompressionQuality(header.quality);
+		if ((expectedFormat != nullptr && format != *expectedFormat)
+			|| (expectedQuality != nullptr && Texture::isCompressed(format) && quality != *expectedQuality))
+		{
+			spdlog::debug("Texture file {} is out of date.", path);
+			return false;
+		}
+
+		// The level sizes follow from the header, the chunks must cover them exactly
+		const int width = int(header.width);
+		const int height = int(header.height);
+		size_t dataSize = 0;
+		const bool validSize = width > 0 && height > 0 && width <= 16384 && height <= 16384 && header.levelCount > 0
+			&& int(header.levelCount) <= 1 + int(std::log2(std::max(width, height)));
+		for (int level = 0; validSize && level < int(header.levelCount); level++)
+			dataSize += Texture::levelSize(format, std::max(width >> level, 1), std::max(height >> level, 1));
+
+		const size_t tableEnd = sizeof(header) + header.chunkCount * sizeof(TextureFileChunk);
+		if (!validSize || dataSize != header.dataSize || header.chunkCount > data.size() / sizeof(TextureFileChunk)
+			|| tableEnd > data.size())
+		{
+			spdlog::error("Failed to load texture file {}: corrupted header.", path);
+			return false;
+		}
+
+		std::vector<TextureFileChunk> chunks(header.chunkCount);
+		std::memcpy(chunks.data(), data.data() + sizeof(header), chunks.size() * sizeof(TextureFileChunk));
+
+		std::vector<size_t> destinations(chunks.size());
+		size_t expandedSize = 0;
+		for (size_t i = 0; i < chunks.size(); i++)
+		{
+			const TextureFileChunk& chunk = chunks[i];
+			if (chunk.offset < tableEnd || chunk.offset > data.size() || chunk.storedSize > data.size() - chunk.offset
+				|| chunk.storedSize > chunk.size)
+			{
+				spdlog::error("Failed to load texture file {}: truncated or corrupted chunk.", path);
+				return false;
+			}
+			destinations[i] = expandedSize;
+			expandedSize += chunk.size;
+		}
+		if (expandedSize != dataSize)
+		{
+			spdlog::error("Failed to load texture file {}: the chunks do not match the levels.", path);
+			return false;
+		}
+
+		mipChain.data.resize(dataSize);
+		std::atomic<bool> corrupted = false;
+		ThreadPool::global().parallelFor(chunks.size(), [&](size_t i)
+			{
+				const TextureFileChunk& chunk = chunks[i];
+				const std::span<const std::byte> source = data.subspan(chunk.offset, chunk.storedSize);
+				const std::span<std::byte> destination(mipChain.data.data() + destinations[i], chunk.size);
+				if (chunk.storedSize == chunk.size)
+					std::memcpy(destination.data(), source.data(), source.size());
+				else if (!Lz4::decompress(source, destination))
+					corrupted = true;
+			});
+
+		if (corrupted)
+		{
+			spdlog::error("Failed to load texture file {}: corrupted compressed chunk.", path);
+			return false;
+		}
+
+		mipChain.format = format;
+		mipChain.width = width;
+		mipChain.height = height;
+		mipChain.levelCount = int(header.levelCount);
+		mipChain.quality = quality;
+
+		spdlog::trace("Texture loaded from {}.", path);
+
+		return true;
+	}
+}
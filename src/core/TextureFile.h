@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include "Texture.h"
+
+namespace BerylEngine
+{
+	/// <summary>
+	/// Extension of cooked texture files, which are named after their source, format and quality.
+	/// </summary>
+	constexpr const char* TextureFileExtension = ".btex";
+
+	/// <summary>
+	/// Write a whole mip chain in the cooked texture format. sourceHash identifies the image it was cooked from,
+	/// sourceStamp the file it was read from, empty when unknown, and mipChain.quality the encoder settings.
+	/// Levels are split in chunks that are LZ4 compressed independently when compress is set,
+	/// so that loading can expand them in parallel. Chunks that do not shrink are stored as is.
+	/// </summary>
+	bool writeTextureFile(const std::string& path, const Texture::MipChain& mipChain, uint64_t sourceHash = 0,
+						  const FileStamp& sourceStamp = {}, bool compress = true);
+
+	/// <summary>
+	/// Whether the cooked file at path was cooked from source. The source is only hashed, into sourceHash, when its
+	/// size or write time differ from the recorded ones. If the content is the same, e.g. after a copy, the file
+	/// records the new stamp. Call before the file is loaded, it is patched in place.
+	/// Without a sourceStamp, the source is always hashed and the file is not patched.
+	/// </summary>
+	bool isTextureFileCurrent(const std::string& path, const FileStamp* sourceStamp,
+							  std::span<const std::byte> source, uint64_t& sourceHash);
+
+	/// <summary>
+	/// Read a cooked texture file, expanding its chunks on the global thread pool.
+	/// Fails quietly when the file is out of date: in another format than expectedFormat, or block-compressed
+	/// with another quality than expectedQuality. Either check is skipped when null.
+	/// </summary>
+	bool loadTextureFile(const std::string& path, const Texture::TextureFormat* expectedFormat,
+						 const Texture::CompressionQuality* expectedQuality, Texture::MipChain& mipChain);
+}
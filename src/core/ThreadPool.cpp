@@ -0,0 +1,115 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <spdlog/spdlog.h>
+
+namespace BerylEngine
+{
+	ThreadPool::ThreadPool(size_t threadCount)
+	{
+		if (threadCount == 0)
+			threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 2) - 1;
+
+		m_threads.reserve(threadCount);
+		for (size_t i = 0; i < threadCount; i++)
+			m_threads.emplace_back([this]() { workerLoop(); });
+
+		spdlog::trace("Thread pool started with {} threads.", threadCount);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_stopping = true;
+		}
+		m_condition.notify_all();
+
+		for (auto& thread : m_threads)
+			thread.join();
+	}
+
+	size_t ThreadPool::threadCount() const
+	{
+		return m_threads.size();
+	}
+
+	void ThreadPool::enqueue(std::function<void()> task)
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_tasks.push(std::move(task));
+		}
+		m_condition.notify_one();
+	}
+
+	void ThreadPool::workerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock lock(m_mutex);
+				m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+				if (m_stopping && m_tasks.empty())
+					return;
+
+				task = std::move(m_tasks.front());
+				m_tasks.pop();
+			}
+
+			task();
+		}
+	}
+
+	void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body)
+	{
+		if (count == 0)
+			return;
+
+		// Shared with the helper tasks, which may start after this call returned and then find no work
+		struct State
+		{
+			std::function<void(size_t)> body;
+			size_t count;
+			std::atomic<size_t> next = 0;
+			std::atomic<size_t> done = 0;
+			std::mutex mutex;
+			std::condition_variable finished;
+		};
+
+		auto state = std::make_shared<State>();
+		state->body = body;
+		state->count = count;
+
+		auto work = [](State& state)
+		{
+			size_t index;
+			while ((index = state.next.fetch_add(1)) < state.count)
+			{
+				state.body(index);
+				if (state.done.fetch_add(1) + 1 == state.count)
+				{
+					std::lock_guard lock(state.mutex);
+					state.finished.notify_all();
+				}
+			}
+		};
+
+		const size_t helperCount = std::min(m_threads.size(), count - 1);
+		for (size_t i = 0; i < helperCount; i++)
+			enqueue([state, work]() { work(*state); });
+
+		work(*state);
+
+		std::unique_lock lock(state->mutex);
+		state->finished.wait(lock, [&]() { return state->done == state->count; });
+	}
+
+	ThreadPool& ThreadPool::global()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+}
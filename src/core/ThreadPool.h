@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "utils.h"
+
+namespace BerylEngine
+{
+	/// <summary>
+	/// Fixed set of worker threads consuming a FIFO queue of tasks.
+	/// </summary>
+	class ThreadPool : NonMovable
+	{
+	public:
+		/// <summary>
+		/// A thread count of 0 uses one thread per hardware thread, minus the calling thread.
+		/// </summary>
+		ThreadPool(size_t threadCount = 0);
+		~ThreadPool();
+
+		size_t threadCount() const;
+
+		template<typename F>
+		auto submit(F&& task) -> std::future<std::invoke_result_t<F>>
+		{
+			using Result = std::invoke_result_t<F>;
+
+			auto packagedTask = std::make_shared<std::packaged_task<Result()>>(FWD(task));
+			std::future<Result> future = packagedTask->get_future();
+			enqueue([packagedTask]() { (*packagedTask)(); });
+			return future;
+		}
+
+		/// <summary>
+		/// Call body(i) for every i in [0, count) and return once all calls are done.
+		/// The calling thread takes part in the work, so this can safely be nested in tasks.
+		/// </summary>
+		void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+		/// <summary>
+		/// Pool shared by the engine. Created on first use.
+		/// </summary>
+		static ThreadPool& global();
+
+	private:
+		std::vector<std::thread> m_threads;
+		std::queue<std::function<void()>> m_tasks;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		bool m_stopping = false;
+
+		void enqueue(std::function<void()> task);
+		void workerLoop();
+	};
+}
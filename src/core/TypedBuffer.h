@@ -4,6 +4,28 @@
 
 namespace BerylEngine
 {
+	template <typename T>
+	class TypedMapping
+	{
+	private:
+		BufferMapping m_mapping;
+
+	public:
+		TypedMapping(BufferMapping&& mapping) : m_mapping(std::move(mapping))
+		{
+		}
+
+		std::span<T> data() const
+		{
+			return std::span<T>(static_cast<T*>(m_mapping.data()), m_mapping.size() / sizeof(T));
+		}
+
+		T& operator[](size_t index) const
+		{
+			return static_cast<T*>(m_mapping.data())[index];
+		}
+	};
+
 	template <typename T>
 	class TypedBuffer : public ByteBuffer
 	{
@@ -18,9 +40,34 @@ namespace BerylEngine
 		{
 		}
 
+		TypedBuffer(const T* data, size_t count, BufferUsageHint usageHint)
+			: ByteBuffer(data, count * sizeof(T), usageHint)
+		{
+		}
+
+		TypedBuffer(const T* data, size_t count, BufferStorage storage)
+			: ByteBuffer(data, count * sizeof(T), storage)
+		{
+		}
+
 		size_t getCount() const
 		{
 			return m_size / sizeof(T);
 		}
+
+		void update(std::span<const T> data, size_t first = 0)
+		{
+			ByteBuffer::update(std::as_bytes(data), first * sizeof(T));
+		}
+
+		TypedMapping<T> map(size_t first, size_t count, AccessType accessType) const
+		{
+			return TypedMapping<T>(ByteBuffer::map(first * sizeof(T), count * sizeof(T), accessType));
+		}
+
+		T* persistentData() const
+		{
+			return static_cast<T*>(ByteBuffer::persistentData());
+		}
 	};
-}
\ No newline at end of file
+}
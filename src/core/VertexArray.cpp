@@ -4,12 +4,14 @@
 
 #include <spdlog/spdlog.h>
 
+#include "RenderState.h"
+
 namespace BerylEngine
 {
 	VertexArray::VertexArray(const ByteBuffer& vb, const VertexBufferLayout& layout)
 	{
 		glGenVertexArrays(1, &m_handle);
-		glBindVertexArray(m_handle);
+		RenderState::bindVertexArray(m_handle);
 
 		vb.bind(BufferUsageType::VertexBuffer);
 		const auto& elements = layout.get_elements();
@@ -21,14 +23,37 @@ namespace BerylEngine
 				elm.normalized, layout.get_stride(), (const void*)offset);
 			glEnableVertexAttribArray(i);
 
-			offset += elm.count * VertexBufferElement::get_type_size(elm.type);
+			offset += elm.get_size();
+		}
+
+		spdlog::trace("Vertex array {} created", m_handle);
+	}
+
+	VertexArray::VertexArray(const ByteBuffer& vb, const ByteBuffer& ib, const VertexBufferLayout& layout)
+	{
+		glCreateVertexArrays(1, &m_handle);
+
+		const auto& elements = layout.get_elements();
+		unsigned int offset = 0;
+		for (unsigned int i = 0; i < elements.size(); i++)
+		{
+			const auto elm = elements[i];
+			glVertexArrayAttribFormat(m_handle, i, elm.count, elm.type, elm.normalized, offset);
+			glVertexArrayAttribBinding(m_handle, i, 0);
+			glEnableVertexArrayAttrib(m_handle, i);
+
+			offset += elm.get_size();
 		}
 
+		setVertexBuffer(vb, layout.get_stride());
+		setIndexBuffer(ib);
+
 		spdlog::trace("Vertex array {} created", m_handle);
 	}
 
 	VertexArray::~VertexArray()
 	{
+		RenderState::releaseVertexArray(m_handle);
 		glDeleteVertexArrays(1, &m_handle);
 
 		spdlog::trace("Vertex array {} deleted", m_handle);
@@ -36,11 +61,21 @@ namespace BerylEngine
 
 	void VertexArray::bind() const
 	{
-		glBindVertexArray(m_handle);
+		RenderState::bindVertexArray(m_handle);
 	}
 
 	void VertexArray::unbind() const
 	{
-		glBindVertexArray(0);
+		RenderState::bindVertexArray(0);
+	}
+
+	void VertexArray::setVertexBuffer(const ByteBuffer& vb, unsigned int stride)
+	{
+		glVertexArrayVertexBuffer(m_handle, 0, vb.getHandle(), 0, stride);
+	}
+
+	void VertexArray::setIndexBuffer(const ByteBuffer& ib)
+	{
+		glVertexArrayElementBuffer(m_handle, ib.getHandle());
 	}
 }
\ No newline at end of file
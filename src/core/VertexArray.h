@@ -9,16 +9,20 @@ namespace BerylEngine
 	class VertexArray : NonCopyable
 	{
 	private:
-		unsigned int m_handle;
+		unsigned int m_handle = 0;
 
 	public:
 		VertexArray() = default;
 		VertexArray(const ByteBuffer& vb, const VertexBufferLayout& layout);
+		VertexArray(const ByteBuffer& vb, const ByteBuffer& ib, const VertexBufferLayout& layout);
 		VertexArray(VertexArray&&) = default;
 		VertexArray& operator=(VertexArray&&) = default;
 		~VertexArray();
 
 		void bind() const;
 		void unbind() const;
+
+		void setVertexBuffer(const ByteBuffer& vb, unsigned int stride);
+		void setIndexBuffer(const ByteBuffer& ib);
 	};
 }
\ No newline at end of file
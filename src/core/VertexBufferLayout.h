@@ -1,6 +1,7 @@
 #pragma once
 
 #include <GL/glew.h>
+#include <cstdint>
 #include <vector>
 
 namespace BerylEngine
@@ -19,18 +20,51 @@ namespace BerylEngine
 				return sizeof(GLfloat);
 			case GL_UNSIGNED_INT:
 				return sizeof(GLuint);
+			case GL_HALF_FLOAT:
+				return sizeof(GLhalf);
+			case GL_SHORT:
+				return sizeof(GLshort);
+			case GL_UNSIGNED_SHORT:
+				return sizeof(GLushort);
+			case GL_BYTE:
+				return sizeof(GLbyte);
+			case GL_UNSIGNED_BYTE:
+				return sizeof(GLubyte);
 			default:
 				return 0;
 			}
 		}
+
+		/// <summary>
+		/// Size of the whole element in bytes. Packed types hold every component in a single 32-bit word.
+		/// </summary>
+		unsigned int get_size() const
+		{
+			if (type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV)
+				return sizeof(GLuint);
+
+			return count * get_type_size(type);
+		}
 	};
 
+	/// <summary>
+	/// Tag types for the vertex formats that have no C++ equivalent.
+	/// </summary>
+	struct HalfFloat {};
+	struct Packed1010102 {};
+
 	class VertexBufferLayout
 	{
 	private:
 		std::vector<VertexBufferElement> m_elements;
 		unsigned int m_stride = 0;
 
+		void push(unsigned int type, unsigned int count, bool normalized)
+		{
+			m_elements.push_back({ type, count, normalized });
+			m_stride += m_elements.back().get_size();
+		}
+
 	public:
 		const std::vector<VertexBufferElement>& get_elements() const
 		{
@@ -42,22 +76,59 @@ namespace BerylEngine
 			return m_stride;
 		}
 
+		/// <summary>
+		/// Append an attribute. Normalized integers are read as [0, 1] or [-1, 1] floats by shaders.
+		/// Packed1010102 always has 4 signed components.
+		/// </summary>
 		template<typename T>
-		void Add(unsigned int count) = delete;
+		void Add(unsigned int count, bool normalized = false) = delete;
+
+		template<>
+		void Add<float>(unsigned int count, bool normalized)
+		{
+			push(GL_FLOAT, count, false);
+		}
+
+		template<>
+		void Add<unsigned int>(unsigned int count, bool normalized)
+		{
+			push(GL_UNSIGNED_INT, count, normalized);
+		}
 
 		template<>
-		void Add<float>(unsigned int count)
+		void Add<HalfFloat>(unsigned int count, bool normalized)
 		{
-			m_elements.push_back({ GL_FLOAT, count, false });
-			m_stride += count * VertexBufferElement::get_type_size(GL_FLOAT);
+			push(GL_HALF_FLOAT, count, false);
 		}
 
 		template<>
-		void Add<unsigned int>(unsigned int count)
+		void Add<int16_t>(unsigned int count, bool normalized)
 		{
-			m_elements.push_back({ GL_UNSIGNED_INT, count, false });
-			m_stride += count * VertexBufferElement::get_type_size(GL_UNSIGNED_INT);
+			push(GL_SHORT, count, normalized);
+		}
+
+		template<>
+		void Add<uint16_t>(unsigned int count, bool normalized)
+		{
+			push(GL_UNSIGNED_SHORT, count, normalized);
+		}
+
+		template<>
+		void Add<int8_t>(unsigned int count, bool normalized)
+		{
+			push(GL_BYTE, count, normalized);
+		}
+
+		template<>
+		void Add<uint8_t>(unsigned int count, bool normalized)
+		{
+			push(GL_UNSIGNED_BYTE, count, normalized);
+		}
+
+		template<>
+		void Add<Packed1010102>(unsigned int count, bool normalized)
+		{
+			push(GL_INT_2_10_10_10_REV, 4, normalized);
 		}
 	};
 }
-
@@ -3,6 +3,9 @@
 #include <GL/glew.h>
 #include <spdlog/spdlog.h>
 
+#include "Program.h"
+#include "StaticMesh.h"
+#include "Texture.h"
 #include "utils.h"
 
 namespace BerylEngine
@@ -37,6 +40,12 @@ namespace BerylEngine
         if (isDebuggerPresent())
             glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
 
+        // Let the driver compile on its own threads, so that programs built asynchronously can be polled
+        if (GLEW_KHR_parallel_shader_compile)
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        else if (GLEW_ARB_parallel_shader_compile)
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
         glClearColor(0.4f, 0.4f, 0.4f, 1.0f);
 
@@ -48,4 +57,13 @@ namespace BerylEngine
 
         spdlog::info("Graphics API initialized.");
     }
+
+    void releaseGraphicsAPI()
+    {
+        StaticMesh::releaseArenas();
+        Texture::releasePlaceholder();
+        Program::releaseFallback();
+
+        spdlog::info("Graphics API released.");
+    }
 }
\ No newline at end of file
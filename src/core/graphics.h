@@ -3,4 +3,9 @@
 namespace BerylEngine
 {
 	void initGraphicsAPI();
+
+	/// <summary>
+	/// Release graphics resources owned by the engine. Must be called before the context is destroyed.
+	/// </summary>
+	void releaseGraphicsAPI();
 }
\ No newline at end of file
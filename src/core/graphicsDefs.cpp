@@ -14,6 +14,8 @@ namespace BerylEngine
 			return GL_UNIFORM_BUFFER;
 		case BufferUsageType::ShaderStorage:
 			return GL_SHADER_STORAGE_BUFFER;
+		case BufferUsageType::DrawIndirect:
+			return GL_DRAW_INDIRECT_BUFFER;
 		default:
 			return GL_INVALID_ENUM;
 		}
@@ -28,4 +30,46 @@ namespace BerylEngine
 		else
 			return GL_READ_WRITE;
 	}
+
+	GLbitfield accessType2GLMapBits(AccessType accessType)
+	{
+		if (accessType == AccessType::Read)
+			return GL_MAP_READ_BIT;
+		else if (accessType == AccessType::Write)
+			return GL_MAP_WRITE_BIT;
+		else
+			return GL_MAP_READ_BIT | GL_MAP_WRITE_BIT;
+	}
+
+	GLenum usageHint2GL(BufferUsageHint usageHint)
+	{
+		switch (usageHint)
+		{
+		case BufferUsageHint::Static:
+			return GL_STATIC_DRAW;
+		case BufferUsageHint::Dynamic:
+			return GL_DYNAMIC_DRAW;
+		case BufferUsageHint::Stream:
+			return GL_STREAM_DRAW;
+		default:
+			return GL_INVALID_ENUM;
+		}
+	}
+
+	GLbitfield bufferStorage2GL(BufferStorage storage)
+	{
+		GLbitfield flags = 0;
+		if (storage & BufferStorage::Dynamic)
+			flags |= GL_DYNAMIC_STORAGE_BIT;
+		if (storage & BufferStorage::MapRead)
+			flags |= GL_MAP_READ_BIT;
+		if (storage & BufferStorage::MapWrite)
+			flags |= GL_MAP_WRITE_BIT;
+		if (storage & BufferStorage::Persistent)
+			flags |= GL_MAP_PERSISTENT_BIT;
+		if (storage & BufferStorage::Coherent)
+			flags |= GL_MAP_COHERENT_BIT;
+
+		return flags;
+	}
 }
\ No newline at end of file
@@ -10,6 +10,7 @@ namespace BerylEngine
 		IndexBuffer,
 		UniformBuffer,
 		ShaderStorage,
+		DrawIndirect,
 	};
 
 	enum AccessType
@@ -19,6 +20,54 @@ namespace BerylEngine
 		Read_Write
 	};
 
+	/// <summary>
+	/// Layout expected by glMultiDrawElementsIndirect.
+	/// </summary>
+	struct DrawElementsIndirectCommand
+	{
+		unsigned int count;
+		unsigned int instanceCount;
+		unsigned int firstIndex;
+		int baseVertex;
+		unsigned int baseInstance;
+	};
+
+	/// <summary>
+	/// Usage hint of buffers with mutable storage.
+	/// </summary>
+	enum class BufferUsageHint
+	{
+		Static,
+		Dynamic,
+		Stream
+	};
+
+	/// <summary>
+	/// Flags of buffers with immutable storage.
+	/// </summary>
+	enum class BufferStorage : unsigned int
+	{
+		None = 0,
+		Dynamic = 1 << 0,
+		MapRead = 1 << 1,
+		MapWrite = 1 << 2,
+		Persistent = 1 << 3,
+		Coherent = 1 << 4,
+	};
+
+	constexpr BufferStorage operator|(BufferStorage lhs, BufferStorage rhs)
+	{
+		return BufferStorage(static_cast<unsigned int>(lhs) | static_cast<unsigned int>(rhs));
+	}
+
+	constexpr bool operator&(BufferStorage lhs, BufferStorage rhs)
+	{
+		return (static_cast<unsigned int>(lhs) & static_cast<unsigned int>(rhs)) != 0;
+	}
+
 	GLenum usageType2GL(BufferUsageType usageType);
 	GLenum accessType2GL(AccessType accessType);
+	GLbitfield accessType2GLMapBits(AccessType accessType);
+	GLenum usageHint2GL(BufferUsageHint usageHint);
+	GLbitfield bufferStorage2GL(BufferStorage storage);
 }
\ No newline at end of file
@@ -1,7 +1,13 @@
 #include "utils.h"
 
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 #include <spdlog/spdlog.h>
 #include <sstream>
+#include <thread>
 #include <Windows.h>
 
 namespace BerylEngine
@@ -36,4 +42,61 @@ namespace BerylEngine
 
 		return splitted;
 	}
+
+	std::string canonicalPath(const std::filesystem::path& path)
+	{
+		std::error_code error;
+		const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+		return (error ? path.lexically_normal() : canonical).generic_string();
+	}
+
+	bool fileStamp(const std::string& path, FileStamp& stamp)
+	{
+		std::error_code error;
+		const uintmax_t size = std::filesystem::file_size(path, error);
+		if (error)
+			return false;
+		const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+		if (error)
+			return false;
+
+		stamp.size = uint64_t(size);
+		stamp.writeTime = int64_t(writeTime.time_since_epoch().count());
+		return true;
+	}
+
+	bool writeFileAtomically(const std::string& path, std::span<const std::span<const std::byte>> parts)
+	{
+		// Unique across threads, and across processes unless two start a write in the same clock tick
+		static std::atomic<uint64_t> s_writeCount = 0;
+		const uint64_t unique = std::hash<std::thread::id>()(std::this_thread::get_id())
+			^ uint64_t(std::chrono::steady_clock::now().time_since_epoch().count()) ^ (s_writeCount++ << 48);
+		const std::string temporaryPath = fmt::format("{}.{:016x}.tmp", path, unique);
+
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			for (std::span<const std::byte> part : parts)
+				file.write(reinterpret_cast<const char*>(part.data()), std::streamsize(part.size()));
+
+			if (!file)
+			{
+				spdlog::error("Failed to write {}.", temporaryPath);
+				file.close();
+				std::error_code error;
+				std::filesystem::remove(temporaryPath, error);
+				return false;
+			}
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporaryPath, path, error);
+		if (error)
+		{
+			spdlog::error("Failed to write {}: {}", path, error.message());
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+
+		return true;
+	}
 }
\ No newline at end of file
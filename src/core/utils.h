@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #define FWD(var) std::forward<decltype(var)>(var)
@@ -32,4 +37,59 @@ namespace BerylEngine
     };
 
 	std::vector<std::string> splitstr(const std::string& str, char delim);
+
+    /// <summary>
+    /// Absolute and normalized path with forward slashes, to compare paths spelled differently, e.g.
+    /// "a/../b.png" and "b.png". Files that do not exist keep their normalized spelling.
+    /// </summary>
+    std::string canonicalPath(const std::filesystem::path& path);
+
+    /// <summary>
+    /// Size and last write time of a file. Cooked files record the stamp of their source, so that telling
+    /// whether the source changed does not need to read it.
+    /// </summary>
+    struct FileStamp
+    {
+        uint64_t size = 0;
+        int64_t writeTime = 0; // Ticks of std::filesystem::file_time_type
+
+        bool operator==(const FileStamp& other) const = default;
+    };
+
+    /// <summary>
+    /// False if the file does not exist or cannot be queried.
+    /// </summary>
+    bool fileStamp(const std::string& path, FileStamp& stamp);
+
+    /// <summary>
+    /// Write parts one after the other to a temporary file with a unique name, then rename it to path.
+    /// A crash never leaves a truncated file behind, and concurrent writes of one path do not mix their data.
+    /// </summary>
+    bool writeFileAtomically(const std::string& path, std::span<const std::span<const std::byte>> parts);
+
+    constexpr uint64_t Fnv1aOffsetBasis = 14695981039346656037ull;
+    constexpr uint64_t Fnv1aPrime = 1099511628211ull;
+
+    /// <summary>
+    /// 64-bit FNV-1a hash. Pass a previous result as hash to hash several pieces as one.
+    /// </summary>
+    constexpr uint64_t fnv1a(std::string_view text, uint64_t hash = Fnv1aOffsetBasis)
+    {
+        for (char c : text)
+        {
+            hash ^= uint64_t(uint8_t(c));
+            hash *= Fnv1aPrime;
+        }
+        return hash;
+    }
+
+    inline uint64_t fnv1a(std::span<const std::byte> data, uint64_t hash = Fnv1aOffsetBasis)
+    {
+        for (std::byte b : data)
+        {
+            hash ^= uint64_t(b);
+            hash *= Fnv1aPrime;
+        }
+        return hash;
+    }
 }
\ No newline at end of file
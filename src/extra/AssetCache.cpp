@@ -0,0 +1,283 @@
+#include "AssetCache.h"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+#include "AsyncLoader.h"
+#include "meshUtilities.h"
+#include "../core/MappedFile.h"
+
+namespace BerylEngine
+{
+	static std::string programKey(std::span<const std::string* const> paths, std::span<const std::string> defines)
+	{
+		std::string key;
+		for (const std::string* path : paths)
+			key += canonicalPath(*path) + '|';
+		for (const std::string& define : defines)
+			key += define + ';';
+		return key;
+	}
+
+	static std::string programKey(std::initializer_list<const std::string*> paths, std::span<const std::string> defines)
+	{
+		return programKey(std::span(paths.begin(), paths.size()), defines);
+	}
+
+	// Keyed like the synchronous variants, so that both share their programs
+	static std::string programKey(const ProgramFiles& files)
+	{
+		std::vector<const std::string*> paths;
+		for (const std::string* path : { &files.computePath, &files.vertexPath, &files.geometryPath, &files.fragmentPath })
+		{
+			if (!path->empty())
+				paths.push_back(path);
+		}
+		return programKey(paths, files.defines);
+	}
+
+	float AssetCache::Stats::hitRate() const
+	{
+		const size_t requests = hits + coalesced + misses;
+		return requests > 0 ? float(hits + coalesced) / float(requests) : 0.0f;
+	}
+
+	AssetCache::AssetCache(AsyncLoader* loader)
+		: m_loader(loader)
+	{
+	}
+
+	template<typename T, typename Load>
+	std::shared_ptr<T> AssetCache::acquire(Table<T>& table, const std::string& key, Load&& load)
+	{
+		std::promise<std::shared_ptr<T>> promise;
+		{
+			std::unique_lock lock(m_mutex);
+			Entry<T>& entry = table[key];
+			std::shared_ptr<T> asset = entry.asset.lock();
+			if (asset && !asset->hasFailed())
+			{
+				m_stats.hits++;
+				return asset;
+			}
+
+			if (entry.pending.valid())
+			{
+				m_stats.coalesced++;
+				const std::shared_future<std::shared_ptr<T>> pending = entry.pending;
+				lock.unlock();
+				return pending.get();
+			}
+
+			m_stats.misses++;
+			entry.pending = promise.get_future().share();
+		}
+
+		std::shared_ptr<T> asset;
+		try
+		{
+			asset = load();
+		}
+		catch (...)
+		{
+			// Requests waiting for this load get the exception, later ones load again
+			{
+				std::lock_guard lock(m_mutex);
+				table.erase(key);
+			}
+			promise.set_exception(std::current_exception());
+			throw;
+		}
+
+		{
+			// The table may have been rehashed during the load
+			std::lock_guard lock(m_mutex);
+			if (asset && !asset->hasFailed())
+			{
+				Entry<T>& entry = table[key];
+				entry.asset = asset;
+				entry.pending = {};
+			}
+			else
+				table.erase(key);
+		}
+		promise.set_value(asset);
+
+		return asset;
+	}
+
+	std::shared_ptr<Texture> AssetCache::texture(const std::string& path, Texture::TextureFormat format,
+												 Texture::CompressionQuality quality)
+	{
+		const std::string key = canonicalPath(path) + '|' + std::to_string(int(format)) + '|'
+			+ std::to_string(int(quality));
+		return acquire(m_textures, key, [&]()
+			{
+				return m_loader ? m_loader->loadTexture(path, format, quality)
+					: Texture::fromFile(path, format, quality);
+			});
+	}
+
+	bool AssetCache::contentHash(const std::string& canonicalPath, uint64_t& hash)
+	{
+		std::error_code error;
+		const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(canonicalPath, error);
+		if (error)
+			return false;
+		const uintmax_t size = std::filesystem::file_size(canonicalPath, error);
+		if (error)
+			return false;
+
+		{
+			std::lock_guard lock(m_mutex);
+			auto it = m_fileHashes.find(canonicalPath);
+			if (it != m_fileHashes.end() && it->second.writeTime == writeTime && it->second.size == size)
+			{
+				hash = it->second.hash;
+				return true;
+			}
+		}
+
+		MappedFile file(canonicalPath);
+		if (!file.isOpen())
+			return false;
+		hash = fnv1a(file.data());
+
+		std::lock_guard lock(m_mutex);
+		m_fileHashes[canonicalPath] = { writeTime, size, hash };
+		return true;
+	}
+
+	std::shared_ptr<StaticMesh> AssetCache::mesh(const std::string& path)
+	{
+		uint64_t hash;
+		if (!contentHash(canonicalPath(path), hash))
+		{
+			spdlog::error("Failed to open mesh file {}.", path);
+			return nullptr;
+		}
+
+		return acquire(m_meshes, std::to_string(hash), [&]()
+			{
+				if (m_loader)
+					return m_loader->loadMesh(path);
+
+				return path.ends_with(MeshUtilities::MeshFileExtension)
+					? MeshUtilities::staticFromMeshFile(path)
+					: MeshUtilities::staticFromOBJ(path);
+			});
+	}
+
+	std::shared_ptr<Program> AssetCache::program(const std::string& computePath, std::span<std::string> defines)
+	{
+		return acquire(m_programs, programKey({ &computePath }, defines), [&]()
+			{
+				return Program::fromFiles(computePath, defines);
+			});
+	}
+
+	std::shared_ptr<Program> AssetCache::program(const std::string& vertexPath, const std::string& fragmentPath,
+												 std::span<std::string> defines)
+	{
+		return acquire(m_programs, programKey({ &vertexPath, &fragmentPath }, defines), [&]()
+			{
+				return Program::fromFiles(vertexPath, fragmentPath, defines);
+			});
+	}
+
+	std::shared_ptr<Program> AssetCache::program(const std::string& vertexPath, const std::string& geometryPath,
+												 const std::string& fragmentPath, std::span<std::string> defines)
+	{
+		return acquire(m_programs, programKey({ &vertexPath, &geometryPath, &fragmentPath }, defines), [&]()
+			{
+				return Program::fromFiles(vertexPath, geometryPath, fragmentPath, defines);
+			});
+	}
+
+	std::shared_ptr<Program> AssetCache::programAsync(const ProgramFiles& files)
+	{
+		return acquire(m_programs, programKey(files), [&]()
+			{
+				return Program::fromFilesAsync(files);
+			});
+	}
+
+	std::vector<std::shared_ptr<Program>> AssetCache::programsAsync(std::span<const ProgramFiles> files)
+	{
+		std::vector<std::shared_ptr<Program>> programs(files.size());
+		std::vector<std::string> missingKeys;
+		std::vector<size_t> missingIndices;
+		std::vector<ProgramFiles> missingFiles;
+		{
+			std::lock_guard lock(m_mutex);
+			for (size_t i = 0; i < files.size(); i++)
+			{
+				std::string key = programKey(files[i]);
+				auto it = m_programs.find(key);
+				std::shared_ptr<Program> program = it != m_programs.end() ? it->second.asset.lock() : nullptr;
+				if (program && !program->hasFailed())
+				{
+					m_stats.hits++;
+					programs[i] = std::move(program);
+					continue;
+				}
+
+				missingKeys.push_back(std::move(key));
+				missingIndices.push_back(i);
+				missingFiles.push_back(files[i]);
+			}
+		}
+
+		// Submitted outside of acquire() so that the driver compiles the whole batch in parallel. acquire() then
+		// records them, or returns a program cached meanwhile.
+		std::vector<std::shared_ptr<Program>> submitted = Program::fromFilesAsync(missingFiles);
+		for (size_t i = 0; i < missingIndices.size(); i++)
+		{
+			programs[missingIndices[i]] = acquire(m_programs, missingKeys[i], [&]()
+				{
+					return std::move(submitted[i]);
+				});
+		}
+
+		return programs;
+	}
+
+	template<typename T>
+	static size_t liveCount(const std::unordered_map<std::string, T>& table)
+	{
+		return std::count_if(table.begin(), table.end(), [](const auto& entry) { return !entry.second.asset.expired(); });
+	}
+
+	AssetCache::Stats AssetCache::stats() const
+	{
+		std::lock_guard lock(m_mutex);
+		Stats stats = m_stats;
+		stats.liveTextures = liveCount(m_textures);
+		stats.liveMeshes = liveCount(m_meshes);
+		stats.livePrograms = liveCount(m_programs);
+		return stats;
+	}
+
+	void AssetCache::logStats() const
+	{
+		const Stats current = stats();
+		spdlog::info("Asset cache: {} requests, {:.1f}% hits ({} coalesced). Alive: {} textures, {} meshes, {} programs.",
+			current.hits + current.coalesced + current.misses, current.hitRate() * 100.0f, current.coalesced,
+			current.liveTextures, current.liveMeshes, current.livePrograms);
+	}
+
+	template<typename T>
+	static size_t purgeTable(std::unordered_map<std::string, T>& table)
+	{
+		return std::erase_if(table, [](const auto& entry)
+			{
+				return entry.second.asset.expired() && !entry.second.pending.valid();
+			});
+	}
+
+	size_t AssetCache::purge()
+	{
+		std::lock_guard lock(m_mutex);
+		return purgeTable(m_textures) + purgeTable(m_meshes) + purgeTable(m_programs);
+	}
+}
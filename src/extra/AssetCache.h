@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+
+#include "../core/Program.h"
+#include "../core/StaticMesh.h"
+#include "../core/Texture.h"
+#include "../core/utils.h"
+
+namespace BerylEngine
+{
+	class AsyncLoader;
+
+	/// <summary>
+	/// Registry handing out one instance per asset, so that loading a file twice costs neither memory nor time.
+	/// Textures are keyed by canonical path, format and compression quality, programs by their canonical paths and defines, and meshes
+	/// by the hash of their content, so identical files under different paths also share their mesh.
+	/// Only weak references are kept: an asset is freed with its last handle and loaded again on the next request.
+	/// Requests for an asset being loaded wait for that load instead of starting another one.
+	/// Failed loads are not cached: synchronous ones return null, or a program that failed to build, and asynchronous
+	/// ones return a handle that reports hasFailed() once published. The next request for the asset loads it again.
+	/// </summary>
+	class AssetCache : NonMovable
+	{
+	public:
+		struct Stats
+		{
+			size_t hits = 0;
+			size_t coalesced = 0; // Requests that waited for a load in progress
+			size_t misses = 0;
+			size_t liveTextures = 0;
+			size_t liveMeshes = 0;
+			size_t livePrograms = 0;
+
+			/// <summary>
+			/// Share of requests served without loading, in [0, 1].
+			/// </summary>
+			float hitRate() const;
+		};
+
+		/// <summary>
+		/// With a loader, textures and meshes are loaded through it and returned before they are ready.
+		/// Otherwise they are loaded synchronously, on the thread owning the context.
+		/// </summary>
+		explicit AssetCache(AsyncLoader* loader = nullptr);
+
+		std::shared_ptr<Texture> texture(const std::string& path, Texture::TextureFormat format,
+										 Texture::CompressionQuality quality = Texture::CompressionQuality::Normal);
+
+		/// <summary>
+		/// Load an OBJ file, or a binary mesh file if the path has its extension.
+		/// </summary>
+		std::shared_ptr<StaticMesh> mesh(const std::string& path);
+
+		std::shared_ptr<Program> program(const std::string& computePath, std::span<std::string> defines = {});
+		std::shared_ptr<Program> program(const std::string& vertexPath, const std::string& fragmentPath,
+										 std::span<std::string> defines = {});
+		std::shared_ptr<Program> program(const std::string& vertexPath, const std::string& geometryPath,
+										 const std::string& fragmentPath, std::span<std::string> defines = {});
+
+		/// <summary>
+		/// Like program(), but the program is submitted with Program::fromFilesAsync and returned before it is ready.
+		/// </summary>
+		std::shared_ptr<Program> programAsync(const ProgramFiles& files);
+
+		/// <summary>
+		/// Like programAsync() for each of files, but the programs not cached yet are submitted as a single batch.
+		/// </summary>
+		std::vector<std::shared_ptr<Program>> programsAsync(std::span<const ProgramFiles> files);
+
+		/// <summary>
+		/// Counters since creation, and the number of assets currently alive.
+		/// </summary>
+		Stats stats() const;
+		void logStats() const;
+
+		/// <summary>
+		/// Forget the entries whose asset was freed. Return how many were removed.
+		/// </summary>
+		size_t purge();
+
+	private:
+		template<typename T>
+		struct Entry
+		{
+			std::weak_ptr<T> asset;
+			std::shared_future<std::shared_ptr<T>> pending; // Valid while the asset is being loaded
+		};
+
+		template<typename T>
+		using Table = std::unordered_map<std::string, Entry<T>>;
+
+		// Mesh content hashes, recomputed only when the file changes
+		struct FileHash
+		{
+			std::filesystem::file_time_type writeTime;
+			uintmax_t size;
+			uint64_t hash;
+		};
+
+		AsyncLoader* m_loader;
+
+		// Protects the tables and counters. Loads run outside of it.
+		mutable std::mutex m_mutex;
+		Table<Texture> m_textures;
+		Table<StaticMesh> m_meshes;
+		Table<Program> m_programs;
+		std::unordered_map<std::string, FileHash> m_fileHashes;
+		Stats m_stats;
+
+		template<typename T, typename Load>
+		std::shared_ptr<T> acquire(Table<T>& table, const std::string& key, Load&& load);
+
+		bool contentHash(const std::string& canonicalPath, uint64_t& hash);
+	};
+}
@@ -0,0 +1,250 @@
+#include "AsyncLoader.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <spdlog/spdlog.h>
+
+#include "../core/ThreadPool.h"
+
+namespace BerylEngine
+{
+	AsyncLoader::AsyncLoader(GLFWwindow* mainWindow)
+	{
+		// The context hints of the main window are still set, only the window itself is hidden
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		m_uploadWindow = glfwCreateWindow(1, 1, "BerylEngine upload", nullptr, mainWindow);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+		if (!m_uploadWindow)
+			FATAL("Failed to create the upload context.");
+
+		m_uploadThread = std::thread(&AsyncLoader::uploadLoop, this);
+
+		spdlog::info("Async loader initialized.");
+	}
+
+	AsyncLoader::~AsyncLoader()
+	{
+		{
+			std::unique_lock lock(m_mutex);
+			m_decodeCondition.wait(lock, [this]() { return m_decodesInFlight == 0; });
+			m_stopping = true;
+		}
+		m_uploadCondition.notify_one();
+		m_uploadThread.join();
+
+		// Unpublished textures still take ownership of their handle, so that it is deleted with them
+		for (TextureCompletion& completion : m_textureCompletions)
+		{
+			if (completion.fence)
+				glDeleteSync(completion.fence);
+			completion.texture->m_handle = completion.handle;
+		}
+		m_textureCompletions.clear();
+		m_meshCompletions.clear();
+
+		glfwDestroyWindow(m_uploadWindow);
+	}
+
+	std::shared_ptr<Texture> AsyncLoader::loadTexture(const std::string& path, Texture::TextureFormat format,
+													  Texture::CompressionQuality quality)
+	{
+		std::shared_ptr<Texture> texture(new Texture());
+		texture->m_ready = false;
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_decodesInFlight++;
+			m_pendingCount++;
+		}
+
+		// The texture is moved along the queues rather than copied, so that its last reference
+		// is never dropped on a thread without the main context
+		ThreadPool::global().submit([this, texture, path, format, quality]() mutable
+			{
+				TextureUpload upload = { std::move(texture), {}, false };
+				upload.loaded = Texture::loadFile(path, format, quality, upload.mipChain);
+				if (!upload.loaded)
+					spdlog::error("Failed to load texture from {}.", path);
+
+				std::lock_guard lock(m_mutex);
+				m_textureUploads.push_back(std::move(upload));
+				m_decodesInFlight--;
+				m_uploadCondition.notify_one();
+				m_decodeCondition.notify_all();
+			});
+
+		return texture;
+	}
+
+	std::shared_ptr<StaticMesh> AsyncLoader::loadMesh(const std::string& path)
+	{
+		auto mesh = std::make_shared<StaticMesh>();
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_decodesInFlight++;
+			m_pendingCount++;
+		}
+
+		ThreadPool::global().submit([this, mesh, path]() mutable
+			{
+				MeshCompletion completion = { std::move(mesh), path, {}, false };
+				completion.loaded = path.ends_with(MeshUtilities::MeshFileExtension)
+					? MeshUtilities::loadMeshFile(path, completion.data)
+					: MeshUtilities::loadOBJ(path, completion.data);
+
+				std::lock_guard lock(m_mutex);
+				m_meshCompletions.push_back(std::move(completion));
+				m_decodesInFlight--;
+				m_decodeCondition.notify_all();
+			});
+
+		return mesh;
+	}
+
+	void AsyncLoader::uploadLoop()
+	{
+		glfwMakeContextCurrent(m_uploadWindow);
+
+		std::unique_lock lock(m_mutex);
+		while (true)
+		{
+			m_uploadCondition.wait(lock, [this]() { return m_stopping || !m_textureUploads.empty(); });
+			if (m_textureUploads.empty())
+				break;
+
+			TextureUpload upload = std::move(m_textureUploads.front());
+			m_textureUploads.pop_front();
+
+			lock.unlock();
+			uploadTexture(upload);
+			lock.lock();
+		}
+
+		glfwMakeContextCurrent(nullptr);
+	}
+
+	void AsyncLoader::uploadTexture(TextureUpload& upload)
+	{
+		const Texture::MipChain& mipChain = upload.mipChain;
+		TextureCompletion completion = { std::move(upload.texture), 0, mipChain.width, mipChain.height, nullptr };
+
+		if (upload.loaded)
+		{
+			const size_t size = mipChain.data.size();
+
+			unsigned int buffer;
+			glCreateBuffers(1, &buffer);
+			glNamedBufferStorage(buffer, size, nullptr, GL_MAP_WRITE_BIT);
+			void* mapped = glMapNamedBufferRange(buffer, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+			if (mapped)
+			{
+				std::memcpy(mapped, mipChain.data.data(), size);
+				glUnmapNamedBuffer(buffer);
+
+				completion.handle = Texture::createFromPixelBuffer(buffer, mipChain.width, mipChain.height,
+					mipChain.format, mipChain.levelCount);
+				completion.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+				// Fences only signal once submitted, and nothing else flushes this context
+				glFlush();
+			}
+			else
+				spdlog::error("Failed to map the pixel buffer of a {}x{} texture.", mipChain.width, mipChain.height);
+
+			// Deleting the buffer is deferred by the driver until the copy from it is done
+			glDeleteBuffers(1, &buffer);
+		}
+
+		std::lock_guard lock(m_mutex);
+		m_textureCompletions.push_back(std::move(completion));
+	}
+
+	void AsyncLoader::update(size_t maxMeshBytes)
+	{
+		std::vector<TextureCompletion> textureCompletions;
+		{
+			std::lock_guard lock(m_mutex);
+			std::swap(textureCompletions, m_textureCompletions);
+		}
+
+		// Textures are published once the GPU is done with their upload. A zero timeout only polls the fence.
+		size_t published = 0;
+		std::vector<TextureCompletion> unfinished;
+		for (TextureCompletion& completion : textureCompletions)
+		{
+			if (completion.fence)
+			{
+				if (glClientWaitSync(completion.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+				{
+					unfinished.push_back(std::move(completion));
+					continue;
+				}
+				glDeleteSync(completion.fence);
+			}
+
+			// Failed textures are never ready and keep being replaced by the placeholder
+			Texture& texture = *completion.texture;
+			texture.m_handle = completion.handle;
+			texture.m_width = completion.width;
+			texture.m_height = completion.height;
+			texture.m_ready = completion.handle != 0;
+			texture.m_failed = !texture.m_ready;
+			published++;
+		}
+		textureCompletions.clear();
+
+		// Meshes are uploaded here rather than on the upload thread: the geometry arenas may reallocate,
+		// and their vertex arrays are not shared between contexts
+		size_t uploadedBytes = 0;
+		while (uploadedBytes < maxMeshBytes)
+		{
+			MeshCompletion completion;
+			{
+				std::lock_guard lock(m_mutex);
+				if (m_meshCompletions.empty())
+					break;
+				completion = std::move(m_meshCompletions.front());
+				m_meshCompletions.pop_front();
+			}
+
+			if (completion.loaded)
+			{
+				uploadedBytes += completion.data.geometrySize();
+				completion.data.upload(*completion.mesh);
+			}
+			else
+			{
+				spdlog::error("Failed to load mesh from {}.", completion.path);
+				completion.mesh->m_failed = true;
+			}
+			published++;
+		}
+
+		std::lock_guard lock(m_mutex);
+		m_textureCompletions.insert(m_textureCompletions.end(), std::make_move_iterator(unfinished.begin()),
+			std::make_move_iterator(unfinished.end()));
+		m_pendingCount -= published;
+	}
+
+	size_t AsyncLoader::pendingCount() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_pendingCount;
+	}
+
+	void AsyncLoader::waitIdle()
+	{
+		while (true)
+		{
+			update(std::numeric_limits<size_t>::max());
+			if (pendingCount() == 0)
+				break;
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
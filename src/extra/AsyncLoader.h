@@ -0,0 +1,106 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "meshUtilities.h"
+#include "../core/StaticMesh.h"
+#include "../core/Texture.h"
+#include "../core/utils.h"
+
+struct GLFWwindow;
+typedef struct __GLsync* GLsync;
+
+namespace BerylEngine
+{
+	/// <summary>
+	/// Loads textures and meshes without blocking the render thread.
+	/// Files are decoded, and block-compressed if needed, on the global thread pool. Texture levels are copied to pixel buffers and uploaded by
+	/// a thread owning a context shared with the main one, and fences tell when the GPU is done with them.
+	/// The returned handles are usable right away and report isReady() once their data is on the GPU, or hasFailed()
+	/// if it never will be.
+	/// Until then, materials bind a placeholder texture and scenes skip the objects using the mesh.
+	/// </summary>
+	class AsyncLoader : NonMovable
+	{
+	public:
+		/// <summary>
+		/// The upload context is shared with the context of mainWindow. Create and destroy the loader
+		/// on the main thread, while that context is current.
+		/// </summary>
+		AsyncLoader(GLFWwindow* mainWindow);
+		~AsyncLoader();
+
+		std::shared_ptr<Texture> loadTexture(const std::string& path, Texture::TextureFormat format,
+											 Texture::CompressionQuality quality = Texture::CompressionQuality::Normal);
+
+		/// <summary>
+		/// Load an OBJ file (see MeshUtilities::staticFromOBJ), or a binary mesh file if the path has its extension.
+		/// </summary>
+		std::shared_ptr<StaticMesh> loadMesh(const std::string& path);
+
+		/// <summary>
+		/// Publish the finished loads. Call once per frame on the render thread.
+		/// Mesh uploads are spread over frames, about maxMeshBytes per call, so that a level loading does not
+		/// cause a frame spike.
+		/// </summary>
+		void update(size_t maxMeshBytes = 8 * 1024 * 1024);
+
+		/// <summary>
+		/// Loads requested and not published by update() yet, failed ones included.
+		/// </summary>
+		size_t pendingCount() const;
+
+		/// <summary>
+		/// Block until every pending load is published, e.g. behind a loading screen.
+		/// </summary>
+		void waitIdle();
+
+	private:
+		struct TextureUpload
+		{
+			std::shared_ptr<Texture> texture;
+			Texture::MipChain mipChain;
+			bool loaded;
+		};
+
+		struct TextureCompletion
+		{
+			std::shared_ptr<Texture> texture;
+			unsigned int handle;
+			int width;
+			int height;
+			GLsync fence;
+		};
+
+		struct MeshCompletion
+		{
+			std::shared_ptr<StaticMesh> mesh;
+			std::string path;
+			MeshUtilities::MeshData data;
+			bool loaded;
+		};
+
+		GLFWwindow* m_uploadWindow;
+		std::thread m_uploadThread;
+
+		// Protects every queue and counter below
+		mutable std::mutex m_mutex;
+		std::condition_variable m_uploadCondition;
+		std::condition_variable m_decodeCondition;
+		std::deque<TextureUpload> m_textureUploads;
+		std::vector<TextureCompletion> m_textureCompletions;
+		std::deque<MeshCompletion> m_meshCompletions;
+		size_t m_decodesInFlight = 0;
+		size_t m_pendingCount = 0;
+		bool m_stopping = false;
+
+		void uploadLoop();
+		void uploadTexture(TextureUpload& upload);
+	};
+}
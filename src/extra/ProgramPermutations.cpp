@@ -0,0 +1,198 @@
+#include "ProgramPermutations.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+#include "AssetCache.h"
+
+namespace BerylEngine
+{
+	ProgramPermutations::ProgramPermutations(ProgramFiles files, std::vector<std::string> features, AssetCache* assets)
+		: m_assets(assets), m_files(std::move(files)), m_features(std::move(features))
+	{
+		if (m_features.size() > MaxFeatures)
+			FATAL("Too many features for a program permutation table.");
+
+		const size_t maskCount = size_t(1) << m_features.size();
+		m_allFeatures = Mask(maskCount - 1);
+		m_strippedMasks.resize(maskCount);
+		for (size_t mask = 0; mask < maskCount; mask++)
+			m_strippedMasks[mask] = Mask(mask);
+		m_variants.resize(maskCount);
+	}
+
+	ProgramPermutations::Mask ProgramPermutations::feature(std::string_view name) const
+	{
+		for (size_t i = 0; i < m_features.size(); i++)
+		{
+			if (m_features[i] == name)
+				return Mask(1) << i;
+		}
+
+		spdlog::error("Unknown program feature {}.", name);
+		return 0;
+	}
+
+	void ProgramPermutations::addStripRule(Mask whenSet, Mask stripped)
+	{
+		m_stripRules.emplace_back(whenSet & m_allFeatures, stripped & ~whenSet);
+
+		// Rules are folded in the table so that lookups stay constant time. A rule may enable another one
+		// by clearing bits, so they are applied until the mask settles.
+		for (size_t mask = 0; mask < m_strippedMasks.size(); mask++)
+		{
+			Mask result = Mask(mask);
+			Mask previous;
+			do
+			{
+				previous = result;
+				for (const auto& [ruleSet, ruleStripped] : m_stripRules)
+				{
+					if (result & ruleSet)
+						result &= ~ruleStripped;
+				}
+			} while (result != previous);
+
+			m_strippedMasks[mask] = result;
+		}
+	}
+
+	ProgramPermutations::Mask ProgramPermutations::strip(Mask mask) const
+	{
+		return m_strippedMasks[mask & m_allFeatures];
+	}
+
+	ProgramFiles ProgramPermutations::variantFiles(Mask mask) const
+	{
+		ProgramFiles files = m_files;
+		for (size_t i = 0; i < m_features.size(); i++)
+		{
+			if (mask & (Mask(1) << i))
+				files.defines.push_back(m_features[i]);
+		}
+		return files;
+	}
+
+	const std::shared_ptr<Program>& ProgramPermutations::get(Mask mask)
+	{
+		const Mask stripped = strip(mask);
+		std::shared_ptr<Program>& variant = m_variants[stripped];
+		if (!variant)
+		{
+			const ProgramFiles files = variantFiles(stripped);
+			variant = m_assets ? m_assets->programAsync(files) : Program::fromFilesAsync(files);
+		}
+
+		return variant;
+	}
+
+	void ProgramPermutations::prewarm(std::span<const Mask> masks)
+	{
+		std::vector<Mask> missing;
+		std::vector<ProgramFiles> files;
+		for (Mask mask : masks)
+		{
+			const Mask stripped = strip(mask);
+			if (!m_variants[stripped] && std::find(missing.begin(), missing.end(), stripped) == missing.end())
+			{
+				missing.push_back(stripped);
+				files.push_back(variantFiles(stripped));
+			}
+		}
+
+		std::vector<std::shared_ptr<Program>> programs = m_assets ? m_assets->programsAsync(files)
+			: Program::fromFilesAsync(files);
+		for (size_t i = 0; i < missing.size(); i++)
+			m_variants[missing[i]] = std::move(programs[i]);
+	}
+
+	std::vector<ProgramPermutations::Mask> ProgramPermutations::allMasks() const
+	{
+		std::vector<Mask> masks;
+		for (size_t mask = 0; mask < m_strippedMasks.size(); mask++)
+		{
+			if (m_strippedMasks[mask] == Mask(mask))
+				masks.push_back(Mask(mask));
+		}
+		return masks;
+	}
+
+	bool ProgramPermutations::isBuilt() const
+	{
+		return std::all_of(m_variants.begin(), m_variants.end(), [](const auto& variant)
+			{
+				return !variant || variant->isReady() || variant->hasFailed();
+			});
+	}
+
+	bool ProgramPermutations::saveUsage(const std::string& path) const
+	{
+		std::error_code error;
+		const std::filesystem::path folder = std::filesystem::path(path).parent_path();
+		if (!folder.empty())
+			std::filesystem::create_directories(folder, error);
+
+		std::ofstream file(path, std::ios::trunc);
+		for (size_t mask = 0; mask < m_variants.size(); mask++)
+		{
+			if (!m_variants[mask])
+				continue;
+
+			// The base variant is an empty line
+			std::string line;
+			for (size_t i = 0; i < m_features.size(); i++)
+			{
+				if (mask & (size_t(1) << i))
+					line += (line.empty() ? "" : " ") + m_features[i];
+			}
+			file << line << '\n';
+		}
+
+		if (!file)
+		{
+			spdlog::warn("Failed to save program usage to {}.", path);
+			return false;
+		}
+
+		return true;
+	}
+
+	std::vector<ProgramPermutations::Mask> ProgramPermutations::loadUsage(const std::string& path) const
+	{
+		std::vector<Mask> masks;
+		std::ifstream file(path);
+		std::string line;
+		while (std::getline(file, line))
+		{
+			Mask mask = 0;
+			bool known = true;
+			for (const std::string& name : splitstr(line, ' '))
+			{
+				if (name.empty())
+					continue;
+
+				auto it = std::find(m_features.begin(), m_features.end(), name);
+				if (it == m_features.end())
+				{
+					known = false;
+					break;
+				}
+				mask |= Mask(1) << (it - m_features.begin());
+			}
+
+			if (known)
+				masks.push_back(mask);
+			else
+				spdlog::debug("Skipped a variant of {} with unknown features: {}.", path, line);
+		}
+
+		return masks;
+	}
+
+	size_t ProgramPermutations::variantCount() const
+	{
+		return std::count_if(m_variants.begin(), m_variants.end(), [](const auto& variant) { return variant != nullptr; });
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../core/Program.h"
+#include "../core/utils.h"
+
+namespace BerylEngine
+{
+	class AssetCache;
+
+	/// <summary>
+	/// Variants of one program, selected by a bitmask of features. Feature i is a define set in the variants whose
+	/// mask has bit i, so call sites keep a mask instead of their own programs and define lists.
+	/// Variants are compiled asynchronously on first use (see Program::fromFilesAsync), or all at once by prewarm()
+	/// from the usage recorded by a previous run. Strip rules make combinations that would compile to the same
+	/// program share one variant.
+	/// </summary>
+	class ProgramPermutations : NonMovable
+	{
+	public:
+		using Mask = uint32_t;
+
+		// Variants are stored in a table with one slot per mask
+		static constexpr size_t MaxFeatures = 12;
+
+		/// <summary>
+		/// files.defines are set in every variant. With assets, variants are requested from it, so that they are
+		/// shared with the other users of the same program and defines.
+		/// </summary>
+		ProgramPermutations(ProgramFiles files, std::vector<std::string> features, AssetCache* assets = nullptr);
+
+		/// <summary>
+		/// Bit of a feature, by its define.
+		/// </summary>
+		Mask feature(std::string_view name) const;
+
+		/// <summary>
+		/// When any feature of whenSet is enabled, those of stripped have no effect and are cleared from masks.
+		/// </summary>
+		void addStripRule(Mask whenSet, Mask stripped);
+
+		/// <summary>
+		/// Mask of the variant actually used for mask: unknown bits and stripped features cleared.
+		/// </summary>
+		Mask strip(Mask mask) const;
+
+		/// <summary>
+		/// Variant for mask, submitted for compilation if it was never requested. Constant time.
+		/// </summary>
+		const std::shared_ptr<Program>& get(Mask mask);
+
+		/// <summary>
+		/// Submit every variant of masks that was never requested, as a single batch.
+		/// </summary>
+		void prewarm(std::span<const Mask> masks);
+
+		/// <summary>
+		/// One mask per distinct variant, e.g. to prewarm all of them.
+		/// </summary>
+		std::vector<Mask> allMasks() const;
+
+		/// <summary>
+		/// True once every variant requested so far is ready or failed to build. Polls them with Program::isReady().
+		/// </summary>
+		bool isBuilt() const;
+
+		/// <summary>
+		/// Write the variants requested so far, one line of features per variant, so that the next run can prewarm them.
+		/// </summary>
+		bool saveUsage(const std::string& path) const;
+
+		/// <summary>
+		/// Masks written by saveUsage(). Variants naming a feature that no longer exists are skipped.
+		/// </summary>
+		std::vector<Mask> loadUsage(const std::string& path) const;
+
+		size_t variantCount() const;
+
+	private:
+		AssetCache* m_assets;
+		ProgramFiles m_files;
+		std::vector<std::string> m_features;
+		Mask m_allFeatures;
+		std::vector<std::pair<Mask, Mask>> m_stripRules;
+		std::vector<Mask> m_strippedMasks; // Indexed by mask
+		std::vector<std::shared_ptr<Program>> m_variants; // Indexed by stripped mask
+
+		ProgramFiles variantFiles(Mask mask) const;
+	};
+}
@@ -0,0 +1,335 @@
+#include "meshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <spdlog/spdlog.h>
+
+namespace BerylEngine::MeshUtilities
+{
+	static constexpr unsigned int InvalidIndex = ~0u;
+
+	VertexCacheStatistics analyzeVertexCache(std::span<const unsigned int> indices, size_t vertexCount,
+											 unsigned int cacheSize)
+	{
+		// A vertex is in the FIFO while fewer than cacheSize vertices were inserted after it
+		std::vector<unsigned int> insertionTimes(vertexCount, 0);
+		unsigned int time = cacheSize + 1;
+		size_t transforms = 0;
+		for (unsigned int index : indices)
+		{
+			if (time - insertionTimes[index] > cacheSize)
+			{
+				insertionTimes[index] = time++;
+				transforms++;
+			}
+		}
+
+		const size_t triangleCount = indices.size() / 3;
+		return {
+			transforms,
+			triangleCount > 0 ? float(transforms) / float(triangleCount) : 0.0f,
+			vertexCount > 0 ? float(transforms) / float(vertexCount) : 0.0f
+		};
+	}
+
+	void weldVertices(std::vector<StaticMesh::Vertex>& vertices, std::span<unsigned int> indices)
+	{
+		const size_t tableSize = std::bit_ceil(std::max<size_t>(vertices.size() * 2, 16));
+		std::vector<unsigned int> table(tableSize, InvalidIndex);
+		std::vector<unsigned int> remap(vertices.size());
+
+		// Unique vertices are compacted in place, the slot written is never ahead of the one read
+		unsigned int uniqueCount = 0;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			size_t slot = fnv1a(std::as_bytes(std::span(&vertices[i], 1))) & (tableSize - 1);
+			while (table[slot] != InvalidIndex
+				&& std::memcmp(&vertices[table[slot]], &vertices[i], sizeof(StaticMesh::Vertex)) != 0)
+				slot = (slot + 1) & (tableSize - 1);
+
+			if (table[slot] == InvalidIndex)
+			{
+				vertices[uniqueCount] = vertices[i];
+				table[slot] = uniqueCount++;
+			}
+			remap[i] = table[slot];
+		}
+
+		vertices.resize(uniqueCount);
+		for (unsigned int& index : indices)
+			index = remap[index];
+	}
+
+	namespace
+	{
+		// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+		constexpr unsigned int ForsythCacheSize = 32;
+		constexpr float ForsythCacheDecayPower = 1.5f;
+		constexpr float ForsythLastTriangleScore = 0.75f;
+		constexpr float ForsythValenceBoostScale = 2.0f;
+		constexpr float ForsythValenceBoostPower = 0.5f;
+
+		float forsythVertexScore(int cachePosition, unsigned int remainingTriangles)
+		{
+			if (remainingTriangles == 0)
+				return -1.0f;
+
+			float score = 0.0f;
+			if (cachePosition >= 0)
+			{
+				// The last triangle's vertices get a fixed score so that strips are not favoured over fans
+				if (cachePosition < 3)
+					score = ForsythLastTriangleScore;
+				else
+					score = std::pow(1.0f - float(cachePosition - 3) / float(ForsythCacheSize - 3), ForsythCacheDecayPower);
+			}
+
+			// Vertices with few triangles left are finished first to avoid leaving them stranded
+			return score + ForsythValenceBoostScale * std::pow(float(remainingTriangles), -ForsythValenceBoostPower);
+		}
+	}
+
+	void optimizeVertexCache(std::span<unsigned int> indices, size_t vertexCount)
+	{
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0)
+			return;
+
+		// Triangles using each vertex. remainingTriangles[v] entries starting at triangleOffsets[v] are not emitted yet
+		std::vector<unsigned int> triangleOffsets(vertexCount + 1, 0);
+		for (unsigned int index : indices)
+			triangleOffsets[index + 1]++;
+		std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+
+		std::vector<unsigned int> remainingTriangles(vertexCount, 0);
+		std::vector<unsigned int> vertexTriangles(indices.size());
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			const unsigned int vertex = indices[i];
+			vertexTriangles[triangleOffsets[vertex] + remainingTriangles[vertex]++] = (unsigned int)(i / 3);
+		}
+
+		std::vector<int> cachePositions(vertexCount, -1);
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+			vertexScores[v] = forsythVertexScore(-1, remainingTriangles[v]);
+
+		// Triangle scores are only stored to pick the first triangle, they are recomputed on the fly afterwards
+		std::vector<float> triangleScores(triangleCount);
+		for (size_t t = 0; t < triangleCount; t++)
+			triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<unsigned int> output;
+		output.reserve(indices.size());
+
+		// The cache holds 3 extra entries while a triangle is being added
+		std::array<unsigned int, ForsythCacheSize + 3> cache;
+		std::array<unsigned int, ForsythCacheSize + 3> newCache;
+		size_t cacheCount = 0;
+
+		unsigned int best = (unsigned int)(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+		size_t scanCursor = 0;
+		while (best != InvalidIndex)
+		{
+			emitted[best] = true;
+			const unsigned int* triangle = &indices[size_t(best) * 3];
+			output.insert(output.end(), triangle, triangle + 3);
+
+			size_t newCount = 0;
+			for (int i = 0; i < 3; i++)
+			{
+				const unsigned int vertex = triangle[i];
+				newCache[newCount++] = vertex;
+
+				unsigned int* first = &vertexTriangles[triangleOffsets[vertex]];
+				unsigned int* last = first + remainingTriangles[vertex] - 1;
+				std::swap(*std::find(first, last, best), *last);
+				remainingTriangles[vertex]--;
+			}
+
+			for (size_t i = 0; i < cacheCount; i++)
+			{
+				const unsigned int vertex = cache[i];
+				if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+					newCache[newCount++] = vertex;
+			}
+
+			for (size_t i = 0; i < newCount; i++)
+			{
+				const unsigned int vertex = newCache[i];
+				cachePositions[vertex] = i < ForsythCacheSize ? int(i) : -1;
+				vertexScores[vertex] = forsythVertexScore(cachePositions[vertex], remainingTriangles[vertex]);
+			}
+
+			// Only triangles touching the cache changed score, the next one is picked among them
+			best = InvalidIndex;
+			float bestScore = -1.0f;
+			for (size_t i = 0; i < newCount; i++)
+			{
+				const unsigned int vertex = newCache[i];
+				for (unsigned int j = 0; j < remainingTriangles[vertex]; j++)
+				{
+					const unsigned int t = vertexTriangles[triangleOffsets[vertex] + j];
+					const float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]]
+						+ vertexScores[indices[t * 3 + 2]];
+					if (score > bestScore)
+					{
+						bestScore = score;
+						best = t;
+					}
+				}
+			}
+
+			cacheCount = std::min<size_t>(newCount, ForsythCacheSize);
+			std::copy_n(newCache.begin(), cacheCount, cache.begin());
+
+			// Nothing left around the cache: restart from the next triangle not emitted yet
+			if (best == InvalidIndex)
+			{
+				while (scanCursor < triangleCount && emitted[scanCursor])
+					scanCursor++;
+				if (scanCursor < triangleCount)
+					best = (unsigned int)scanCursor;
+			}
+		}
+
+		std::copy(output.begin(), output.end(), indices.begin());
+	}
+
+	void optimizeOverdraw(std::span<unsigned int> indices, std::span<const StaticMesh::Vertex> vertices, float threshold)
+	{
+		const size_t triangleCount = indices.size() / 3;
+		if (triangleCount < 2)
+			return;
+
+		constexpr unsigned int cacheSize = 16;
+		const float acmrLimit = analyzeVertexCache(indices, vertices.size(), cacheSize).acmr * threshold;
+
+		// Split where the cache restarts anyway (hard boundaries) or where the cluster so far, simulated from
+		// a cold cache, is already as efficient as allowed (soft boundaries, Sander et al. "Fast Triangle Reordering")
+		std::vector<size_t> clusterStarts;
+		std::vector<unsigned int> insertionTimes(vertices.size(), 0);
+		unsigned int time = cacheSize + 1;
+		size_t clusterMisses = 0;
+		size_t clusterTriangles = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			const unsigned int* triangle = &indices[t * 3];
+			const bool hardBoundary = time - insertionTimes[triangle[0]] > cacheSize
+				&& time - insertionTimes[triangle[1]] > cacheSize && time - insertionTimes[triangle[2]] > cacheSize;
+
+			if (clusterTriangles == 0 || hardBoundary || float(clusterMisses) <= acmrLimit * float(clusterTriangles))
+			{
+				clusterStarts.push_back(t);
+				clusterMisses = 0;
+				clusterTriangles = 0;
+				time += cacheSize + 1; // Flush
+			}
+
+			for (size_t i = 0; i < 3; i++)
+			{
+				if (time - insertionTimes[triangle[i]] > cacheSize)
+				{
+					insertionTimes[triangle[i]] = time++;
+					clusterMisses++;
+				}
+			}
+			clusterTriangles++;
+		}
+		clusterStarts.push_back(triangleCount);
+
+		const size_t clusterCount = clusterStarts.size() - 1;
+		if (clusterCount < 2)
+			return;
+
+		std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+		std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+		glm::vec3 meshCentroid(0.0f);
+		float meshArea = 0.0f;
+		for (size_t c = 0; c < clusterCount; c++)
+		{
+			float clusterArea = 0.0f;
+			for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+			{
+				const glm::vec3& p0 = vertices[indices[t * 3]].coords;
+				const glm::vec3& p1 = vertices[indices[t * 3 + 1]].coords;
+				const glm::vec3& p2 = vertices[indices[t * 3 + 2]].coords;
+
+				// Twice the area, in the direction of the face normal
+				const glm::vec3 areaNormal = glm::cross(p1 - p0, p2 - p0);
+				const float area = glm::length(areaNormal);
+
+				clusterCentroids[c] += (p0 + p1 + p2) * (area / 3.0f);
+				clusterNormals[c] += areaNormal;
+				clusterArea += area;
+			}
+
+			meshCentroid += clusterCentroids[c];
+			meshArea += clusterArea;
+			if (clusterArea > 0.0f)
+				clusterCentroids[c] /= clusterArea;
+		}
+		if (meshArea > 0.0f)
+			meshCentroid /= meshArea;
+
+		// Clusters far out along their normal are likely to occlude the others, draw them first
+		std::vector<float> clusterKeys(clusterCount);
+		for (size_t c = 0; c < clusterCount; c++)
+		{
+			const float normalLength = glm::length(clusterNormals[c]);
+			clusterKeys[c] = normalLength > 0.0f
+				? glm::dot(clusterCentroids[c] - meshCentroid, clusterNormals[c] / normalLength) : 0.0f;
+		}
+
+		std::vector<unsigned int> clusterOrder(clusterCount);
+		std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+		std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+			[&](unsigned int a, unsigned int b) { return clusterKeys[a] > clusterKeys[b]; });
+
+		std::vector<unsigned int> output;
+		output.reserve(indices.size());
+		for (unsigned int c : clusterOrder)
+			output.insert(output.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+
+		std::copy(output.begin(), output.end(), indices.begin());
+	}
+
+	void optimizeVertexFetch(std::vector<StaticMesh::Vertex>& vertices, std::span<unsigned int> indices)
+	{
+		std::vector<unsigned int> remap(vertices.size(), InvalidIndex);
+		std::vector<StaticMesh::Vertex> reordered;
+		reordered.reserve(vertices.size());
+
+		for (unsigned int& index : indices)
+		{
+			if (remap[index] == InvalidIndex)
+			{
+				remap[index] = (unsigned int)reordered.size();
+				reordered.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		vertices = std::move(reordered);
+	}
+
+	void optimizeMesh(std::vector<StaticMesh::Vertex>& vertices, std::span<unsigned int> indices, const std::string& name)
+	{
+		const size_t sourceVertexCount = vertices.size();
+		const VertexCacheStatistics before = analyzeVertexCache(indices, vertices.size());
+
+		weldVertices(vertices, indices);
+		optimizeVertexCache(indices, vertices.size());
+		optimizeOverdraw(indices, vertices);
+		optimizeVertexFetch(vertices, indices);
+
+		const VertexCacheStatistics after = analyzeVertexCache(indices, vertices.size());
+		spdlog::debug("Optimized {}: {} -> {} vertices, ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}.",
+			name, sourceVertexCount, vertices.size(), before.acmr, after.acmr, before.atvr, after.atvr);
+	}
+}
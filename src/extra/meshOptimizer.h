@@ -0,0 +1,51 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "../core/StaticMesh.h"
+
+namespace BerylEngine::MeshUtilities
+{
+	struct VertexCacheStatistics
+	{
+		size_t vertexTransforms;
+		float acmr; // Average cache miss ratio: transformed vertices per triangle, 0.5 at best and 3 at worst
+		float atvr; // Average transform to vertex ratio: 1 at best
+	};
+
+	/// <summary>
+	/// Simulate a FIFO post-transform cache of the given size over a triangle list.
+	/// </summary>
+	VertexCacheStatistics analyzeVertexCache(std::span<const unsigned int> indices, size_t vertexCount,
+											 unsigned int cacheSize = 16);
+
+	/// <summary>
+	/// Merge bitwise identical vertices and remap the indices. Vertices are kept in first-seen order.
+	/// </summary>
+	void weldVertices(std::vector<StaticMesh::Vertex>& vertices, std::span<unsigned int> indices);
+
+	/// <summary>
+	/// Reorder triangles for post-transform cache hits (Forsyth's linear-speed algorithm).
+	/// </summary>
+	void optimizeVertexCache(std::span<unsigned int> indices, size_t vertexCount);
+
+	/// <summary>
+	/// Reorder clusters of a cache-optimized triangle list so that outward-facing clusters are drawn first,
+	/// reducing overdraw from most viewpoints. Clusters are only split where it costs at most threshold times
+	/// the current ACMR, so most of the cache gain is preserved.
+	/// </summary>
+	void optimizeOverdraw(std::span<unsigned int> indices, std::span<const StaticMesh::Vertex> vertices,
+						  float threshold = 1.05f);
+
+	/// <summary>
+	/// Reorder vertices in the order they are first referenced, for memory locality. Unused vertices are dropped.
+	/// </summary>
+	void optimizeVertexFetch(std::vector<StaticMesh::Vertex>& vertices, std::span<unsigned int> indices);
+
+	/// <summary>
+	/// Run every step above in order and log the vertex cache statistics before and after.
+	/// </summary>
+	void optimizeMesh(std::vector<StaticMesh::Vertex>& vertices, std::span<unsigned int> indices,
+					  const std::string& name);
+}
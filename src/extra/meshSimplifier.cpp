@@ -0,0 +1,384 @@
+#include "meshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+#include <spdlog/spdlog.h>
+
+#include "meshOptimizer.h"
+
+namespace BerylEngine::MeshUtilities
+{
+	namespace
+	{
+		// Normal and UV differences of 1 cost as much as moving the vertex by this fraction of the mesh radius
+		constexpr float AttributeWeight = 0.05f;
+		// Planes through open edges are weighted up so that borders do not shrink
+		constexpr double BorderWeight = 10.0;
+		constexpr size_t MaxPasses = 64;
+
+		enum class VertexKind : uint8_t
+		{
+			Manifold, // Can collapse onto any neighbour
+			Border, // On an open edge, can only collapse along open edges
+			Locked // On a seam or a non-manifold edge, never moves
+		};
+
+		// Sum of weighted squared distances to planes, as the symmetric matrix of Garland and Heckbert
+		struct Quadric
+		{
+			double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+			double a11 = 0, a12 = 0, a13 = 0;
+			double a22 = 0, a23 = 0;
+			double a33 = 0;
+			double weight = 0;
+
+			void addPlane(const glm::dvec3& normal, double distance, double planeWeight)
+			{
+				a00 += planeWeight * normal.x * normal.x;
+				a01 += planeWeight * normal.x * normal.y;
+				a02 += planeWeight * normal.x * normal.z;
+				a03 += planeWeight * normal.x * distance;
+				a11 += planeWeight * normal.y * normal.y;
+				a12 += planeWeight * normal.y * normal.z;
+				a13 += planeWeight * normal.y * distance;
+				a22 += planeWeight * normal.z * normal.z;
+				a23 += planeWeight * normal.z * distance;
+				a33 += planeWeight * distance * distance;
+				weight += planeWeight;
+			}
+
+			void add(const Quadric& other)
+			{
+				a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+				a11 += other.a11; a12 += other.a12; a13 += other.a13;
+				a22 += other.a22; a23 += other.a23;
+				a33 += other.a33;
+				weight += other.weight;
+			}
+
+			// Mean squared distance to the planes
+			double error(const glm::vec3& point) const
+			{
+				const double x = point.x;
+				const double y = point.y;
+				const double z = point.z;
+				const double sum = a00 * x * x + a11 * y * y + a22 * z * z + a33
+					+ 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z + a03 * x + a13 * y + a23 * z);
+
+				return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+			}
+		};
+
+		struct Collapse
+		{
+			unsigned int source;
+			unsigned int target;
+			float cost;
+		};
+
+		uint64_t edgeKey(unsigned int a, unsigned int b)
+		{
+			return (uint64_t(a) << 32) | b;
+		}
+
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& position) const
+			{
+				return size_t(fnv1a(std::as_bytes(std::span(&position, 1))));
+			}
+		};
+	}
+
+	std::vector<unsigned int> simplify(std::span<const StaticMesh::Vertex> vertices, std::span<const unsigned int> indices,
+									   size_t targetIndexCount, float& resultError)
+	{
+		std::vector<unsigned int> result(indices.begin(), indices.end());
+		resultError = 0.0f;
+		if (result.size() <= targetIndexCount)
+			return result;
+
+		const size_t vertexCount = vertices.size();
+
+		// Vertices sharing a position (UV or normal seams) are grouped to find the real topology
+		std::vector<unsigned int> positionIds(vertexCount);
+		std::vector<unsigned int> positionGroupSizes;
+		{
+			std::unordered_map<glm::vec3, unsigned int, PositionHash> positions;
+			positions.reserve(vertexCount);
+			for (size_t v = 0; v < vertexCount; v++)
+			{
+				auto [it, inserted] = positions.try_emplace(vertices[v].coords, (unsigned int)positionGroupSizes.size());
+				if (inserted)
+					positionGroupSizes.push_back(0);
+				positionIds[v] = it->second;
+				positionGroupSizes[it->second]++;
+			}
+		}
+
+		// Half-edges between positions without an opposite half-edge are on open borders
+		std::unordered_map<uint64_t, unsigned int> halfEdgeCounts;
+		halfEdgeCounts.reserve(result.size());
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				const unsigned int a = positionIds[result[i + corner]];
+				const unsigned int b = positionIds[result[i + (corner + 1) % 3]];
+				halfEdgeCounts[edgeKey(a, b)]++;
+			}
+		}
+
+		std::unordered_set<uint64_t> openEdges;
+		std::vector<VertexKind> kinds(vertexCount, VertexKind::Manifold);
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				const unsigned int va = result[i + corner];
+				const unsigned int vb = result[i + (corner + 1) % 3];
+				const unsigned int a = positionIds[va];
+				const unsigned int b = positionIds[vb];
+
+				auto opposite = halfEdgeCounts.find(edgeKey(b, a));
+				if (halfEdgeCounts[edgeKey(a, b)] > 1 || (opposite != halfEdgeCounts.end() && opposite->second > 1))
+				{
+					kinds[va] = VertexKind::Locked;
+					kinds[vb] = VertexKind::Locked;
+				}
+				else if (opposite == halfEdgeCounts.end())
+				{
+					openEdges.insert(edgeKey(std::min(a, b), std::max(a, b)));
+					for (unsigned int v : { va, vb })
+					{
+						if (kinds[v] == VertexKind::Manifold)
+							kinds[v] = VertexKind::Border;
+					}
+				}
+			}
+		}
+
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			if (positionGroupSizes[positionIds[v]] > 1)
+				kinds[v] = VertexKind::Locked;
+		}
+
+		// Area-weighted planes of the faces, plus planes perpendicular to the faces along open edges
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			const glm::dvec3 p[3] = {
+				vertices[result[i]].coords, vertices[result[i + 1]].coords, vertices[result[i + 2]].coords };
+			const glm::dvec3 areaNormal = glm::cross(p[1] - p[0], p[2] - p[0]);
+			const double doubleArea = glm::length(areaNormal);
+			if (doubleArea <= 0.0)
+				continue;
+
+			const glm::dvec3 normal = areaNormal / doubleArea;
+			for (size_t corner = 0; corner < 3; corner++)
+				quadrics[result[i + corner]].addPlane(normal, -glm::dot(normal, p[0]), doubleArea * 0.5);
+
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				const unsigned int a = positionIds[result[i + corner]];
+				const unsigned int b = positionIds[result[i + (corner + 1) % 3]];
+				if (!openEdges.contains(edgeKey(std::min(a, b), std::max(a, b))))
+					continue;
+
+				const glm::dvec3 edge = p[(corner + 1) % 3] - p[corner];
+				const double edgeLength = glm::length(edge);
+				if (edgeLength <= 0.0)
+					continue;
+
+				const glm::dvec3 borderNormal = glm::normalize(glm::cross(edge, normal));
+				const double borderDistance = -glm::dot(borderNormal, p[corner]);
+				quadrics[result[i + corner]].addPlane(borderNormal, borderDistance, edgeLength * edgeLength * BorderWeight);
+				quadrics[result[i + (corner + 1) % 3]].addPlane(borderNormal, borderDistance, edgeLength * edgeLength * BorderWeight);
+			}
+		}
+
+		const Bounds bounds = Bounds::fromPoints(vertices.data(), sizeof(StaticMesh::Vertex), vertices.size());
+		const float attributeScale = AttributeWeight * AttributeWeight * bounds.sphere.radius * bounds.sphere.radius;
+
+		auto collapseCost = [&](unsigned int source, unsigned int target)
+		{
+			const StaticMesh::Vertex& from = vertices[source];
+			const StaticMesh::Vertex& to = vertices[target];
+			const glm::vec3 normalDelta = from.normals - to.normals;
+			const glm::vec2 uvDelta = from.uvs - to.uvs;
+
+			return float(quadrics[source].error(to.coords))
+				+ attributeScale * (glm::dot(normalDelta, normalDelta) + glm::dot(uvDelta, uvDelta));
+		};
+
+		auto canCollapse = [&](unsigned int source, unsigned int target)
+		{
+			switch (kinds[source])
+			{
+			case VertexKind::Manifold:
+				return true;
+			case VertexKind::Border:
+			{
+				const unsigned int a = positionIds[source];
+				const unsigned int b = positionIds[target];
+				return openEdges.contains(edgeKey(std::min(a, b), std::max(a, b)));
+			}
+			default:
+				return false;
+			}
+		};
+
+		std::vector<unsigned int> remap(vertexCount);
+		std::vector<bool> touched(vertexCount);
+		std::vector<unsigned int> triangleOffsets(vertexCount + 1);
+		std::vector<unsigned int> vertexTriangles;
+		std::vector<Collapse> collapses;
+
+		// Triangles around the source must not flip when it moves onto the target
+		auto flips = [&](unsigned int source, unsigned int target)
+		{
+			const glm::vec3& targetPosition = vertices[target].coords;
+			for (unsigned int j = triangleOffsets[source]; j < triangleOffsets[source + 1]; j++)
+			{
+				const unsigned int* triangle = &result[size_t(vertexTriangles[j]) * 3];
+				const unsigned int corners[3] = { remap[triangle[0]], remap[triangle[1]], remap[triangle[2]] };
+				if (corners[0] == target || corners[1] == target || corners[2] == target)
+					continue; // Degenerates and disappears
+
+				glm::vec3 before[3];
+				glm::vec3 after[3];
+				for (size_t corner = 0; corner < 3; corner++)
+				{
+					before[corner] = vertices[corners[corner]].coords;
+					after[corner] = corners[corner] == source ? targetPosition : before[corner];
+				}
+
+				// Turning by more than about 75 degrees or collapsing to a sliver counts as a flip
+				const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				const float lengthBefore = glm::length(normalBefore);
+				const float lengthAfter = glm::length(normalAfter);
+				if (lengthAfter <= lengthBefore * 1e-3f
+					|| glm::dot(normalBefore, normalAfter) <= 0.25f * lengthBefore * lengthAfter)
+					return true;
+			}
+
+			return false;
+		};
+
+		float maxCost = 0.0f;
+		for (size_t pass = 0; pass < MaxPasses && result.size() > targetIndexCount; pass++)
+		{
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+			for (unsigned int index : result)
+				triangleOffsets[index + 1]++;
+			std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+
+			vertexTriangles.resize(result.size());
+			std::vector<unsigned int> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++)
+				vertexTriangles[cursor[result[i]]++] = (unsigned int)(i / 3);
+
+			collapses.clear();
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				for (size_t corner = 0; corner < 3; corner++)
+				{
+					const unsigned int a = result[i + corner];
+					const unsigned int b = result[i + (corner + 1) % 3];
+					if (canCollapse(a, b))
+						collapses.push_back({ a, b, collapseCost(a, b) });
+					if (canCollapse(b, a))
+						collapses.push_back({ b, a, collapseCost(b, a) });
+				}
+			}
+
+			std::sort(collapses.begin(), collapses.end(),
+				[](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			// Collapsing an interior edge removes two triangles. Each vertex is collapsed at most once per pass.
+			const size_t neededCollapses = (result.size() - targetIndexCount) / 6 + 1;
+			std::iota(remap.begin(), remap.end(), 0);
+			std::fill(touched.begin(), touched.end(), false);
+
+			size_t appliedCollapses = 0;
+			for (const Collapse& collapse : collapses)
+			{
+				if (appliedCollapses == neededCollapses)
+					break;
+				if (touched[collapse.source] || touched[collapse.target] || flips(collapse.source, collapse.target))
+					continue;
+
+				remap[collapse.source] = collapse.target;
+				quadrics[collapse.target].add(quadrics[collapse.source]);
+				touched[collapse.source] = true;
+				touched[collapse.target] = true;
+				maxCost = std::max(maxCost, collapse.cost);
+				appliedCollapses++;
+			}
+
+			if (appliedCollapses == 0)
+				break;
+
+			size_t writeIndex = 0;
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				const unsigned int a = remap[result[i]];
+				const unsigned int b = remap[result[i + 1]];
+				const unsigned int c = remap[result[i + 2]];
+				if (positionIds[a] == positionIds[b] || positionIds[b] == positionIds[c] || positionIds[a] == positionIds[c])
+					continue;
+
+				result[writeIndex++] = a;
+				result[writeIndex++] = b;
+				result[writeIndex++] = c;
+			}
+			result.resize(writeIndex);
+		}
+
+		resultError = std::sqrt(maxCost);
+		return result;
+	}
+
+	std::vector<StaticMesh::Lod> generateLods(std::span<const StaticMesh::Vertex> vertices,
+											  std::vector<unsigned int>& indices, size_t maxLevelCount, float reduction)
+	{
+		constexpr size_t minTriangleCount = 16;
+		// Levels that remove less than this fraction of the previous one are not worth their memory
+		constexpr float minReduction = 0.1f;
+
+		std::vector<StaticMesh::Lod> lods = { { 0, (unsigned int)indices.size(), 0.0f } };
+		std::vector<unsigned int> previous = indices;
+		float error = 0.0f;
+
+		const size_t levelCount = std::min(maxLevelCount, StaticMesh::MaxLods);
+		while (lods.size() < levelCount)
+		{
+			const size_t targetIndexCount = size_t(float(previous.size() / 3) * reduction) * 3;
+			if (targetIndexCount < minTriangleCount * 3)
+				break;
+
+			// Each level is simplified from the previous one, so errors add up
+			float levelError;
+			std::vector<unsigned int> level = simplify(vertices, previous, targetIndexCount, levelError);
+			if (float(level.size()) > float(previous.size()) * (1.0f - minReduction))
+				break;
+
+			optimizeVertexCache(level, vertices.size());
+			error += levelError;
+
+			lods.push_back({ (unsigned int)indices.size(), (unsigned int)level.size(), error });
+			indices.insert(indices.end(), level.begin(), level.end());
+			previous = std::move(level);
+		}
+
+		spdlog::debug("Generated {} levels of detail, the last one has {} triangles with an error of {}.",
+			lods.size(), lods.back().indexCount / 3, lods.back().error);
+
+		return lods;
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "../core/StaticMesh.h"
+
+namespace BerylEngine::MeshUtilities
+{
+	/// <summary>
+	/// Simplify a triangle list down to about targetIndexCount indices with quadric error metrics.
+	/// Vertices are collapsed onto their neighbours, so the result indexes the same vertices.
+	/// UV and normal seams, open borders and non-manifold edges are preserved, and normal and UV
+	/// differences add to the error so that collapses across attribute discontinuities come last.
+	/// resultError is the deviation from the input, in object space units.
+	/// </summary>
+	std::vector<unsigned int> simplify(std::span<const StaticMesh::Vertex> vertices, std::span<const unsigned int> indices,
+									   size_t targetIndexCount, float& resultError);
+
+	/// <summary>
+	/// Append up to maxLevelCount - 1 simplified levels to indices, each with about reduction times the
+	/// triangles of the previous one, and return the whole chain. indices is the first level.
+	/// The chain stops early when simplification stalls.
+	/// </summary>
+	std::vector<StaticMesh::Lod> generateLods(std::span<const StaticMesh::Vertex> vertices,
+											  std::vector<unsigned int>& indices, size_t maxLevelCount = 4,
+											  float reduction = 0.5f);
+}
@@ -1,9 +1,18 @@
 #include "meshUtilities.h"
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
-#include <map>
 #include <spdlog/spdlog.h>
-#include <sstream>
+
+#include "../core/Lz4.h"
+#include "../core/MappedFile.h"
+#include "../core/ThreadPool.h"
+#include "meshOptimizer.h"
+#include "meshSimplifier.h"
 
 namespace BerylEngine::MeshUtilities
 {
@@ -240,113 +249,754 @@ namespace BerylEngine::MeshUtilities
 
 		return std::make_shared<StaticMesh>(vertices, indices);
 	}
-	std::shared_ptr<StaticMesh> staticFromOBJ(const std::string& path)
+	namespace
 	{
-		std::ifstream stream;
-		stream.open(path);
+		// Face corner as written in the file. Indices are 0-based, -1 when the attribute is missing.
+		struct ObjCorner
+		{
+			int position;
+			int uv;
+			int normal;
+
+			bool operator==(const ObjCorner& other) const = default;
+		};
 
-		if (stream.is_open())
+		// Negative OBJ indices are relative to the elements declared before them. As chunks are parsed
+		// independently, those are stored relative to the start of their chunk and flagged here.
+		enum ObjRelativeFlags : uint8_t
 		{
-			bool secondMesh = false;
+			RelativePosition = 1,
+			RelativeUV = 2,
+			RelativeNormal = 4,
+		};
 
-			std::vector<glm::vec3> vertices;
+		struct ObjChunk
+		{
+			std::vector<glm::vec3> positions;
 			std::vector<glm::vec3> normals;
 			std::vector<glm::vec2> uvs;
+			std::vector<ObjCorner> corners;
+			std::vector<uint8_t> relativeFlags;
+			std::vector<uint32_t> faceSizes;
+			size_t errorLine = 0;
+		};
+
+		struct ObjCursor
+		{
+			const char* current;
+			const char* end;
 
-			std::vector<StaticMesh::Vertex> mesh_vertices;
-			std::vector<unsigned int> mesh_indices;
+			void skipBlanks()
+			{
+				while (current != end && (*current == ' ' || *current == '\t' || *current == '\r'))
+					current++;
+			}
 
-			struct VertexInfo
+			bool atLineEnd() const
 			{
-				int vertIdx;
-				int normIdx;
-				int uvIdx;
+				return current == end || *current == '\n';
+			}
 
-				bool operator<(const VertexInfo& rhs) const
+			bool parseFloat(float& value)
+			{
+				skipBlanks();
+				if (current != end && *current == '+')
+					current++;
+
+				auto [next, error] = std::from_chars(current, end, value);
+				if (error != std::errc())
+					return false;
+
+				current = next;
+				return true;
+			}
+
+			bool parseInt(int& value)
+			{
+				auto [next, error] = std::from_chars(current, end, value);
+				if (error != std::errc())
+					return false;
+
+				current = next;
+				return true;
+			}
+		};
+
+		// Parse one face corner (v, v/vt, v//vn or v/vt/vn) and store it with its relative flags
+		bool parseCorner(ObjCursor& cursor, ObjChunk& chunk)
+		{
+			auto resolve = [](int index, size_t declaredCount, int& result, uint8_t flag, uint8_t& flags)
+			{
+				if (index > 0)
 				{
-					return std::tie(vertIdx, normIdx, uvIdx) < std::tie(rhs.vertIdx, rhs.normIdx, rhs.uvIdx);
+					result = index - 1;
+				}
+				else
+				{
+					result = int(declaredCount) + index;
+					flags |= flag;
 				}
 			};
-			std::map<VertexInfo, int> indexMapper;
 
-			std::string line;
-			while (std::getline(stream, line))
+			int position;
+			if (!cursor.parseInt(position) || position == 0)
+				return false;
+
+			ObjCorner corner = { 0, -1, -1 };
+			uint8_t flags = 0;
+			resolve(position, chunk.positions.size(), corner.position, RelativePosition, flags);
+
+			if (cursor.current != cursor.end && *cursor.current == '/')
 			{
-				if (line[0] == '#')
-					continue;
+				cursor.current++;
+				int uv;
+				if (cursor.current != cursor.end && *cursor.current != '/')
+				{
+					if (!cursor.parseInt(uv) || uv == 0)
+						return false;
+					resolve(uv, chunk.uvs.size(), corner.uv, RelativeUV, flags);
+				}
 
-				auto splitted = splitstr(line, ' ');
-				if (line[0] == 'o')
+				if (cursor.current != cursor.end && *cursor.current == '/')
 				{
-					if (secondMesh)
-					{
-						spdlog::warn("{} contained more than one mesh definition. Only the first one was parsed.");
-						break;
-					}
+					cursor.current++;
+					int normal;
+					if (!cursor.parseInt(normal) || normal == 0)
+						return false;
+					resolve(normal, chunk.normals.size(), corner.normal, RelativeNormal, flags);
+				}
+			}
+
+			chunk.corners.push_back(corner);
+			chunk.relativeFlags.push_back(flags);
+			return true;
+		}
+
+		bool parseLine(ObjCursor& cursor, ObjChunk& chunk)
+		{
+			cursor.skipBlanks();
+			if (cursor.atLineEnd())
+				return true;
+
+			const char type = *cursor.current++;
+			if (type == 'v')
+			{
+				const char subtype = cursor.current != cursor.end ? *cursor.current : '\n';
+				if (subtype == 't')
+				{
+					cursor.current++;
+					glm::vec2 uv;
+					if (!cursor.parseFloat(uv.x) || !cursor.parseFloat(uv.y))
+						return false;
+					chunk.uvs.push_back(uv);
 				}
-				else if (line[0] == 'v')
+				else if (subtype == 'n')
 				{
-					if (line[1] == 't')
-					{
-						uvs.push_back({
-							std::stof(splitted[1]),
-							std::stof(splitted[2])
-							});
-					}
-					else if (line[1] == 'n')
+					cursor.current++;
+					glm::vec3 normal;
+					if (!cursor.parseFloat(normal.x) || !cursor.parseFloat(normal.y) || !cursor.parseFloat(normal.z))
+						return false;
+					chunk.normals.push_back(normal);
+				}
+				else if (subtype == ' ' || subtype == '\t')
+				{
+					glm::vec3 position;
+					if (!cursor.parseFloat(position.x) || !cursor.parseFloat(position.y) || !cursor.parseFloat(position.z))
+						return false;
+					chunk.positions.push_back(position);
+				}
+			}
+			else if (type == 'f')
+			{
+				uint32_t cornerCount = 0;
+				cursor.skipBlanks();
+				while (!cursor.atLineEnd())
+				{
+					if (!parseCorner(cursor, chunk))
+						return false;
+					cornerCount++;
+					cursor.skipBlanks();
+				}
+
+				if (cornerCount < 3)
+					return false;
+				chunk.faceSizes.push_back(cornerCount);
+			}
+
+			// Other statements (comments, objects, groups, materials...) are ignored
+			return true;
+		}
+
+		void parseChunk(const char* begin, const char* end, ObjChunk& chunk)
+		{
+			ObjCursor cursor = { begin, end };
+			size_t line = 0;
+			while (cursor.current != end)
+			{
+				line++;
+				if (!parseLine(cursor, chunk) && chunk.errorLine == 0)
+					chunk.errorLine = line;
+
+				const void* lineEnd = std::memchr(cursor.current, '\n', end - cursor.current);
+				cursor.current = lineEnd != nullptr ? static_cast<const char*>(lineEnd) + 1 : end;
+			}
+		}
+
+		// Open addressing map from face corners to welded vertex indices, with linear probing
+		class CornerWeldMap
+		{
+		public:
+			CornerWeldMap(size_t expectedCount)
+			{
+				size_t capacity = 16;
+				while (capacity < expectedCount * 2)
+					capacity *= 2;
+
+				m_keys.resize(capacity);
+				m_values.resize(capacity, Empty);
+			}
+
+			// Return the vertex index of the corner, or insert the given one and return it
+			unsigned int findOrInsert(const ObjCorner& corner, unsigned int vertexIndex)
+			{
+				if ((m_count + 1) * 2 > m_values.size())
+					rehash(m_values.size() * 2);
+
+				size_t slot = hash(corner) & (m_values.size() - 1);
+				while (m_values[slot] != Empty)
+				{
+					if (m_keys[slot] == corner)
+						return m_values[slot];
+					slot = (slot + 1) & (m_values.size() - 1);
+				}
+
+				m_keys[slot] = corner;
+				m_values[slot] = vertexIndex;
+				m_count++;
+				return vertexIndex;
+			}
+
+		private:
+			static constexpr unsigned int Empty = ~0u;
+
+			std::vector<ObjCorner> m_keys;
+			std::vector<unsigned int> m_values;
+			size_t m_count = 0;
+
+			static size_t hash(const ObjCorner& corner)
+			{
+				uint64_t h = uint64_t(uint32_t(corner.position)) * 0x9E3779B97F4A7C15ull;
+				h ^= (uint64_t(uint32_t(corner.uv)) + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+				h ^= (uint64_t(uint32_t(corner.normal)) + 0x165667B19E3779F9ull) * 0x85EBCA77C2B2AE63ull;
+				return size_t(h ^ (h >> 29));
+			}
+
+			void rehash(size_t capacity)
+			{
+				std::vector<ObjCorner> keys(capacity);
+				std::vector<unsigned int> values(capacity, Empty);
+				for (size_t i = 0; i < m_values.size(); i++)
+				{
+					if (m_values[i] == Empty)
+						continue;
+
+					size_t slot = hash(m_keys[i]) & (capacity - 1);
+					while (values[slot] != Empty)
+						slot = (slot + 1) & (capacity - 1);
+					keys[slot] = m_keys[i];
+					values[slot] = m_values[i];
+				}
+
+				m_keys = std::move(keys);
+				m_values = std::move(values);
+			}
+		};
+	}
+
+	static bool parseOBJ(const std::string& path, const MappedFile& file,
+						std::vector<StaticMesh::Vertex>& meshVertices, std::vector<unsigned int>& meshIndices)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		const char* text = reinterpret_cast<const char*>(file.data().data());
+		const char* textEnd = text + file.size();
+
+		// Split the file in chunks ending on line boundaries and parse them in parallel
+		ThreadPool& pool = ThreadPool::global();
+		constexpr size_t minChunkSize = 1 << 20;
+		const size_t chunkCount = std::clamp<size_t>(file.size() / minChunkSize, 1, (pool.threadCount() + 1) * 4);
+
+		std::vector<const char*> boundaries = { text };
+		for (size_t i = 1; i < chunkCount; i++)
+		{
+			const char* target = std::max(text + file.size() * i / chunkCount, boundaries.back());
+			const void* lineEnd = std::memchr(target, '\n', textEnd - target);
+			boundaries.push_back(lineEnd != nullptr ? static_cast<const char*>(lineEnd) + 1 : textEnd);
+		}
+		boundaries.push_back(textEnd);
+
+		std::vector<ObjChunk> chunks(chunkCount);
+		pool.parallelFor(chunkCount, [&](size_t i) { parseChunk(boundaries[i], boundaries[i + 1], chunks[i]); });
+
+		size_t positionCount = 0;
+		size_t uvCount = 0;
+		size_t normalCount = 0;
+		size_t cornerCount = 0;
+		size_t triangleCount = 0;
+		for (const ObjChunk& chunk : chunks)
+		{
+			if (chunk.errorLine != 0)
+			{
+				spdlog::error("Failed to parse OBJ file {}: malformed statement in chunk starting at byte {}, line {}.",
+					path, boundaries[&chunk - chunks.data()] - text, chunk.errorLine);
+				return false;
+			}
+
+			positionCount += chunk.positions.size();
+			uvCount += chunk.uvs.size();
+			normalCount += chunk.normals.size();
+			cornerCount += chunk.corners.size();
+			for (uint32_t faceSize : chunk.faceSizes)
+				triangleCount += faceSize - 2;
+		}
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec2> uvs;
+		std::vector<glm::vec3> normals;
+		positions.reserve(positionCount);
+		uvs.reserve(uvCount);
+		normals.reserve(normalCount);
+
+		meshIndices.reserve(triangleCount * 3);
+		CornerWeldMap weldMap(cornerCount / 2);
+
+		// Relative indices are resolved with the number of elements declared before their chunk
+		std::vector<glm::ivec3> chunkBases;
+		chunkBases.reserve(chunkCount);
+		for (const ObjChunk& chunk : chunks)
+		{
+			chunkBases.push_back({ int(positions.size()), int(uvs.size()), int(normals.size()) });
+			positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+			uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+			normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+		}
+
+		// Corners are welded in file order so that vertex order does not depend on the chunking
+		std::vector<unsigned int> faceVertices;
+		for (size_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
+		{
+			const ObjChunk& chunk = chunks[chunkIndex];
+			const glm::ivec3 base = chunkBases[chunkIndex];
+
+			size_t cornerIndex = 0;
+			for (uint32_t faceSize : chunk.faceSizes)
+			{
+				faceVertices.clear();
+				for (uint32_t i = 0; i < faceSize; i++, cornerIndex++)
+				{
+					ObjCorner corner = chunk.corners[cornerIndex];
+					const uint8_t flags = chunk.relativeFlags[cornerIndex];
+					if (flags & RelativePosition)
+						corner.position += base.x;
+					if (flags & RelativeUV)
+						corner.uv += base.y;
+					if (flags & RelativeNormal)
+						corner.normal += base.z;
+
+					if (corner.position < 0 || size_t(corner.position) >= positionCount
+						|| corner.uv >= int(uvCount) || corner.normal >= int(normalCount)
+						|| ((flags & RelativeUV) && corner.uv < 0) || ((flags & RelativeNormal) && corner.normal < 0))
 					{
-						normals.push_back({
-							std::stof(splitted[1]),
-							std::stof(splitted[2]),
-							std::stof(splitted[3])
-							});
+						spdlog::error("Failed to parse OBJ file {}: face index out of range.", path);
+						return false;
 					}
-					else
+
+					const unsigned int vertexIndex = weldMap.findOrInsert(corner, (unsigned int)meshVertices.size());
+					if (vertexIndex == meshVertices.size())
 					{
-						vertices.push_back({
-							std::stof(splitted[1]),
-							std::stof(splitted[2]),
-							std::stof(splitted[3])
-							});
+						meshVertices.push_back({
+							positions[corner.position],
+							corner.normal >= 0 ? normals[corner.normal] : glm::vec3(0.0f),
+							corner.uv >= 0 ? uvs[corner.uv] : glm::vec2(0.0f) });
 					}
+					faceVertices.push_back(vertexIndex);
 				}
-				else if (line[0] == 'f')
+
+				// Quads and n-gons are triangulated as fans
+				for (uint32_t i = 1; i + 1 < faceSize; i++)
 				{
-					for (int i = 1; i < 4; i++)
-					{
-						auto indices = splitstr(splitted[i], '/');
-						int vertIdx = std::stoi(indices[0]) - 1;
-						int uvIdx = std::stoi(indices[1]) - 1;
-						int normIdx = std::stoi(indices[2]) - 1;
-						VertexInfo vInfo = { vertIdx, uvIdx, normIdx };
-
-						if (indexMapper.find(vInfo) == indexMapper.end())
-						{
-							glm::vec3 v = vertices.at(vertIdx);
-							glm::vec3 n = normals.at(normIdx);
-							glm::vec2 uv = uvs.at(uvIdx);
-
-							mesh_vertices.push_back({ v, n, uv });
-							int vertexIndex = int(mesh_vertices.size()) - 1;
-							mesh_indices.push_back(vertexIndex);
-							indexMapper.insert({ vInfo, vertexIndex });
-						}
-						else
-						{
-							mesh_indices.push_back(indexMapper[vInfo]);
-						}
-					}
+					meshIndices.push_back(faceVertices[0]);
+					meshIndices.push_back(faceVertices[i]);
+					meshIndices.push_back(faceVertices[i + 1]);
 				}
 			}
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		const double megabytes = double(file.size()) / (1024.0 * 1024.0);
+		spdlog::debug("Parsed {} ({:.1f} MB, {} triangles, {} vertices) in {:.1f} ms with {} chunks: {:.0f} MB/s.",
+			path, megabytes, triangleCount, meshVertices.size(), seconds * 1000.0, chunkCount,
+			seconds > 0.0 ? megabytes / seconds : 0.0);
+
+		return true;
+	}
+
+	namespace
+	{
+		constexpr uint32_t MeshFileMagic = 0x48534D42; // "BMSH"
+		constexpr uint32_t MeshFileVersion = 5;
+		constexpr size_t MeshFileAlignment = 16;
+
+		enum MeshFileFlags : uint32_t
+		{
+			MeshFileCompressed = 1 << 0,
+			MeshFileShortIndices = 1 << 1,
+		};
+
+		// Sections follow the header in this order, each aligned to MeshFileAlignment:
+		// vertices (StaticMesh::PackedVertex), indices (uint16 or uint32), submeshes (StaticMesh::Submesh),
+		// levels of detail (StaticMesh::Lod).
+		// When compressed, the sections are laid out the same way inside a single LZ4 block.
+		struct MeshFileHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t vertexStride;
+			uint32_t flags;
+			uint64_t sourceHash;
+			uint64_t sourceSize;
+			int64_t sourceWriteTime;
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			uint32_t submeshCount;
+			uint32_t lodCount;
+			glm::vec3 boxMin;
+			glm::vec3 boxMax;
+			glm::vec3 sphereCenter;
+			float sphereRadius;
+			uint64_t payloadOffset;
+			uint64_t payloadSize; // Bytes stored in the file, compressed or not
+		};
+
+		static_assert(sizeof(MeshFileHeader) % MeshFileAlignment == 0);
+
+		struct MeshFileLayout
+		{
+			size_t vertexOffset;
+			size_t indexOffset;
+			size_t submeshOffset;
+			size_t lodOffset;
+			size_t size;
+
+			MeshFileLayout(size_t vertexCount, size_t indexCount, size_t indexSize, size_t submeshCount, size_t lodCount)
+			{
+				vertexOffset = 0;
+				indexOffset = alignUp(vertexOffset + vertexCount * sizeof(StaticMesh::PackedVertex));
+				submeshOffset = alignUp(indexOffset + indexCount * indexSize);
+				lodOffset = alignUp(submeshOffset + submeshCount * sizeof(StaticMesh::Submesh));
+				size = lodOffset + lodCount * sizeof(StaticMesh::Lod);
+			}
+
+			static size_t alignUp(size_t offset)
+			{
+				return (offset + MeshFileAlignment - 1) & ~(MeshFileAlignment - 1);
+			}
+		};
+	}
+
+	bool writeMeshFile(const std::string& path, std::span<const StaticMesh::Vertex> vertices,
+					   std::span<const unsigned int> indices, const Bounds& bounds,
+					   std::span<const StaticMesh::Submesh> submeshes, std::span<const StaticMesh::Lod> lods,
+					   uint64_t sourceHash, const FileStamp& sourceStamp, bool compress)
+	{
+		// Stored in the GPU format so that loading does not need to touch the data
+		const std::vector<StaticMesh::PackedVertex> packedVertices = StaticMesh::packVertices(vertices, bounds.box);
+		const bool shortIndices = vertices.size() <= StaticMesh::MaxShortIndexVertices;
+		const std::vector<uint16_t> narrowedIndices = shortIndices ? StaticMesh::narrowIndices(indices) : std::vector<uint16_t>();
+		const std::span<const std::byte> indexBytes = shortIndices
+			? std::as_bytes(std::span(narrowedIndices)) : std::as_bytes(indices);
+
+		const MeshFileLayout layout(vertices.size(), indices.size(), shortIndices ? sizeof(uint16_t) : sizeof(uint32_t),
+			submeshes.size(), lods.size());
+
+		std::vector<std::byte> payload(layout.size);
+		std::memcpy(payload.data() + layout.vertexOffset, packedVertices.data(), packedVertices.size() * sizeof(StaticMesh::PackedVertex));
+		std::memcpy(payload.data() + layout.indexOffset, indexBytes.data(), indexBytes.size());
+		std::memcpy(payload.data() + layout.submeshOffset, submeshes.data(), submeshes.size_bytes());
+		std::memcpy(payload.data() + layout.lodOffset, lods.data(), lods.size_bytes());
+
+		if (compress)
+		{
+			std::vector<std::byte> compressed(Lz4::compressBound(payload.size()));
+			compressed.resize(Lz4::compress(payload, compressed));
+			payload = std::move(compressed);
+		}
+
+		MeshFileHeader header = {};
+		header.magic = MeshFileMagic;
+		header.version = MeshFileVersion;
+		header.vertexStride = sizeof(StaticMesh::PackedVertex);
+		header.flags = (compress ? MeshFileCompressed : 0) | (shortIndices ? MeshFileShortIndices : 0);
+		header.sourceHash = sourceHash;
+		header.sourceSize = sourceStamp.size;
+		header.sourceWriteTime = sourceStamp.writeTime;
+		header.vertexCount = (uint32_t)vertices.size();
+		header.indexCount = (uint32_t)indices.size();
+		header.submeshCount = (uint32_t)submeshes.size();
+		header.lodCount = (uint32_t)lods.size();
+		header.boxMin = bounds.box.min;
+		header.boxMax = bounds.box.max;
+		header.sphereCenter = bounds.sphere.center;
+		header.sphereRadius = bounds.sphere.radius;
+		header.payloadOffset = sizeof(MeshFileHeader);
+		header.payloadSize = payload.size();
+
+		const std::span<const std::byte> parts[] = { std::as_bytes(std::span(&header, 1)), payload };
+		return writeFileAtomically(path, parts);
+	}
+
+	template<typename T>
+	static std::span<const T> indexSpan(std::span<const std::byte> data, size_t count)
+	{
+		return std::span(reinterpret_cast<const T*>(data.data()), count);
+	}
+
+	template<typename T>
+	static bool indicesBelow(std::span<const std::byte> data, size_t count, size_t vertexCount)
+	{
+		return std::all_of(indexSpan<T>(data, count).begin(), indexSpan<T>(data, count).end(),
+			[&](T index) { return index < vertexCount; });
+	}
+
+	size_t MeshData::geometrySize() const
+	{
+		return vertices.size_bytes() + shortIndices.size_bytes() + indices.size_bytes();
+	}
+
+	void MeshData::upload(StaticMesh& mesh)
+	{
+		if (!shortIndices.empty())
+			mesh.upload(vertices, shortIndices, bounds, std::move(submeshes), std::move(lods));
+		else
+			mesh.upload(vertices, indices, bounds, std::move(submeshes), std::move(lods));
+	}
+
+	bool loadMeshFile(const std::string& path, MeshData& meshData)
+	{
+		MappedFile file(path);
+		if (!file.isOpen())
+		{
+			spdlog::error("Failed to open mesh file {}.", path);
+			return false;
+		}
+
+		const std::span<const std::byte> data = file.data();
+		MeshFileHeader header;
+		if (data.size() < sizeof(header))
+		{
+			spdlog::error("Failed to load mesh file {}: truncated header.", path);
+			return false;
+		}
+		std::memcpy(&header, data.data(), sizeof(header));
+
+		if (header.magic != MeshFileMagic || header.version != MeshFileVersion
+			|| header.vertexStride != sizeof(StaticMesh::PackedVertex))
+		{
+			spdlog::debug("Mesh file {} has an unsupported format or version.", path);
+			return false;
+		}
+
+		const bool compressed = header.flags & MeshFileCompressed;
+		const bool shortIndices = header.flags & MeshFileShortIndices;
+		const MeshFileLayout layout(header.vertexCount, header.indexCount,
+			shortIndices ? sizeof(uint16_t) : sizeof(uint32_t), header.submeshCount, header.lodCount);
+		if (header.payloadOffset % MeshFileAlignment != 0 || header.payloadOffset > data.size()
+			|| header.payloadSize > data.size() - header.payloadOffset
+			|| (!compressed && header.payloadSize != layout.size))
+		{
+			spdlog::error("Failed to load mesh file {}: truncated or corrupted payload.", path);
+			return false;
+		}
+
+		std::span<const std::byte> payload = data.subspan(header.payloadOffset, header.payloadSize);
+
+		// Uncompressed payloads are read in place from the mapping, compressed ones are expanded first
+		std::vector<std::byte> decompressed;
+		if (compressed)
+		{
+			decompressed.resize(layout.size);
+			if (!Lz4::decompress(payload, decompressed))
+			{
+				spdlog::error("Failed to load mesh file {}: corrupted compressed payload.", path);
+				return false;
+			}
+			payload = decompressed;
+		}
 
-			spdlog::trace("Mesh loaded from {}.", path);
+		std::vector<StaticMesh::Submesh> submeshes(header.submeshCount);
+		std::memcpy(submeshes.data(), payload.data() + layout.submeshOffset, submeshes.size() * sizeof(StaticMesh::Submesh));
+		std::vector<StaticMesh::Lod> lods(header.lodCount);
+		std::memcpy(lods.data(), payload.data() + layout.lodOffset, lods.size() * sizeof(StaticMesh::Lod));
 
-			return std::make_shared<StaticMesh>(mesh_vertices, mesh_indices);
+		const bool indicesInRange = shortIndices
+			? indicesBelow<uint16_t>(payload.subspan(layout.indexOffset), header.indexCount, header.vertexCount)
+			: indicesBelow<uint32_t>(payload.subspan(layout.indexOffset), header.indexCount, header.vertexCount);
+		if (!indicesInRange)
+		{
+			spdlog::error("Failed to load mesh file {}: index out of range.", path);
+			return false;
+		}
+		for (const StaticMesh::Submesh& submesh : submeshes)
+		{
+			if (submesh.firstIndex > header.indexCount || submesh.indexCount > header.indexCount - submesh.firstIndex)
+			{
+				spdlog::error("Failed to load mesh file {}: submesh out of range.", path);
+				return false;
+			}
 		}
+		for (const StaticMesh::Lod& lod : lods)
+		{
+			if (lod.firstIndex > header.indexCount || lod.indexCount > header.indexCount - lod.firstIndex)
+			{
+				spdlog::error("Failed to load mesh file {}: level of detail out of range.", path);
+				return false;
+			}
+		}
+
+		// The spans point into the mapping or the decompressed buffer, both move along with meshData
+		meshData.vertices = std::span(reinterpret_cast<const StaticMesh::PackedVertex*>(payload.data() + layout.vertexOffset),
+			header.vertexCount);
+		if (shortIndices)
+			meshData.shortIndices = indexSpan<uint16_t>(payload.subspan(layout.indexOffset), header.indexCount);
 		else
+			meshData.indices = indexSpan<uint32_t>(payload.subspan(layout.indexOffset), header.indexCount);
+		meshData.bounds.box = { header.boxMin, header.boxMax };
+		meshData.bounds.sphere = { header.sphereCenter, header.sphereRadius };
+		meshData.submeshes = std::move(submeshes);
+		meshData.lods = std::move(lods);
+		meshData.file = std::move(file);
+		meshData.decompressed = std::move(decompressed);
+
+		spdlog::trace("Mesh loaded from {}.", path);
+
+		return true;
+	}
+
+	// A cache is current when its source has the recorded size and write time. Otherwise the source is hashed, and
+	// a cache of the same content, e.g. after a copy or a checkout, gets the new stamp instead of being rebuilt.
+	// The header is read and patched with plain file streams, before the cache is mapped.
+	// Without a sourceStamp, the source is always hashed and the cache is not patched.
+	static bool isMeshFileCurrent(const std::string& cachePath, const FileStamp* sourceStamp,
+								  std::span<const std::byte> source, uint64_t& sourceHash)
+	{
+		MeshFileHeader header;
+		{
+			std::ifstream file(cachePath, std::ios::binary);
+			if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+				|| header.magic != MeshFileMagic || header.version != MeshFileVersion)
+				return false;
+		}
+
+		if (sourceStamp && header.sourceSize == sourceStamp->size && header.sourceWriteTime == sourceStamp->writeTime)
+			return true;
+
+		sourceHash = fnv1a(source);
+		if (header.sourceHash != sourceHash)
+		{
+			spdlog::debug("Mesh file {} is out of date.", cachePath);
+			return false;
+		}
+		if (!sourceStamp)
+			return true;
+
+		header.sourceSize = sourceStamp->size;
+		header.sourceWriteTime = sourceStamp->writeTime;
+		std::fstream file(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (!file)
+			spdlog::debug("Failed to update the source stamp of mesh file {}.", cachePath);
+
+		return true;
+	}
+
+	bool loadOBJ(const std::string& path, MeshData& data)
+	{
+		MappedFile file(path);
+		if (!file.isOpen())
 		{
 			spdlog::error("Failed to open OBJ file from {}", path);
-			return nullptr;
+			return false;
+		}
+
+		// The cache is keyed by the content of the source, so edited files are parsed again.
+		// The content is only hashed when the size or write time of the source changed, or cannot be queried.
+		FileStamp sourceStamp;
+		const bool hasStamp = fileStamp(path, sourceStamp);
+		if (!hasStamp)
+			sourceStamp = {};
+		uint64_t sourceHash = 0;
+		const std::string cachePath = path + MeshFileExtension;
+		if (std::filesystem::exists(cachePath)
+			&& isMeshFileCurrent(cachePath, hasStamp ? &sourceStamp : nullptr, file.data(), sourceHash)
+			&& loadMeshFile(cachePath, data))
+			return true;
+
+		std::vector<StaticMesh::Vertex> vertices;
+		std::vector<unsigned int> indices;
+		if (!parseOBJ(path, file, vertices, indices))
+			return false;
+
+		optimizeMesh(vertices, indices, path);
+		data.lods = generateLods(vertices, indices);
+		data.submeshes = { { 0, data.lods.front().indexCount } };
+		data.bounds = Bounds::fromPoints(vertices.data(), sizeof(StaticMesh::Vertex), vertices.size());
+
+		if (sourceHash == 0)
+			sourceHash = fnv1a(file.data());
+		if (!writeMeshFile(cachePath, vertices, indices, data.bounds, data.submeshes, data.lods, sourceHash,
+			sourceStamp))
+			spdlog::warn("Failed to cache mesh {}, it will be parsed again next time.", path);
+
+		data.packedVertices = StaticMesh::packVertices(vertices, data.bounds.box);
+		data.vertices = data.packedVertices;
+		if (vertices.size() <= StaticMesh::MaxShortIndexVertices)
+		{
+			data.shortIndexStorage = StaticMesh::narrowIndices(indices);
+			data.shortIndices = data.shortIndexStorage;
+		}
+		else
+		{
+			data.indexStorage = std::move(indices);
+			data.indices = data.indexStorage;
 		}
+
+		spdlog::trace("Mesh loaded from {}.", path);
+
+		return true;
+	}
+
+	static std::shared_ptr<StaticMesh> uploadMesh(MeshData& data)
+	{
+		auto mesh = std::make_shared<StaticMesh>();
+		data.upload(*mesh);
+		return mesh;
+	}
+
+	std::shared_ptr<StaticMesh> staticFromMeshFile(const std::string& path)
+	{
+		MeshData data;
+		if (!loadMeshFile(path, data))
+			return nullptr;
+
+		return uploadMesh(data);
+	}
+
+	std::shared_ptr<StaticMesh> staticFromOBJ(const std::string& path)
+	{
+		MeshData data;
+		if (!loadOBJ(path, data))
+			return nullptr;
+
+		return uploadMesh(data);
 	}
-}
\ No newline at end of file
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <span>
+
+#include "../core/MappedFile.h"
 #include "../core/StaticMesh.h"
 
 namespace BerylEngine::MeshUtilities
@@ -7,5 +11,66 @@ namespace BerylEngine::MeshUtilities
 	std::shared_ptr<StaticMesh> staticPlane();
 	std::shared_ptr<StaticMesh> staticCube();
 
+	/// <summary>
+	/// Extension appended to source paths to name their cached mesh file.
+	/// </summary>
+	constexpr const char* MeshFileExtension = ".bmesh";
+
+	/// <summary>
+	/// Mesh loaded in memory but not uploaded yet, so that loading can run away from the render thread.
+	/// Vertices and indices point either into the mapped mesh file or into the owned buffers.
+	/// </summary>
+	struct MeshData
+	{
+		MappedFile file;
+		std::vector<std::byte> decompressed;
+		std::vector<StaticMesh::PackedVertex> packedVertices;
+		std::vector<uint16_t> shortIndexStorage;
+		std::vector<uint32_t> indexStorage;
+
+		std::span<const StaticMesh::PackedVertex> vertices;
+		std::span<const uint16_t> shortIndices; // Only one of the index spans is used
+		std::span<const uint32_t> indices;
+		Bounds bounds;
+		std::vector<StaticMesh::Submesh> submeshes;
+		std::vector<StaticMesh::Lod> lods;
+
+		/// <summary>
+		/// Size of the geometry to upload, in bytes.
+		/// </summary>
+		size_t geometrySize() const;
+
+		/// <summary>
+		/// Fill a mesh created empty. Must run on the render thread.
+		/// </summary>
+		void upload(StaticMesh& mesh);
+	};
+
+	/// <summary>
+	/// CPU part of staticFromOBJ and staticFromMeshFile, safe to call from any thread.
+	/// </summary>
+	bool loadOBJ(const std::string& path, MeshData& data);
+	bool loadMeshFile(const std::string& path, MeshData& data);
+
+	/// <summary>
+	/// Load an OBJ file, optimize it and generate its levels of detail.
+	/// The result is cached next to the file and reused while the source content is unchanged.
+	/// </summary>
 	std::shared_ptr<StaticMesh> staticFromOBJ(const std::string& path);
+
+	/// <summary>
+	/// Write a mesh in the binary mesh format. sourceHash identifies the data the mesh was built from,
+	/// sourceStamp the file it was read from, empty when unknown.
+	/// Compressed files are smaller on disk but cannot be uploaded straight from the mapping.
+	/// </summary>
+	bool writeMeshFile(const std::string& path, std::span<const StaticMesh::Vertex> vertices,
+					   std::span<const unsigned int> indices, const Bounds& bounds,
+					   std::span<const StaticMesh::Submesh> submeshes, std::span<const StaticMesh::Lod> lods,
+					   uint64_t sourceHash = 0, const FileStamp& sourceStamp = {}, bool compress = false);
+
+	/// <summary>
+	/// Map a binary mesh file. Uncompressed vertices and indices are uploaded straight from the mapping,
+	/// they are stored packed (see StaticMesh::PackedVertex).
+	/// </summary>
+	std::shared_ptr<StaticMesh> staticFromMeshFile(const std::string& path);
 }
\ No newline at end of file
@@ -1,13 +1,22 @@
 #include <GL/glew.h>
 #include <spdlog/spdlog.h>
 #include <imgui/imgui.h>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
 
 #include "core/graphics.h"
 #include "inputManager.h"
 #include "scene/SceneView.h"
 #include "extra/meshUtilities.h"
+#include "extra/AsyncLoader.h"
+#include "extra/AssetCache.h"
+#include "extra/ProgramPermutations.h"
 #include "GUIRenderer.h"
 #include "core/FrameBuffer.h"
+#include "core/ProgramBinaryCache.h"
 
 static struct Settings
 {
@@ -24,8 +33,76 @@ static void screen_size_callback(GLFWwindow* window, int width, int height)
 
 using namespace BerylEngine;
 
-int main(void)
+// Variants of the basic program used by the last run, compiled at startup
+static const char* BasicProgramUsagePath = "cache/permutations/basic.txt";
+
+// Instancing benchmark, run instead of the main loop with --benchmark-instances
+static constexpr std::array BenchmarkInstanceCounts = { 1000, 10000, 100000 };
+static constexpr int BenchmarkWarmupFrames = 20;
+static constexpr int BenchmarkFrames = 200;
+
+// Draw a square grid of cubes sharing one mesh and material, entirely in view, for each instance count.
+// Logs the CPU time of Scene::render (culling, sorting and submission) and of whole frames, GPU included.
+static void runInstancingBenchmark(GLFWwindow* window, const Material& material, Framebuffer& framebuffer)
 {
+    using Clock = std::chrono::steady_clock;
+
+    // Frames must not wait for the display
+    glfwSwapInterval(0);
+
+    auto mesh = MeshUtilities::staticCube();
+    const float aspectRatio = (float)settings.screen_width / settings.screen_height;
+    for (int count : BenchmarkInstanceCounts)
+    {
+        Scene scene;
+        const int side = int(std::ceil(std::sqrt(float(count))));
+        for (int i = 0; i < count; i++)
+        {
+            const glm::vec3 position(2.0f * (i % side) - side, 2.0f * (i / side) - side, 0.0f);
+            scene.addObject(SceneObject(position, MeshRenderer(mesh, material)));
+        }
+        const Camera camera(glm::vec3(0.0f, 0.0f, 2.0f * side), aspectRatio);
+
+        double submitMs = 0.0;
+        double frameMs = 0.0;
+        for (int frame = 0; frame < BenchmarkWarmupFrames + BenchmarkFrames && !glfwWindowShouldClose(window); frame++)
+        {
+            const Clock::time_point frameStart = Clock::now();
+            framebuffer.bind(true);
+            const Clock::time_point submitStart = Clock::now();
+            scene.render(camera);
+            const Clock::time_point submitEnd = Clock::now();
+            framebuffer.blit(false);
+            glFinish();
+            const Clock::time_point frameEnd = Clock::now();
+
+            if (frame >= BenchmarkWarmupFrames)
+            {
+                submitMs += std::chrono::duration<double, std::milli>(submitEnd - submitStart).count();
+                frameMs += std::chrono::duration<double, std::milli>(frameEnd - frameStart).count();
+            }
+
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+
+        const Scene::RenderStats& stats = scene.stats();
+        spdlog::info("Instancing benchmark: {} instances, {} visible, {} draw commands, {} multi-draws. "
+            "Submit {:.3f} ms, frame {:.3f} ms.", count, stats.visibleObjectCount, stats.drawCommandCount,
+            stats.multiDrawCount, submitMs / BenchmarkFrames, frameMs / BenchmarkFrames);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool benchmarkInstances = false;
+    bool benchmarkPrograms = false;
+    for (int i = 1; i < argc; i++)
+    {
+        benchmarkInstances |= std::strcmp(argv[i], "--benchmark-instances") == 0;
+        benchmarkPrograms |= std::strcmp(argv[i], "--benchmark-programs") == 0;
+    }
+
     spdlog::set_level(spdlog::level::debug);
 
     GLFWwindow* window;
@@ -59,16 +136,41 @@ int main(void)
 
     {
         const float aspectRatio = (float)settings.screen_width / settings.screen_height;
+        AsyncLoader loader(window);
+        AssetCache assets(&loader);
         Scene scene;
         SceneView sceneView(scene, glm::vec3(0.0f, 0.0f, 5.0f), aspectRatio);
         linkCamera(&sceneView.camera());
         glfwSetCursorPosCallback(window, mouse_callback);
         glfwSetFramebufferSizeCallback(window, screen_size_callback);
 
-        std::string defines[] = { "NO_DEFINES" };
-        auto program = Program::fromFiles("shaders/basic.vert", "shaders/basic.frag", defines);
-        //auto albedoTex = Texture::fromFile("uvTestTexture.png", Texture::TextureFormat::RGBA8_UNORM);
-        //auto normalTex = Texture::fromFile("brickwall_normal.jpg", Texture::TextureFormat::RGB8_UNORM);
+        // Debug views replace the whole shading, so the other features do not matter with them
+        ProgramPermutations basicPrograms({ .vertexPath = "shaders/basic.vert", .fragmentPath = "shaders/basic.frag" },
+            { "ALBEDO_TEX", "NORMAL_MAPPED", "SHOW_UV", "SHOW_NORMAL" }, &assets);
+        const ProgramPermutations::Mask debugViews = basicPrograms.feature("SHOW_UV") | basicPrograms.feature("SHOW_NORMAL");
+        basicPrograms.addStripRule(basicPrograms.feature("SHOW_UV"), ~0u);
+        basicPrograms.addStripRule(basicPrograms.feature("SHOW_NORMAL"), ~debugViews);
+
+        // The program benchmark builds every variant, instead of those used by the last run, and waits for them.
+        // Run it once after deleting the binary cache for a cold start, then again for a warm one.
+        const std::chrono::steady_clock::time_point buildStart = std::chrono::steady_clock::now();
+        basicPrograms.prewarm(benchmarkPrograms ? basicPrograms.allMasks() : basicPrograms.loadUsage(BasicProgramUsagePath));
+        if (benchmarkPrograms)
+        {
+            while (!basicPrograms.isBuilt())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            spdlog::info("Program benchmark: {} variants built in {:.1f} ms, binary cache in {}.",
+                basicPrograms.variantCount(), std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - buildStart).count(), ProgramBinaryCache::Directory);
+            Program::logBuildStats();
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+
+        // Materials render with the fallback program until this one is compiled
+        auto program = basicPrograms.get(0);
+        //auto albedoTex = assets.texture("uvTestTexture.png", Texture::TextureFormat::BC7_UNORM);
+        //auto normalTex = assets.texture("brickwall_normal.jpg", Texture::TextureFormat::BC5_UNORM);
         Material material(program);
         //material.setTexture(0, albedoTex);
         //material.setTexture(1, normalTex);
@@ -85,11 +187,29 @@ int main(void)
         Texture depthTexture(settings.screen_width, settings.screen_height, Texture::TextureFormat::Depth32_FLOAT);
         Framebuffer mainFramebuffer(&depthTexture, std::array{&colorTexture});
 
+        if (benchmarkInstances)
+        {
+            runInstancingBenchmark(window, material, mainFramebuffer);
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        }
+
         spdlog::info("Main loop start now");
+        bool buildStatsLogged = false;
         while (!glfwWindowShouldClose(window))
         {
             processInput(window, guiRenderer);
 
+            loader.update();
+
+            // Startup cost of the programs, which the binary cache cuts down on the next run
+            if (!buildStatsLogged && basicPrograms.isBuilt())
+            {
+                spdlog::info("Every program built {:.1f} ms after submission.", std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - buildStart).count());
+                Program::logBuildStats();
+                buildStatsLogged = true;
+            }
+
             mainFramebuffer.bind(true);
 
             sceneView.render();
@@ -103,8 +223,14 @@ int main(void)
 
             glfwPollEvents();
         }
+
+        assets.logStats();
+        // The benchmark requested every variant, not only the used ones
+        if (!benchmarkPrograms)
+            basicPrograms.saveUsage(BasicProgramUsagePath);
     }
 
+    releaseGraphicsAPI();
     glfwTerminate();
 
     spdlog::info("Exiting application now");
@@ -6,7 +6,7 @@ namespace BerylEngine
 {
 	Camera::Camera(const glm::vec3& position, float yaw, float pitch, float aspectRatio)
 	{
-		initialize(buildProjection(0.1f, 60.0f, aspectRatio), position, yaw, pitch);
+		initialize(buildProjection(m_zNear, m_fovY, aspectRatio), position, yaw, pitch);
 	}
 
 	Camera::Camera(const glm::vec3& position, float yaw, float pitch) : Camera(position, yaw, pitch, 16.0f / 9.0f)
@@ -77,6 +77,11 @@ namespace BerylEngine
 		return m_projMatrix;
 	}
 
+	float Camera::nearPlane() const
+	{
+		return m_zNear;
+	}
+
 	glm::vec3 Camera::position() const
 	{
 		glm::vec3 pos(0.0f);
@@ -133,6 +138,6 @@ namespace BerylEngine
 
 	void Camera::onScreenSizeChange(int w, int h)
 	{
-		m_projMatrix = glm::perspective(45.0f, (float)w / (float)h, 0.1f, 100.0f);
+		m_projMatrix = buildProjection(m_zNear, m_fovY, (float)w / (float)h);
 	}
 }
\ No newline at end of file
@@ -17,6 +17,8 @@ namespace BerylEngine
 
 		glm::mat4 m_viewMatrix;
 		glm::mat4 m_projMatrix;
+		float m_zNear = 0.1f;
+		float m_fovY = 60.0f;
 
 		void addPitch(float angle);
 		void addYaw(float angle);
@@ -41,6 +43,7 @@ namespace BerylEngine
 
 		glm::mat4 viewMatrix() const;
 		glm::mat4 projectionMatrix() const;
+		float nearPlane() const;
 
 		void translate(const glm::vec3& translation);
 		void translate(float x, float y, float z);
@@ -0,0 +1,249 @@
+#include "DynamicAABBTree.h"
+
+#include <algorithm>
+
+namespace BerylEngine
+{
+	DynamicAABBTree::DynamicAABBTree(float margin)
+		: m_margin(margin)
+	{
+	}
+
+	DynamicAABBTree::ProxyId DynamicAABBTree::allocateNode()
+	{
+		if (m_freeList == NullProxy)
+		{
+			m_nodes.push_back({});
+			m_freeList = ProxyId(m_nodes.size() - 1);
+			m_nodes[m_freeList].parent = NullProxy;
+		}
+
+		const ProxyId id = m_freeList;
+		Node& node = m_nodes[id];
+		m_freeList = node.parent;
+		node.parent = NullProxy;
+		node.left = NullProxy;
+		node.right = NullProxy;
+		node.height = 0;
+		node.userData = 0;
+		return id;
+	}
+
+	void DynamicAABBTree::freeNode(ProxyId node)
+	{
+		m_nodes[node].parent = m_freeList;
+		m_nodes[node].height = -1;
+		m_freeList = node;
+	}
+
+	DynamicAABBTree::ProxyId DynamicAABBTree::insert(const AABB& box, uint32_t userData)
+	{
+		const ProxyId proxy = allocateNode();
+		m_nodes[proxy].box = { box.min - glm::vec3(m_margin), box.max + glm::vec3(m_margin) };
+		m_nodes[proxy].userData = userData;
+
+		insertLeaf(proxy);
+		m_proxyCount++;
+		return proxy;
+	}
+
+	void DynamicAABBTree::remove(ProxyId proxy)
+	{
+		removeLeaf(proxy);
+		freeNode(proxy);
+		m_proxyCount--;
+	}
+
+	bool DynamicAABBTree::move(ProxyId proxy, const AABB& box)
+	{
+		if (m_nodes[proxy].box.contains(box))
+			return false;
+
+		removeLeaf(proxy);
+		m_nodes[proxy].box = { box.min - glm::vec3(m_margin), box.max + glm::vec3(m_margin) };
+		insertLeaf(proxy);
+		return true;
+	}
+
+	uint32_t DynamicAABBTree::userData(ProxyId proxy) const
+	{
+		return m_nodes[proxy].userData;
+	}
+
+	void DynamicAABBTree::setUserData(ProxyId proxy, uint32_t userData)
+	{
+		m_nodes[proxy].userData = userData;
+	}
+
+	const AABB& DynamicAABBTree::fatBox(ProxyId proxy) const
+	{
+		return m_nodes[proxy].box;
+	}
+
+	size_t DynamicAABBTree::proxyCount() const
+	{
+		return m_proxyCount;
+	}
+
+	int DynamicAABBTree::height() const
+	{
+		return m_root == NullProxy ? 0 : m_nodes[m_root].height;
+	}
+
+	void DynamicAABBTree::insertLeaf(ProxyId leaf)
+	{
+		if (m_root == NullProxy)
+		{
+			m_root = leaf;
+			m_nodes[leaf].parent = NullProxy;
+			return;
+		}
+
+		// Walk down to the sibling that minimizes the surface area added to the tree
+		const AABB leafBox = m_nodes[leaf].box;
+		ProxyId index = m_root;
+		while (!m_nodes[index].isLeaf())
+		{
+			const Node& node = m_nodes[index];
+			const float area = node.box.surfaceArea();
+			const float combinedArea = node.box.merged(leafBox).surfaceArea();
+
+			// Cost of making the leaf a sibling of this node, and cost pushed down to the children
+			const float cost = 2.0f * combinedArea;
+			const float inheritanceCost = 2.0f * (combinedArea - area);
+
+			auto childCost = [&](ProxyId child)
+			{
+				const AABB& childBox = m_nodes[child].box;
+				const float mergedArea = childBox.merged(leafBox).surfaceArea();
+				if (m_nodes[child].isLeaf())
+					return mergedArea + inheritanceCost;
+				return mergedArea - childBox.surfaceArea() + inheritanceCost;
+			};
+
+			const float leftCost = childCost(node.left);
+			const float rightCost = childCost(node.right);
+			if (cost < leftCost && cost < rightCost)
+				break;
+
+			index = leftCost < rightCost ? node.left : node.right;
+		}
+
+		const ProxyId sibling = index;
+		const ProxyId oldParent = m_nodes[sibling].parent;
+		const ProxyId newParent = allocateNode();
+		m_nodes[newParent].parent = oldParent;
+		m_nodes[newParent].box = m_nodes[sibling].box.merged(leafBox);
+		m_nodes[newParent].height = m_nodes[sibling].height + 1;
+		m_nodes[newParent].left = sibling;
+		m_nodes[newParent].right = leaf;
+		m_nodes[sibling].parent = newParent;
+		m_nodes[leaf].parent = newParent;
+
+		if (oldParent == NullProxy)
+			m_root = newParent;
+		else if (m_nodes[oldParent].left == sibling)
+			m_nodes[oldParent].left = newParent;
+		else
+			m_nodes[oldParent].right = newParent;
+
+		refit(m_nodes[leaf].parent);
+	}
+
+	void DynamicAABBTree::removeLeaf(ProxyId leaf)
+	{
+		if (leaf == m_root)
+		{
+			m_root = NullProxy;
+			return;
+		}
+
+		const ProxyId parent = m_nodes[leaf].parent;
+		const ProxyId grandParent = m_nodes[parent].parent;
+		const ProxyId sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+
+		freeNode(parent);
+
+		if (grandParent == NullProxy)
+		{
+			m_root = sibling;
+			m_nodes[sibling].parent = NullProxy;
+			return;
+		}
+
+		if (m_nodes[grandParent].left == parent)
+			m_nodes[grandParent].left = sibling;
+		else
+			m_nodes[grandParent].right = sibling;
+		m_nodes[sibling].parent = grandParent;
+
+		refit(grandParent);
+	}
+
+	void DynamicAABBTree::refit(ProxyId node)
+	{
+		while (node != NullProxy)
+		{
+			node = balance(node);
+
+			Node& current = m_nodes[node];
+			const Node& left = m_nodes[current.left];
+			const Node& right = m_nodes[current.right];
+			current.height = 1 + std::max(left.height, right.height);
+			current.box = left.box.merged(right.box);
+
+			node = current.parent;
+		}
+	}
+
+	// Promote the taller child of an unbalanced node (AVL-like rotation). Return the root of the subtree.
+	DynamicAABBTree::ProxyId DynamicAABBTree::balance(ProxyId a)
+	{
+		Node& nodeA = m_nodes[a];
+		if (nodeA.isLeaf() || nodeA.height < 2)
+			return a;
+
+		const ProxyId b = nodeA.left;
+		const ProxyId c = nodeA.right;
+		const int heightDifference = m_nodes[c].height - m_nodes[b].height;
+		if (heightDifference >= -1 && heightDifference <= 1)
+			return a;
+
+		// Rotate the taller child up, the shorter of its own children goes down to a
+		const bool rotateRight = heightDifference > 1;
+		const ProxyId up = rotateRight ? c : b;
+		const ProxyId stay = rotateRight ? b : c;
+		Node& nodeUp = m_nodes[up];
+		const ProxyId upLeft = nodeUp.left;
+		const ProxyId upRight = nodeUp.right;
+
+		nodeUp.left = a;
+		nodeUp.parent = nodeA.parent;
+		nodeA.parent = up;
+
+		if (nodeUp.parent == NullProxy)
+			m_root = up;
+		else if (m_nodes[nodeUp.parent].left == a)
+			m_nodes[nodeUp.parent].left = up;
+		else
+			m_nodes[nodeUp.parent].right = up;
+
+		const bool keepLeft = m_nodes[upLeft].height > m_nodes[upRight].height;
+		const ProxyId kept = keepLeft ? upLeft : upRight;
+		const ProxyId moved = keepLeft ? upRight : upLeft;
+
+		nodeUp.right = kept;
+		if (rotateRight)
+			nodeA.right = moved;
+		else
+			nodeA.left = moved;
+		m_nodes[moved].parent = a;
+
+		nodeA.box = m_nodes[stay].box.merged(m_nodes[moved].box);
+		nodeA.height = 1 + std::max(m_nodes[stay].height, m_nodes[moved].height);
+		nodeUp.box = nodeA.box.merged(m_nodes[kept].box);
+		nodeUp.height = 1 + std::max(nodeA.height, m_nodes[kept].height);
+
+		return up;
+	}
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "../core/Bounds.h"
+#include "../core/utils.h"
+#include "Frustum.h"
+
+namespace BerylEngine
+{
+	/// <summary>
+	/// Bounding volume hierarchy of fat AABBs, balanced with tree rotations.
+	/// Leaves are enlarged by a margin so that small moves only need a containment check;
+	/// proxies leaving their fat box are removed and reinserted.
+	/// </summary>
+	class DynamicAABBTree : NonCopyable
+	{
+	public:
+		using ProxyId = int32_t;
+		static constexpr ProxyId NullProxy = -1;
+
+		DynamicAABBTree(float margin);
+
+		ProxyId insert(const AABB& box, uint32_t userData);
+		void remove(ProxyId proxy);
+
+		/// <summary>
+		/// Update the box of a proxy. Return true when the proxy had to be reinserted.
+		/// </summary>
+		bool move(ProxyId proxy, const AABB& box);
+
+		uint32_t userData(ProxyId proxy) const;
+		void setUserData(ProxyId proxy, uint32_t userData);
+		const AABB& fatBox(ProxyId proxy) const;
+
+		size_t proxyCount() const;
+		int height() const;
+
+		/// <summary>
+		/// Call callback(userData) for every proxy whose fat box overlaps the box.
+		/// </summary>
+		template<typename F>
+		void query(const AABB& box, F&& callback) const
+		{
+			traverse([&](const AABB& nodeBox) { return box.overlaps(nodeBox); }, callback);
+		}
+
+		/// <summary>
+		/// Call callback(userData) for every proxy whose fat box overlaps the sphere.
+		/// </summary>
+		template<typename F>
+		void query(const BoundingSphere& sphere, F&& callback) const
+		{
+			traverse([&](const AABB& nodeBox)
+				{
+					const glm::vec3 offset = glm::clamp(sphere.center, nodeBox.min, nodeBox.max) - sphere.center;
+					return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+				}, callback);
+		}
+
+		/// <summary>
+		/// Call callback(userData, inside) for every proxy whose fat box intersects the frustum.
+		/// inside is true when the fat box is entirely in the frustum, so the proxy needs no further test.
+		/// Subtrees entirely in the frustum are reported without testing their nodes.
+		/// </summary>
+		template<typename F>
+		void query(const Frustum& frustum, F&& callback) const
+		{
+			if (m_root == NullProxy)
+				return;
+
+			std::vector<std::pair<ProxyId, bool>> stack;
+			stack.reserve(64);
+			stack.emplace_back(m_root, false);
+			while (!stack.empty())
+			{
+				auto [id, inside] = stack.back();
+				stack.pop_back();
+
+				const Node& node = m_nodes[id];
+				if (!inside)
+				{
+					const Frustum::Containment containment = frustum.classify(node.box);
+					if (containment == Frustum::Containment::Outside)
+						continue;
+					inside = containment == Frustum::Containment::Inside;
+				}
+
+				if (node.isLeaf())
+				{
+					callback(node.userData, inside);
+				}
+				else
+				{
+					stack.emplace_back(node.left, inside);
+					stack.emplace_back(node.right, inside);
+				}
+			}
+		}
+
+	private:
+		struct Node
+		{
+			AABB box;
+			ProxyId parent; // Next free node when the node is in the free list
+			ProxyId left;
+			ProxyId right;
+			int height; // Leaves are 0, free nodes -1
+			uint32_t userData;
+
+			bool isLeaf() const { return left == NullProxy; }
+		};
+
+		float m_margin;
+		std::vector<Node> m_nodes;
+		ProxyId m_root = NullProxy;
+		ProxyId m_freeList = NullProxy;
+		size_t m_proxyCount = 0;
+
+		ProxyId allocateNode();
+		void freeNode(ProxyId node);
+
+		void insertLeaf(ProxyId leaf);
+		void removeLeaf(ProxyId leaf);
+		ProxyId balance(ProxyId node);
+		void refit(ProxyId node);
+
+		template<typename Test, typename F>
+		void traverse(Test&& test, F& callback) const
+		{
+			if (m_root == NullProxy)
+				return;
+
+			std::vector<ProxyId> stack;
+			stack.reserve(64);
+			stack.push_back(m_root);
+			while (!stack.empty())
+			{
+				const Node& node = m_nodes[stack.back()];
+				stack.pop_back();
+
+				if (!test(node.box))
+					continue;
+
+				if (node.isLeaf())
+				{
+					callback(node.userData);
+				}
+				else
+				{
+					stack.push_back(node.left);
+					stack.push_back(node.right);
+				}
+			}
+		}
+	};
+}
@@ -0,0 +1,141 @@
+#include "Frustum.h"
+
+#include <glm/ext.hpp>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BERYL_FRUSTUM_SSE
+#include <emmintrin.h>
+#endif
+
+namespace BerylEngine
+{
+	Frustum::Frustum(const glm::mat4& viewProjection)
+	{
+		const glm::vec4 r0 = glm::row(viewProjection, 0);
+		const glm::vec4 r1 = glm::row(viewProjection, 1);
+		const glm::vec4 r2 = glm::row(viewProjection, 2);
+		const glm::vec4 r3 = glm::row(viewProjection, 3);
+
+		const glm::vec4 planes[] = { r3 + r0, r3 - r0, r3 + r1, r3 - r1, r2, r3 - r2 };
+		for (const glm::vec4& plane : planes)
+		{
+			const float length = glm::length(glm::vec3(plane));
+			if (length > 1e-6f)
+				m_planes[m_planeCount++] = plane / length;
+		}
+	}
+
+	bool Frustum::intersects(const BoundingSphere& sphere) const
+	{
+		for (size_t i = 0; i < m_planeCount; i++)
+		{
+			if (glm::dot(glm::vec3(m_planes[i]), sphere.center) + m_planes[i].w < -sphere.radius)
+				return false;
+		}
+
+		return true;
+	}
+
+	bool Frustum::intersects(const AABB& box) const
+	{
+		const glm::vec3 center = box.center();
+		const glm::vec3 extents = box.extents();
+		for (size_t i = 0; i < m_planeCount; i++)
+		{
+			const glm::vec3 normal = glm::vec3(m_planes[i]);
+			const float radius = glm::dot(extents, glm::abs(normal));
+			if (glm::dot(normal, center) + m_planes[i].w < -radius)
+				return false;
+		}
+
+		return true;
+	}
+
+	Frustum::Containment Frustum::classify(const AABB& box) const
+	{
+		const glm::vec3 center = box.center();
+		const glm::vec3 extents = box.extents();
+		Containment containment = Containment::Inside;
+		for (size_t i = 0; i < m_planeCount; i++)
+		{
+			const glm::vec3 normal = glm::vec3(m_planes[i]);
+			const float radius = glm::dot(extents, glm::abs(normal));
+			const float distance = glm::dot(normal, center) + m_planes[i].w;
+			if (distance < -radius)
+				return Containment::Outside;
+			if (distance < radius)
+				containment = Containment::Intersecting;
+		}
+
+		return containment;
+	}
+
+	size_t Frustum::cullSpheres(const float* x, const float* y, const float* z, const float* radius, size_t count,
+								uint32_t* visible) const
+	{
+		size_t visibleCount = 0;
+		size_t i = 0;
+
+#if defined(__AVX__)
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256 cx = _mm256_loadu_ps(x + i);
+			const __m256 cy = _mm256_loadu_ps(y + i);
+			const __m256 cz = _mm256_loadu_ps(z + i);
+			const __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radius + i));
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (size_t p = 0; p < m_planeCount; p++)
+			{
+				const glm::vec4& plane = m_planes[p];
+				__m256 distance = _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)), _mm256_set1_ps(plane.w));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(cy, _mm256_set1_ps(plane.y)));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(cz, _mm256_set1_ps(plane.z)));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+			}
+
+			const int mask = _mm256_movemask_ps(inside);
+			for (int lane = 0; lane < 8; lane++)
+			{
+				if (mask & (1 << lane))
+					visible[visibleCount++] = uint32_t(i + lane);
+			}
+		}
+#elif defined(BERYL_FRUSTUM_SSE)
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128 cx = _mm_loadu_ps(x + i);
+			const __m128 cy = _mm_loadu_ps(y + i);
+			const __m128 cz = _mm_loadu_ps(z + i);
+			const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (size_t p = 0; p < m_planeCount; p++)
+			{
+				const glm::vec4& plane = m_planes[p];
+				__m128 distance = _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+				distance = _mm_add_ps(distance, _mm_mul_ps(cy, _mm_set1_ps(plane.y)));
+				distance = _mm_add_ps(distance, _mm_mul_ps(cz, _mm_set1_ps(plane.z)));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+			}
+
+			const int mask = _mm_movemask_ps(inside);
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if (mask & (1 << lane))
+					visible[visibleCount++] = uint32_t(i + lane);
+			}
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			if (intersects(BoundingSphere{ { x[i], y[i], z[i] }, radius[i] }))
+				visible[visibleCount++] = uint32_t(i);
+		}
+
+		return visibleCount;
+	}
+}
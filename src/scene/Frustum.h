@@ -0,0 +1,44 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "../core/Bounds.h"
+
+namespace BerylEngine
+{
+	/// <summary>
+	/// View frustum planes, extracted from a view-projection matrix using 0..1 clip depth.
+	/// Planes with no normal (the far plane of infinite reverse-Z projections) are dropped.
+	/// </summary>
+	class Frustum
+	{
+	public:
+		enum class Containment
+		{
+			Outside,
+			Intersecting,
+			Inside
+		};
+
+		Frustum(const glm::mat4& viewProjection);
+
+		bool intersects(const BoundingSphere& sphere) const;
+		bool intersects(const AABB& box) const;
+		Containment classify(const AABB& box) const;
+
+		/// <summary>
+		/// Test spheres stored as structure of arrays, several at a time with SSE or AVX.
+		/// Indices of the visible spheres are written to visible, which must hold count elements.
+		/// Return the number of visible spheres.
+		/// </summary>
+		size_t cullSpheres(const float* x, const float* y, const float* z, const float* radius, size_t count,
+							uint32_t* visible) const;
+
+	private:
+		// Normalized planes, inside is dot(normal, p) + w >= 0
+		std::array<glm::vec4, 6> m_planes;
+		size_t m_planeCount = 0;
+	};
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace BerylEngine
+{
+	/// <summary>
+	/// Values shared by the objects of a scene, each stored once under a small id that fits in a sort key field.
+	/// Ids are reference counted, one reference per object, and the slots of released values are reused, so ids
+	/// stay below the peak number of distinct values alive at once.
+	/// </summary>
+	template <typename T>
+	class IdTable
+	{
+	private:
+		struct Slot
+		{
+			std::optional<T> value; // Empty when free, so that released values free their resources
+			uint32_t references = 0;
+		};
+
+		std::vector<Slot> m_slots;
+		std::vector<uint32_t> m_freeIds;
+
+	public:
+		/// <summary>
+		/// Id of a value equal to value, added if there is none. Takes a reference to it.
+		/// </summary>
+		uint32_t acquire(const T& value)
+		{
+			for (uint32_t id = 0; id < m_slots.size(); id++)
+			{
+				if (m_slots[id].references > 0 && *m_slots[id].value == value)
+				{
+					m_slots[id].references++;
+					return id;
+				}
+			}
+
+			uint32_t id;
+			if (m_freeIds.empty())
+			{
+				id = uint32_t(m_slots.size());
+				m_slots.emplace_back();
+			}
+			else
+			{
+				id = m_freeIds.back();
+				m_freeIds.pop_back();
+			}
+
+			m_slots[id].value.emplace(value);
+			m_slots[id].references = 1;
+			return id;
+		}
+
+		/// <summary>
+		/// Drop a reference taken by acquire(). The value is destroyed with its last reference.
+		/// </summary>
+		void release(uint32_t id)
+		{
+			if (--m_slots[id].references > 0)
+				return;
+
+			m_slots[id].value.reset();
+			m_freeIds.push_back(id);
+		}
+
+		const T& operator[](uint32_t id) const
+		{
+			return *m_slots[id].value;
+		}
+
+		/// <summary>
+		/// Number of distinct values alive.
+		/// </summary>
+		size_t size() const
+		{
+			return m_slots.size() - m_freeIds.size();
+		}
+	};
+}
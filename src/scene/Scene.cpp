@@ -1,58 +1,505 @@
 #include "Scene.h"
 
-#include "../core/TypedBuffer.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+
+#include "Frustum.h"
 #include "shaderDefs.h"
+#include "../core/RadixSort.h"
+#include "../core/RenderState.h"
 
 namespace BerylEngine
 {
+	// Fat box margin of the hierarchies, in world units
+	static constexpr float TreeMargin = 0.25f;
+
+	// Depth at which the exponential cluster slices end. The last slice extends to infinity.
+	static constexpr float ClusterFarPlane = 500.0f;
+
+	// Largest on-screen error of a level of detail, in pixels, and the margin around it before switching
+	static constexpr float LodErrorThreshold = 1.0f;
+	static constexpr float LodHysteresis = 0.25f;
+
+	static constexpr std::array<glm::uint, RingBuffer::FramesInFlight> NoOverflows = {};
+
+	Scene::Scene()
+		: m_objectTree(TreeMargin),
+		m_lightTree(TreeMargin),
+		m_frameData(64 * 1024),
+		m_clusterLightCounts(nullptr, ShaderDefs::CLUSTER_COUNT * sizeof(glm::uint), BufferStorage::None),
+		m_clusterLightIndices(nullptr,
+			ShaderDefs::CLUSTER_COUNT * ShaderDefs::MAX_LIGHTS_PER_CLUSTER * sizeof(glm::uint), BufferStorage::None),
+		m_clusterOverflowCounts(NoOverflows.data(), sizeof(NoOverflows),
+			BufferStorage::MapRead | BufferStorage::MapWrite | BufferStorage::Persistent | BufferStorage::Coherent)
+	{
+		m_lightCullProgram = Program::fromFiles("shaders/clusterLights.comp");
+		m_overflowSlotUniform = m_lightCullProgram->uniform<int>("overflowSlot");
+	}
+
+	static AABB sphereBox(const BoundingSphere& sphere)
+	{
+		return { sphere.center - glm::vec3(sphere.radius), sphere.center + glm::vec3(sphere.radius) };
+	}
+
 	size_t Scene::addObject(const SceneObject& object)
 	{
+		DrawIds ids;
+		ids.material = m_materials.acquire(object.renderer().material());
+		ids.program = m_programs.acquire(m_materials[ids.material].program().get());
+		ids.mesh = m_meshes.acquire(object.renderer().mesh().get());
+		ids.arena = uint32_t(object.renderer().mesh()->indexType());
+
+		const size_t index = m_objects.size();
+		const bool ready = object.renderer().mesh()->isReady();
+		const Bounds bounds = object.renderer().mesh()->bounds().transformed(object.transform().getMatrix());
+
 		m_objects.push_back(object);
-		return m_objects.size() - 1;
+		m_objectIds.push_back(ids);
+		m_boundsVersions.push_back(object.transform().version());
+		m_objectLods.push_back(0);
+		m_worldBounds.push_back(bounds);
+		m_objectData.emplace_back();
+		m_objectProxies.push_back(ready ? m_objectTree.insert(bounds.box, uint32_t(index)) : DynamicAABBTree::NullProxy);
+		if (ready)
+			updateObjectData(index);
+		else
+			m_pendingObjects.push_back(index);
+
+		return index;
 	}
 
 	void Scene::removeObject(size_t index)
 	{
+		updateWorldBounds();
+
+		if (m_objectProxies[index] != DynamicAABBTree::NullProxy)
+			m_objectTree.remove(m_objectProxies[index]);
+		for (size_t i = index + 1; i < m_objectProxies.size(); i++)
+		{
+			if (m_objectProxies[i] != DynamicAABBTree::NullProxy)
+				m_objectTree.setUserData(m_objectProxies[i], uint32_t(i - 1));
+		}
+
+		std::erase(m_pendingObjects, index);
+		for (size_t& pending : m_pendingObjects)
+		{
+			if (pending > index)
+				pending--;
+		}
+
+		const DrawIds& ids = m_objectIds[index];
+		m_programs.release(ids.program);
+		m_materials.release(ids.material);
+		m_meshes.release(ids.mesh);
+
 		m_objects.erase(m_objects.begin() + index);
+		m_objectIds.erase(m_objectIds.begin() + index);
+		m_objectProxies.erase(m_objectProxies.begin() + index);
+		m_boundsVersions.erase(m_boundsVersions.begin() + index);
+		m_objectLods.erase(m_objectLods.begin() + index);
+		m_worldBounds.erase(m_worldBounds.begin() + index);
+		m_objectData.erase(m_objectData.begin() + index);
+	}
+
+	SceneObject& Scene::object(size_t index)
+	{
+		return m_objects[index];
+	}
+
+	const SceneObject& Scene::object(size_t index) const
+	{
+		return m_objects[index];
 	}
 
 	size_t Scene::addLight(const PointLight& light)
 	{
+		const size_t index = m_lights.size();
+		const BoundingSphere bounds = { light.position(), light.radius() };
+
 		m_lights.push_back(light);
-		return m_lights.size() - 1;
+		m_lightBounds.push_back(bounds);
+		m_lightProxies.push_back(m_lightTree.insert(sphereBox(bounds), uint32_t(index)));
+
+		return index;
 	}
 
 	void Scene::removeLight(size_t index)
 	{
+		updateWorldBounds();
+
+		m_lightTree.remove(m_lightProxies[index]);
+		for (size_t i = index + 1; i < m_lightProxies.size(); i++)
+			m_lightTree.setUserData(m_lightProxies[i], uint32_t(i - 1));
+
 		m_lights.erase(m_lights.begin() + index);
+		m_lightBounds.erase(m_lightBounds.begin() + index);
+		m_lightProxies.erase(m_lightProxies.begin() + index);
+	}
+
+	PointLight& Scene::light(size_t index)
+	{
+		m_movedLights.push_back(index);
+		return m_lights[index];
+	}
+
+	const PointLight& Scene::light(size_t index) const
+	{
+		return m_lights[index];
+	}
+
+	void Scene::updateWorldBounds() const
+	{
+		// Objects enter the hierarchy once their mesh is loaded, with its bounds and arena
+		std::erase_if(m_pendingObjects, [&](size_t i)
+			{
+				const StaticMesh& mesh = *m_objects[i].renderer().mesh();
+				if (!mesh.isReady())
+					return false;
+
+				const Transform& transform = m_objects[i].transform();
+				m_objectIds[i].arena = uint32_t(mesh.indexType());
+				m_worldBounds[i] = mesh.bounds().transformed(transform.getMatrix());
+				m_boundsVersions[i] = transform.version();
+				m_objectProxies[i] = m_objectTree.insert(m_worldBounds[i].box, uint32_t(i));
+				updateObjectData(i);
+				return true;
+			});
+
+		// References to objects may be kept across frames, so every version is compared instead of tracking
+		// mutable accesses
+		for (size_t i = 0; i < m_objects.size(); i++)
+		{
+			const Transform& transform = m_objects[i].transform();
+			if (m_boundsVersions[i] == transform.version() || m_objectProxies[i] == DynamicAABBTree::NullProxy)
+				continue;
+
+			m_worldBounds[i] = m_objects[i].renderer().mesh()->bounds().transformed(transform.getMatrix());
+			m_boundsVersions[i] = transform.version();
+			m_objectTree.move(m_objectProxies[i], m_worldBounds[i].box);
+			updateObjectData(i);
+		}
+
+		for (size_t i : m_movedLights)
+		{
+			const BoundingSphere bounds = { m_lights[i].position(), m_lights[i].radius() };
+			if (bounds.center == m_lightBounds[i].center && bounds.radius == m_lightBounds[i].radius)
+				continue;
+
+			m_lightBounds[i] = bounds;
+			m_lightTree.move(m_lightProxies[i], sphereBox(bounds));
+		}
+		m_movedLights.clear();
+	}
+
+	void Scene::updateObjectData(size_t index) const
+	{
+		const Transform& transform = m_objects[index].transform();
+		const glm::mat4& model = transform.getMatrix();
+		const StaticMesh& mesh = *m_objects[index].renderer().mesh();
+
+		ShaderDefs::ObjectData& data = m_objectData[index];
+		data.modelMatrix = model;
+		data.normalMatrix = glm::mat3x4(glm::transpose(glm::inverse(glm::mat3(model))));
+		data.positionOffset = mesh.bounds().box.center();
+		data.materialIndex = m_objectIds[index].material;
+		data.positionScale = mesh.bounds().box.extents();
+	}
+
+	void Scene::queryObjects(const AABB& box, std::vector<size_t>& objects) const
+	{
+		updateWorldBounds();
+		m_objectTree.query(box, [&](uint32_t object) { objects.push_back(object); });
+	}
+
+	void Scene::queryObjects(const BoundingSphere& sphere, std::vector<size_t>& objects) const
+	{
+		updateWorldBounds();
+		m_objectTree.query(sphere, [&](uint32_t object) { objects.push_back(object); });
+	}
+
+	void Scene::queryLights(const AABB& box, std::vector<size_t>& lights) const
+	{
+		updateWorldBounds();
+		m_lightTree.query(box, [&](uint32_t light) { lights.push_back(light); });
+	}
+
+	void Scene::queryLights(const BoundingSphere& sphere, std::vector<size_t>& lights) const
+	{
+		updateWorldBounds();
+		m_lightTree.query(sphere, [&](uint32_t light) { lights.push_back(light); });
+	}
+
+	size_t Scene::cullObjects(const Frustum& frustum) const
+	{
+		// Objects in nodes entirely inside the frustum are visible, the others are tested individually
+		m_visibleObjects.clear();
+		m_cullCandidates.clear();
+		m_objectTree.query(frustum, [&](uint32_t object, bool inside)
+			{
+				if (inside)
+					m_visibleObjects.push_back(object);
+				else
+					m_cullCandidates.push_back(object);
+			});
+
+		const size_t candidateCount = m_cullCandidates.size();
+		m_sphereX.resize(candidateCount);
+		m_sphereY.resize(candidateCount);
+		m_sphereZ.resize(candidateCount);
+		m_sphereRadius.resize(candidateCount);
+		m_visibleCandidates.resize(candidateCount);
+		for (size_t i = 0; i < candidateCount; i++)
+		{
+			const BoundingSphere& sphere = m_worldBounds[m_cullCandidates[i]].sphere;
+			m_sphereX[i] = sphere.center.x;
+			m_sphereY[i] = sphere.center.y;
+			m_sphereZ[i] = sphere.center.z;
+			m_sphereRadius[i] = sphere.radius;
+		}
+
+		const size_t visibleCandidateCount = frustum.cullSpheres(m_sphereX.data(), m_sphereY.data(),
+			m_sphereZ.data(), m_sphereRadius.data(), candidateCount, m_visibleCandidates.data());
+		for (size_t i = 0; i < visibleCandidateCount; i++)
+			m_visibleObjects.push_back(m_cullCandidates[m_visibleCandidates[i]]);
+
+		return m_visibleObjects.size();
+	}
+
+	// Sort key layouts, from the most significant bit:
+	// - opaque:      queue (1) | arena (1) | program (10) | material (14) | mesh (12) | lod (3) | depth, front to back (23)
+	// - transparent: queue (1) | depth, back to front (23) | arena (1) | program (10) | material (14) | mesh (12) | lod (3)
+	// Opaque draws minimize state changes and keep instances of a mesh together, transparent draws
+	// must be blended in order. Ids wider than their field only make sorting less effective.
+	static constexpr int ArenaBits = 1;
+	static constexpr int ProgramBits = 10;
+	static constexpr int MaterialBits = 14;
+	static constexpr int MeshBits = 12;
+	static constexpr int LodBits = 3;
+	static constexpr int DepthBits = 23;
+
+	static constexpr uint64_t field(uint64_t value, int bits, int shift)
+	{
+		return (value & ((uint64_t(1) << bits) - 1)) << shift;
+	}
+
+	// Non-negative floats compare like their bit patterns, the top bits are a coarse but monotonic depth.
+	static uint32_t quantizeDepth(float depth)
+	{
+		return std::bit_cast<uint32_t>(std::max(depth, 0.0f)) >> (31 - DepthBits);
+	}
+
+	static_assert(1 + ArenaBits + ProgramBits + MaterialBits + MeshBits + LodBits + DepthBits == 64);
+	static_assert(StaticMesh::MaxLods <= (1 << LodBits));
+
+	uint64_t Scene::sortKey(const DrawIds& ids, uint32_t lod, bool transparent, float depth) const
+	{
+		const uint64_t depthBits = quantizeDepth(depth);
+
+		if (!transparent)
+		{
+			return field(ids.arena, ArenaBits, ProgramBits + MaterialBits + MeshBits + LodBits + DepthBits)
+				| field(ids.program, ProgramBits, MaterialBits + MeshBits + LodBits + DepthBits)
+				| field(ids.material, MaterialBits, MeshBits + LodBits + DepthBits)
+				| field(ids.mesh, MeshBits, LodBits + DepthBits)
+				| field(lod, LodBits, DepthBits)
+				| field(depthBits, DepthBits, 0);
+		}
+
+		return (uint64_t(1) << 63)
+			| field(~depthBits, DepthBits, ArenaBits + ProgramBits + MaterialBits + MeshBits + LodBits)
+			| field(ids.arena, ArenaBits, ProgramBits + MaterialBits + MeshBits + LodBits)
+			| field(ids.program, ProgramBits, MaterialBits + MeshBits + LodBits)
+			| field(ids.material, MaterialBits, MeshBits + LodBits)
+			| field(ids.mesh, MeshBits, LodBits)
+			| field(lod, LodBits, 0);
+	}
+
+	// Pick the coarsest level whose error projects to at most LodErrorThreshold pixels. Switching to a coarser
+	// level needs a margin below the threshold and switching back a margin above it, so that objects around
+	// a switching distance do not alternate between levels.
+	static uint32_t selectLod(const std::vector<StaticMesh::Lod>& lods, float pixelsPerUnit, uint32_t current)
+	{
+		current = std::min(current, uint32_t(lods.size() - 1));
+
+		uint32_t coarser = current;
+		while (coarser + 1 < lods.size()
+			&& lods[coarser + 1].error * pixelsPerUnit <= LodErrorThreshold * (1.0f - LodHysteresis))
+			coarser++;
+		if (coarser != current)
+			return coarser;
+
+		uint32_t finer = current;
+		while (finer > 0 && lods[finer].error * pixelsPerUnit > LodErrorThreshold * (1.0f + LodHysteresis))
+			finer--;
+		return finer;
 	}
 
 	void Scene::render(const Camera& camera) const
 	{
+		const RenderState::Counters countersBefore = RenderState::counters();
+
+		updateWorldBounds();
+
+		const Frustum frustum(camera.projectionMatrix() * camera.viewMatrix());
+		const size_t visibleCount = cullObjects(frustum);
+
+		// Lights that cannot touch anything on screen are not sent to the GPU
+		m_visibleLights.clear();
+		m_lightTree.query(frustum, [&](uint32_t index, bool inside)
+			{
+				if (!inside && !frustum.intersects(m_lightBounds[index]))
+					return;
+
+				const PointLight& light = m_lights[index];
+				ShaderDefs::PointLight mappedLight;
+				mappedLight.position = camera.viewMatrix() * glm::vec4(light.position(), 1.0f);
+				mappedLight.radius = light.radius();
+				mappedLight.color = light.color();
+				light.coefficients(mappedLight.linear, mappedLight.quadratic);
+				m_visibleLights.push_back(mappedLight);
+			});
+
 		ShaderDefs::FrameContext context;
 		context.camera.viewMatrix = camera.viewMatrix();
 		context.camera.projectionMatrix = camera.projectionMatrix();
 		context.sunDirection = glm::normalize(glm::mat3(camera.viewMatrix()) * glm::normalize(glm::vec3(0.8f, 0.1f, 0.3f)));
 		context.sunColor = glm::vec3(0.6f, 0.6f, 0.6f);
-		context.lightCount = glm::uint(m_lights.size());
+		context.lightCount = glm::uint(m_visibleLights.size());
+
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		context.screenSize = glm::vec2(viewport[2], viewport[3]);
+		context.clusterNear = camera.nearPlane();
+		context.clusterFar = ClusterFarPlane;
+
+		const size_t frameSize = sizeof(ShaderDefs::FrameContext)
+			+ std::max<size_t>(m_visibleLights.size(), 1) * sizeof(ShaderDefs::PointLight)
+			+ std::max<size_t>(visibleCount, 1) * sizeof(ShaderDefs::ObjectData)
+			+ std::max<size_t>(visibleCount, 1) * sizeof(DrawElementsIndirectCommand)
+			+ 4 * m_frameData.maxAlignment();
+		m_frameData.beginFrame(frameSize);
 
-		TypedBuffer<ShaderDefs::FrameContext> contextBuffer(&context, 1);
-		contextBuffer.bind<BufferUsageType::UniformBuffer>(0);
+		auto contextRange = m_frameData.write<BufferUsageType::UniformBuffer>(&context, 1);
+		m_frameData.bindRange<BufferUsageType::UniformBuffer>(0, contextRange);
 
-		std::vector<ShaderDefs::PointLight> mappedLights;
-		for (const auto& light : m_lights)
+		auto lightRange = m_frameData.write<BufferUsageType::ShaderStorage>(m_visibleLights.data(),
+			m_visibleLights.size());
+		m_frameData.bindRange<BufferUsageType::ShaderStorage>(1, lightRange);
+
+		// Slots follow the ring buffer regions, so beginFrame() waited for the frame that last used this one
+		const int overflowSlot = int(m_frameCount++ % RingBuffer::FramesInFlight);
+		glm::uint* overflowCounts = static_cast<glm::uint*>(m_clusterOverflowCounts.persistentData());
+		const size_t overflowingClusters = overflowCounts[overflowSlot];
+		overflowCounts[overflowSlot] = 0;
+
+		m_clusterLightCounts.bind<BufferUsageType::ShaderStorage>(3);
+		m_clusterLightIndices.bind<BufferUsageType::ShaderStorage>(4);
+		m_clusterOverflowCounts.bind<BufferUsageType::ShaderStorage>(5);
+		m_lightCullProgram->bind();
+		m_lightCullProgram->setUniform(m_overflowSlotUniform, overflowSlot);
+		glDispatchCompute((ShaderDefs::CLUSTER_COUNT + ShaderDefs::CLUSTER_CULL_GROUP_SIZE - 1)
+			/ ShaderDefs::CLUSTER_CULL_GROUP_SIZE, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
+
+		// Object space units to pixels at unit distance, from the vertical field of view
+		const float pixelsPerUnitAtUnitDistance = camera.projectionMatrix()[1][1] * context.screenSize.y * 0.5f;
+
+		m_sortKeys.resize(visibleCount);
+		m_sortedObjects.resize(visibleCount);
+		for (size_t i = 0; i < visibleCount; i++)
 		{
-			ShaderDefs::PointLight mappedLight;
-			mappedLight.position = camera.viewMatrix() * glm::vec4(light.position(), 1.0f);
-			mappedLight.radius = light.radius();
-			mappedLight.color = light.color();
-			light.coefficients(mappedLight.linear, mappedLight.quadratic);
-			mappedLights.push_back(mappedLight);
+			const uint32_t object = m_visibleObjects[i];
+			const DrawIds& ids = m_objectIds[object];
+			const bool transparent = m_materials[ids.material].blendMode() == Material::BlendMode::Alpha;
+			const BoundingSphere& sphere = m_worldBounds[object].sphere;
+			const glm::vec3 viewCenter = camera.viewMatrix() * glm::vec4(sphere.center, 1.0f);
+			const float depth = -viewCenter.z;
+
+			// Projected size of the bounding sphere, relative to the mesh's own bounding sphere
+			const StaticMesh& mesh = *m_meshes[ids.mesh];
+			const float distance = std::max(glm::length(viewCenter) - sphere.radius, camera.nearPlane());
+			const float projectedRadius = sphere.radius * pixelsPerUnitAtUnitDistance / distance;
+			const float pixelsPerUnit = mesh.bounds().sphere.radius > 0.0f
+				? projectedRadius / mesh.bounds().sphere.radius / m_objects[object].renderer().lodBias() : 0.0f;
+			m_objectLods[object] = uint8_t(selectLod(mesh.lods(), pixelsPerUnit, m_objectLods[object]));
+
+			m_sortKeys[i] = sortKey(ids, m_objectLods[object], transparent, depth);
+			m_sortedObjects[i] = object;
 		}
-		TypedBuffer<ShaderDefs::PointLight> lightBuffer(mappedLights.data(), mappedLights.size());
-		lightBuffer.bind<BufferUsageType::ShaderStorage>(1);
+		radixSort(m_sortKeys, m_sortedObjects, m_sortKeyScratch, m_sortObjectScratch);
 
-		for (const auto& obj : m_objects)
-			obj.draw();
+		// Consecutive draws of the same mesh and level of detail with the same material become a single instanced command.
+		// Instances are written contiguously so that the vertex shader finds them at gl_BaseInstanceARB + gl_InstanceID.
+		RingBuffer::Range objectRange;
+		RingBuffer::Range commandRange;
+		auto objectData = m_frameData.allocate<BufferUsageType::ShaderStorage, ShaderDefs::ObjectData>(
+			visibleCount, &objectRange);
+		auto commands = m_frameData.allocate<BufferUsageType::DrawIndirect, DrawElementsIndirectCommand>(
+			visibleCount, &commandRange);
+
+		m_stats = { m_objects.size(), visibleCount, m_visibleLights.size(), 0, 0, 0, 0, 0, overflowingClusters };
+		m_commandIds.clear();
+		for (size_t slot = 0; slot < visibleCount; slot++)
+		{
+			const size_t object = m_sortedObjects[slot];
+			const DrawIds& ids = m_objectIds[object];
+			const StaticMesh& mesh = *m_meshes[ids.mesh];
+			const StaticMesh::Lod& lod = mesh.lods()[m_objectLods[object]];
+			objectData[slot] = m_objectData[object];
+
+			if (slot > 0)
+			{
+				const DrawIds& previous = m_objectIds[m_sortedObjects[slot - 1]];
+				if (previous.material == ids.material && previous.mesh == ids.mesh
+					&& m_objectLods[m_sortedObjects[slot - 1]] == m_objectLods[object])
+				{
+					commands[m_commandIds.size() - 1].instanceCount++;
+					m_stats.triangleCount += lod.indexCount / 3;
+					continue;
+				}
+			}
+
+			const GeometryArena::Range& meshRange = mesh.range();
+			commands[m_commandIds.size()] = { lod.indexCount, 1, meshRange.firstIndex + lod.firstIndex,
+				int(meshRange.baseVertex), (unsigned int)slot };
+			m_stats.triangleCount += lod.indexCount / 3;
+			m_commandIds.push_back(ids);
+		}
+
+		m_frameData.bindRange<BufferUsageType::ShaderStorage>(2, objectRange);
+		m_frameData.bind(BufferUsageType::DrawIndirect);
+
+		m_stats.drawCommandCount = m_commandIds.size();
+
+		// Commands are in sort order, consecutive commands sharing a material and an arena are submitted together
+		size_t first = 0;
+		while (first < m_commandIds.size())
+		{
+			const DrawIds& ids = m_commandIds[first];
+			size_t last = first + 1;
+			while (last < m_commandIds.size() && m_commandIds[last].material == ids.material
+				&& m_commandIds[last].arena == ids.arena)
+				last++;
+
+			const GeometryArena& arena = StaticMesh::arena(GeometryArena::IndexType(ids.arena));
+			arena.bind();
+			m_materials[ids.material].bind();
+			glMultiDrawElementsIndirect(GL_TRIANGLES, arena.glIndexType(),
+				(void*)(commandRange.offset + first * sizeof(DrawElementsIndirectCommand)), GLsizei(last - first), 0);
+			m_stats.multiDrawCount++;
+
+			first = last;
+		}
+
+		m_frameData.endFrame();
+
+		m_stats.stateChangesEmitted = RenderState::counters().emitted - countersBefore.emitted;
+		m_stats.stateChangesSkipped = RenderState::counters().skipped - countersBefore.skipped;
+	}
+
+	const Scene::RenderStats& Scene::stats() const
+	{
+		return m_stats;
 	}
 }
\ No newline at end of file
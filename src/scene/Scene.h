@@ -1,26 +1,152 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
+#include "../core/Bounds.h"
+#include "../core/RingBuffer.h"
 #include "Camera.h"
+#include "DynamicAABBTree.h"
+#include "IdTable.h"
 #include "PointLight.h"
 #include "SceneObject.h"
+#include "shaderDefs.h"
 
 namespace BerylEngine
 {
 	class Scene
 	{
 	public:
+		struct RenderStats
+		{
+			size_t objectCount;
+			size_t visibleObjectCount;
+			size_t visibleLightCount;
+			size_t drawCommandCount;
+			size_t multiDrawCount;
+			size_t stateChangesEmitted;
+			size_t stateChangesSkipped;
+			size_t triangleCount;
+			// Clusters that touched more than MAX_LIGHTS_PER_CLUSTER lights and dropped the rest. Read back
+			// without stalling, so it lags a few frames behind.
+			size_t overflowingClusters;
+		};
+
+		Scene();
+
 		size_t addObject(const SceneObject& object);
 		void removeObject(size_t index);
 
+		/// <summary>
+		/// Transform changes, through this reference or one kept across frames, update the object's bounds and
+		/// shader data before the next render or query.
+		/// </summary>
+		SceneObject& object(size_t index);
+		const SceneObject& object(size_t index) const;
+
 		size_t addLight(const PointLight& light);
 		void removeLight(size_t index);
 
+		/// <summary>
+		/// Mutable access marks the light as moved. Its bounds are updated before the next render or query.
+		/// </summary>
+		PointLight& light(size_t index);
+		const PointLight& light(size_t index) const;
+
+		/// <summary>
+		/// Append the indices of the objects whose bounds may overlap the volume. Results are conservative.
+		/// </summary>
+		void queryObjects(const AABB& box, std::vector<size_t>& objects) const;
+		void queryObjects(const BoundingSphere& sphere, std::vector<size_t>& objects) const;
+
+		/// <summary>
+		/// Append the indices of the lights whose range may overlap the volume. Results are conservative.
+		/// </summary>
+		void queryLights(const AABB& box, std::vector<size_t>& lights) const;
+		void queryLights(const BoundingSphere& sphere, std::vector<size_t>& lights) const;
+
 		void render(const Camera& camera) const;
 
+		/// <summary>
+		/// Statistics of the last call to render.
+		/// </summary>
+		const RenderStats& stats() const;
+
 	private:
 		std::vector<SceneObject> m_objects;
 		std::vector<PointLight> m_lights;
+
+		// Ids packed into the sort keys. Materials are deduplicated so that identical ones share state. Every
+		// entry is released with the last object using it, so that a freed program or mesh whose address is
+		// reused never inherits a stale id.
+		struct DrawIds
+		{
+			uint32_t program;
+			uint32_t material;
+			uint32_t mesh;
+			uint32_t arena; // Index type of the mesh, which selects its geometry arena
+		};
+
+		IdTable<Material> m_materials;
+		IdTable<const Program*> m_programs;
+		IdTable<const StaticMesh*> m_meshes;
+		// The arena of an object is only known once its mesh is loaded, see m_pendingObjects
+		mutable std::vector<DrawIds> m_objectIds;
+
+		// Objects and lights are indexed by bounding volume hierarchies, whose user data is the index in
+		// m_objects and m_lights. They are refitted lazily: every object whose transform version changed,
+		// and the lights accessed mutably whose position or range changed.
+		mutable DynamicAABBTree m_objectTree;
+		mutable DynamicAABBTree m_lightTree;
+		mutable std::vector<DynamicAABBTree::ProxyId> m_objectProxies;
+		std::vector<DynamicAABBTree::ProxyId> m_lightProxies;
+		mutable std::vector<uint32_t> m_boundsVersions;
+		// Level of detail drawn last frame for each object, the starting point of the hysteresis
+		mutable std::vector<uint8_t> m_objectLods;
+		mutable std::vector<Bounds> m_worldBounds;
+		// Shader data of each object, recomputed with its bounds. Frames only copy it for the visible objects.
+		mutable std::vector<ShaderDefs::ObjectData> m_objectData;
+		mutable std::vector<BoundingSphere> m_lightBounds;
+		mutable std::vector<size_t> m_movedLights;
+		// Objects whose mesh is still loading asynchronously. They stay out of the object hierarchy, so they are
+		// neither drawn nor returned by queries until their mesh is ready.
+		mutable std::vector<size_t> m_pendingObjects;
+
+		// Culling buffers. Objects in frustum-straddling nodes are gathered as structure of arrays
+		// and tested with SIMD.
+		mutable std::vector<uint32_t> m_visibleObjects;
+		mutable std::vector<uint32_t> m_cullCandidates;
+		mutable std::vector<float> m_sphereX;
+		mutable std::vector<float> m_sphereY;
+		mutable std::vector<float> m_sphereZ;
+		mutable std::vector<float> m_sphereRadius;
+		mutable std::vector<uint32_t> m_visibleCandidates;
+		mutable std::vector<ShaderDefs::PointLight> m_visibleLights;
+
+		// Per-frame sort buffers, kept to avoid reallocating them every frame
+		mutable std::vector<uint64_t> m_sortKeys;
+		mutable std::vector<uint32_t> m_sortedObjects;
+		mutable std::vector<uint64_t> m_sortKeyScratch;
+		mutable std::vector<uint32_t> m_sortObjectScratch;
+		mutable std::vector<DrawIds> m_commandIds;
+
+		mutable RenderStats m_stats = {};
+
+		void updateWorldBounds() const;
+		void updateObjectData(size_t index) const;
+		size_t cullObjects(const Frustum& frustum) const;
+		uint64_t sortKey(const DrawIds& ids, uint32_t lod, bool transparent, float depth) const;
+
+		mutable RingBuffer m_frameData;
+
+		// Clustered shading. Lights are binned in view space froxels by a compute pass every frame.
+		std::shared_ptr<Program> m_lightCullProgram;
+		ByteBuffer m_clusterLightCounts;
+		ByteBuffer m_clusterLightIndices;
+		// One overflow counter per frame in flight, persistently mapped. A slot is read and reset once the
+		// ring buffer has waited for the frame that last used it.
+		ByteBuffer m_clusterOverflowCounts;
+		Uniform<int> m_overflowSlotUniform;
+		mutable size_t m_frameCount = 0;
 	};
 }
\ No newline at end of file
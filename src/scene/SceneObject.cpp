@@ -15,19 +15,18 @@ namespace BerylEngine
 	{
 	}
 
-	glm::mat3 SceneObject::processNormalMatrix(const glm::mat4& model, const glm::mat4& view) const
+	Transform& SceneObject::transform()
 	{
-		return glm::mat3(glm::transpose(glm::inverse(view * model)));
+		return m_transform;
 	}
 
-	Transform& SceneObject::transform()
+	const Transform& SceneObject::transform() const
 	{
 		return m_transform;
 	}
 
-	void SceneObject::draw() const
+	const MeshRenderer& SceneObject::renderer() const
 	{
-		glm::mat4 model = m_transform.getMatrix();
-		m_renderer.draw(model);
+		return m_renderer;
 	}
 }
\ No newline at end of file
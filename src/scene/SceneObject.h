@@ -14,13 +14,12 @@ namespace BerylEngine
 		Transform m_transform;
 		MeshRenderer m_renderer;
 
-		glm::mat3 processNormalMatrix(const glm::mat4& model, const glm::mat4& view) const;
-
 	public:
 		SceneObject(const MeshRenderer& renderer);
 		SceneObject(const glm::vec3& pos, const MeshRenderer& renderer);
 
 		Transform& transform();
-		void draw() const;
+		const Transform& transform() const;
+		const MeshRenderer& renderer() const;
 	};
 }
\ No newline at end of file
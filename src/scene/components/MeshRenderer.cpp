@@ -7,10 +7,23 @@ namespace BerylEngine
 	{
 	}
 
-	void MeshRenderer::draw(const glm::mat4& model) const
+	const std::shared_ptr<const StaticMesh>& MeshRenderer::mesh() const
 	{
-		m_material.setUniform("modelMatrix", model);
-		m_material.bind();
-		m_mesh->draw();
+		return m_mesh;
+	}
+
+	const Material& MeshRenderer::material() const
+	{
+		return m_material;
+	}
+
+	float MeshRenderer::lodBias() const
+	{
+		return m_lodBias;
+	}
+
+	void MeshRenderer::setLodBias(float bias)
+	{
+		m_lodBias = bias;
 	}
 }
\ No newline at end of file
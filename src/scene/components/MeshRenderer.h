@@ -10,10 +10,19 @@ namespace BerylEngine
 	private:
 		std::shared_ptr<const StaticMesh> m_mesh;
 		Material m_material;
+		float m_lodBias = 1.0f;
 
 	public:
 		MeshRenderer(std::shared_ptr<const StaticMesh> mesh, const Material& matreial);
 
-		void draw(const glm::mat4& model) const;
+		const std::shared_ptr<const StaticMesh>& mesh() const;
+		const Material& material() const;
+
+		/// <summary>
+		/// Scale of the tolerated on-screen error of the mesh's levels of detail.
+		/// Above 1, coarser levels are used closer to the camera.
+		/// </summary>
+		float lodBias() const;
+		void setLodBias(float bias);
 	};
 }
\ No newline at end of file
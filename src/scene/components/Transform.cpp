@@ -17,6 +17,8 @@ namespace BerylEngine
 	void Transform::translate(const glm::vec3& translation)
 	{
 		m_transforms = glm::translate(m_transforms, translation);
+
+		m_version++;
 	}
 
 	void Transform::rotate(float angleX, float angleY, float angleZ)
@@ -38,16 +40,22 @@ namespace BerylEngine
 			glm::vec3 xAxis = getRight();
 			m_transforms = glm::rotate(m_transforms, angleX, xAxis);
 		}
+
+		m_version++;
 	}
 
 	void Transform::scale(float scaleX, float scaleY, float scaleZ)
 	{
 		m_transforms = glm::scale(m_transforms, glm::vec3(scaleX, scaleY, scaleZ));
+
+		m_version++;
 	}
 
 	void Transform::scale(float factor)
 	{
 		m_transforms = glm::scale(m_transforms, glm::vec3(factor));
+
+		m_version++;
 	}
 
 	const glm::mat4& Transform::getMatrix() const
@@ -55,6 +63,11 @@ namespace BerylEngine
 		return m_transforms;
 	}
 
+	uint32_t Transform::version() const
+	{
+		return m_version;
+	}
+
 	const glm::vec3 Transform::getRight() const
 	{
 		return glm::column(m_transforms, 0);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <glm/glm.hpp>
 
 namespace BerylEngine
@@ -8,6 +9,7 @@ namespace BerylEngine
 	{
 	private:
 		glm::mat4 m_transforms;
+		uint32_t m_version = 0;
 
 	public:
 		Transform();
@@ -24,6 +26,11 @@ namespace BerylEngine
 		void scale(float factor);
 
 		const glm::mat4& getMatrix() const;
+
+		/// <summary>
+		/// Incremented on every change, so that data derived from the matrix can be cached.
+		/// </summary>
+		uint32_t version() const;
 		const glm::vec3 getRight() const;
 		const glm::vec3 getUp() const;
 		const glm::vec3 getForward() const;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <glm/vec3.hpp>
+#include <glm/mat3x4.hpp>
 #include <glm/mat4x4.hpp>
 
 namespace BerylEngine::ShaderDefs
@@ -8,4 +9,5 @@ namespace BerylEngine::ShaderDefs
 	using namespace glm;
 
 #include "../../shaders/defines/structs.glsl"
+#include "../../shaders/defines/clusters.glsl"
 }
\ No newline at end of file